@@ -0,0 +1,79 @@
+// ics_bench - full calendar index vs. re-indexing after a one-event edit
+//
+// Build with -DHYFOCUS_BUILD_BENCH=ON and run:
+//   ./build/hyfocus-ics-bench [events]
+#include "IcsCalendar.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+
+namespace {
+
+std::string stamp(int64_t t) {
+    char buf[32];
+    time_t tt = static_cast<time_t>(t);
+    strftime(buf, sizeof(buf), "%Y%m%dT%H%M%SZ", gmtime(&tt));
+    return buf;
+}
+
+// A year of mixed meetings; every 10th event is a weekly focus block
+std::string makeCalendar(int events, int64_t now, int edited) {
+    std::string ics = "BEGIN:VCALENDAR\r\nVERSION:2.0\r\nPRODID:-//hyfocus//bench//EN\r\n";
+    for (int i = 0; i < events; i++) {
+        int64_t start = now - 180 * 86400LL + static_cast<int64_t>(i) * 1571;
+        bool focus = i % 10 == 0;
+        ics += "BEGIN:VEVENT\r\nUID:bench-" + std::to_string(i) + "@hyfocus\r\n";
+        ics += "DTSTAMP:" + stamp(now) + "\r\n";
+        ics += "DTSTART:" + stamp(start) + "\r\nDTEND:" + stamp(start + 2700) + "\r\n";
+        ics += "SUMMARY:" + std::string(focus ? "Deep work #focus ws:3" : "Meeting") + " " + std::to_string(i) +
+               (i == edited ? " (moved)" : "") + "\r\n";
+        ics += "DESCRIPTION:Agenda items for this slot\\, with a folded line that goes on\r\n  for a while to look like real exports.\r\n";
+        if (focus) {
+            ics += "RRULE:FREQ=WEEKLY;BYDAY=MO,WE,FR\r\n";
+        }
+        ics += "BEGIN:VALARM\r\nTRIGGER:-PT10M\r\nACTION:DISPLAY\r\nEND:VALARM\r\nEND:VEVENT\r\n";
+    }
+    ics += "END:VCALENDAR\r\n";
+    return ics;
+}
+
+template <typename Fn>
+double millis(Fn&& fn) {
+    auto t0 = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int events = argc > 1 ? std::atoi(argv[1]) : 20000;
+    int64_t now = time(nullptr);
+
+    std::string original = makeCalendar(events, now, -1);
+    std::string edited = makeCalendar(events, now, events / 2);
+
+    IcsCalendar calendar;
+    double cold = millis([&] { calendar.loadBuffer(original); });
+    auto coldStats = calendar.lastLoad();
+
+    double warm = millis([&] { calendar.loadBuffer(edited); });
+    auto warmStats = calendar.lastLoad();
+
+    IcsCalendar fresh;
+    double full = millis([&] { fresh.loadBuffer(edited); });
+
+    size_t blocks = 0;
+    double expand = millis([&] { blocks = calendar.expand(now, now + 7 * 86400LL).size(); });
+
+    printf("calendar: %d VEVENTs, %.1f MiB, %zu focus events\n", events, original.size() / 1048576.0,
+           coldStats.events);
+    printf("  first load:          %8.2f ms (%zu parsed)\n", cold, coldStats.parsed);
+    printf("  full re-parse:       %8.2f ms\n", full);
+    printf("  reload, 1 edited:    %8.2f ms (%zu parsed)\n", warm, warmStats.parsed);
+    printf("  expand 7 days:       %8.2f ms (%zu blocks)\n", expand, blocks);
+    return 0;
+}
@@ -0,0 +1,215 @@
+// rule_bench - compiled RuleEngine vs the original hand-written policy checks
+//
+// Build with -DHYFOCUS_BUILD_BENCH=ON and run:
+//   ./build/hyfocus-rule-bench [iterations] [--trace FILE]
+//
+// --trace also replays a recorded event trace (see trace.hpp, e.g. the
+// trace.tsv from hyfocus-workload) through both rule programs.
+#include "RuleEngine.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Mirrors the checks in onWorkspaceChange()/hkSpawn() before the rule engine
+struct LegacyPolicy {
+    bool sessionActive{true};
+    bool breakTime{false};
+    bool enforceDuringBreak{false};
+    std::set<int64_t> allowed;
+    std::set<std::string> spawnWhitelist;
+
+    bool blockSwitch(int64_t ws) const {
+        if (!sessionActive) return false;
+        if (breakTime && !enforceDuringBreak) return false;
+        return !allowed.contains(ws);
+    }
+
+    bool blockSpawn(const std::string& args) const {
+        if (!sessionActive) return false;
+        if (breakTime && !enforceDuringBreak) return false;
+        std::string argsLower = args;
+        std::transform(argsLower.begin(), argsLower.end(), argsLower.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+        for (const auto& item : spawnWhitelist) {
+            std::string itemLower = item;
+            std::transform(itemLower.begin(), itemLower.end(), itemLower.begin(),
+                           [](unsigned char c) { return std::tolower(c); });
+            if (argsLower.find(itemLower) != std::string::npos) return false;
+        }
+        return true;
+    }
+};
+
+struct Sample {
+    int64_t ws;
+    bool spawn;
+    const std::string* cmd;
+};
+
+template <typename Fn>
+double timeNs(size_t iterations, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(iterations);
+}
+
+// Every event of the trace once per pass, in order, with the context the hook would build
+double replayNs(const RuleEngine& engine, const std::vector<TraceEvent>& events, const std::vector<int>& minutes,
+                std::array<size_t, 8>& actions) {
+    actions.fill(0);
+    return timeNs(events.size(), [&]() {
+        RuleContext ctx;
+        for (size_t i = 0; i < events.size(); ++i) {
+            const TraceEvent& e = events[i];
+            ctx.event = e.event;
+            ctx.phase = e.phase;
+            ctx.workspace = e.workspace;
+            ctx.monitor = e.monitor;
+            ctx.windowClass = e.windowClass;
+            ctx.title = e.title;
+            ctx.command = e.command;
+            ctx.minuteOfDay = minutes[i];
+            ctx.flags = e.flags;
+            actions[static_cast<size_t>(engine.evaluate(ctx).action)]++;
+        }
+    });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t iterations = 5'000'000;
+    const char* tracePath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else {
+            iterations = std::strtoull(argv[i], nullptr, 10);
+        }
+    }
+
+    LegacyPolicy legacy;
+    legacy.allowed = {1, 2, 3};
+    legacy.spawnWhitelist = {"kitty", "alacritty", "code"};
+
+    const std::vector<std::string> commands = {"kitty", "firefox --new-window", "discord", "code ~/thesis"};
+
+    std::mt19937_64 rng(42);
+    std::vector<Sample> samples(4096);
+    for (auto& s : samples) {
+        s.ws = static_cast<int64_t>(rng() % 10) + 1;
+        s.spawn = (rng() % 4) == 0;
+        s.cmd = &commands[rng() % commands.size()];
+    }
+
+    const RuleDefaults defaults{.enforceDuringBreak = false, .hasBudgets = false};
+
+    RuleEngine builtinOnly;
+    builtinOnly.compile("", defaults);
+
+    RuleEngine withUserRules;
+    withUserRules.compile("class:~discord -> quarantine; time:23:00-06:00 !allowed -> freeze;"
+                          "ws:9 -> redirect:1; monitor:HDMI-A-1 ws:7 -> block; title:~youtube -> block",
+                          defaults);
+
+    // Encode the whitelist match as a flag, like hkSpawn does before evaluating
+    auto whitelisted = [&legacy](const std::string& cmd) {
+        for (const auto& item : legacy.spawnWhitelist) {
+            if (cmd.find(item) != std::string::npos) return true;
+        }
+        return false;
+    };
+    std::vector<uint8_t> cmdFlags;
+    for (const auto& cmd : commands) cmdFlags.push_back(whitelisted(cmd) ? RULE_FLAG_WHITELISTED : 0);
+
+    volatile size_t sink = 0;
+
+    double legacyNs = timeNs(iterations, [&]() {
+        size_t blocked = 0;
+        for (size_t i = 0; i < iterations; ++i) {
+            const Sample& s = samples[i & 4095];
+            blocked += s.spawn ? legacy.blockSpawn(*s.cmd) : legacy.blockSwitch(s.ws);
+        }
+        sink = blocked;
+    });
+
+    auto runEngine = [&](const RuleEngine& engine) {
+        return timeNs(iterations, [&]() {
+            size_t blocked = 0;
+            RuleContext ctx;
+            ctx.phase = RulePhase::Work;
+            ctx.windowClass = "kitty";
+            ctx.title = "~/thesis";
+            ctx.monitor = "DP-1";
+            ctx.minuteOfDay = 14 * 60;
+            for (size_t i = 0; i < iterations; ++i) {
+                const Sample& s = samples[i & 4095];
+                ctx.workspace = s.ws;
+                ctx.event = s.spawn ? RuleEvent::Spawn : RuleEvent::Switch;
+                ctx.command = *s.cmd;
+                ctx.flags = s.spawn ? cmdFlags[s.cmd - commands.data()] : (s.ws <= 3 ? RULE_FLAG_ALLOWED : 0);
+                blocked += engine.evaluate(ctx).action != RuleAction::Allow;
+            }
+            sink = blocked;
+        });
+    };
+
+    double builtinNs = runEngine(builtinOnly);
+    double userNs = runEngine(withUserRules);
+
+    std::printf("iterations: %zu (25%% spawn, 75%% switch)\n", iterations);
+    std::printf("%-32s %8.2f ns/op\n", "hand-written checks", legacyNs);
+    std::printf("%-32s %8.2f ns/op\n", "rule engine (builtin rules)", builtinNs);
+    std::printf("%-32s %8.2f ns/op\n", "rule engine (+5 user rules)", userNs);
+    std::printf("\nbuiltin program:\n%s", builtinOnly.dump().c_str());
+    (void)sink;
+
+    if (tracePath) {
+        std::ifstream in(tracePath);
+        std::vector<TraceEvent> events;
+        std::vector<int> minutes;
+        std::string line;
+        TraceEvent event;
+        while (std::getline(in, line)) {
+            if (parseTraceEvent(line, event)) {
+                time_t when = static_cast<time_t>(event.timeMs / 1000);
+                std::tm tm{};
+                gmtime_r(&when, &tm);
+                minutes.push_back(tm.tm_hour * 60 + tm.tm_min);
+                events.push_back(std::move(event));
+            }
+        }
+        if (events.empty()) {
+            std::fprintf(stderr, "rule_bench: no events in %s\n", tracePath);
+            return 1;
+        }
+
+        std::printf("\ntrace: %zu events from %s\n", events.size(), tracePath);
+        for (const auto& [name, engine] : {std::pair<const char*, const RuleEngine*>{"builtin rules", &builtinOnly},
+                                           {"+5 user rules", &withUserRules}}) {
+            std::array<size_t, 8> actions{};
+            double ns = replayNs(*engine, events, minutes, actions);
+            std::printf("%-32s %8.2f ns/op ", (std::string("replay (") + name + ")").c_str(), ns);
+            for (size_t a = 0; a < actions.size(); a++) {
+                if (actions[a]) {
+                    std::printf(" %s=%zu", RuleEngine::actionName(static_cast<RuleAction>(a)), actions[a]);
+                }
+            }
+            std::printf("\n");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+// trace - enforcement event trace shared by the workload generator and rule_bench
+#pragma once
+
+#include "RuleEngine.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One hook invocation as the plugin would see it, one tab-separated line:
+//   <unix ms> <host> <switch|focus|spawn> <idle|work|break|paused> <workspace>
+//   <monitor> <class> <title> <command> <flags>
+// flags are the RULE_FLAG_* bits the hook computes before evaluating. Rules
+// see the time of day in UTC, the zone hyfocus-workload generates in.
+// Lines starting with '#' are comments.
+struct TraceEvent {
+    int64_t timeMs{0};
+    std::string host;
+    RuleEvent event{RuleEvent::Switch};
+    RulePhase phase{RulePhase::Idle};
+    int64_t workspace{0};
+    std::string monitor;
+    std::string windowClass;
+    std::string title;
+    std::string command;
+    uint8_t flags{0};
+};
+
+inline const char* traceEventName(RuleEvent event) {
+    switch (event) {
+        case RuleEvent::Spawn: return "spawn";
+        case RuleEvent::Focus: return "focus";
+        default:               return "switch";
+    }
+}
+
+inline const char* tracePhaseName(RulePhase phase) {
+    switch (phase) {
+        case RulePhase::Work:   return "work";
+        case RulePhase::Break:  return "break";
+        case RulePhase::Paused: return "paused";
+        default:                return "idle";
+    }
+}
+
+inline std::string formatTraceEvent(const TraceEvent& e) {
+    std::string line = std::to_string(e.timeMs);
+    for (const std::string& field : {e.host, std::string(traceEventName(e.event)), std::string(tracePhaseName(e.phase)),
+                                     std::to_string(e.workspace), e.monitor, e.windowClass, e.title, e.command,
+                                     std::to_string(e.flags)}) {
+        line += '\t';
+        line += field;
+    }
+    return line;
+}
+
+inline bool parseTraceEvent(std::string_view line, TraceEvent& out) {
+    if (line.empty() || line[0] == '#') {
+        return false;
+    }
+    std::vector<std::string_view> fields;
+    size_t from = 0;
+    for (size_t tab; (tab = line.find('\t', from)) != std::string_view::npos; from = tab + 1) {
+        fields.push_back(line.substr(from, tab - from));
+    }
+    fields.push_back(line.substr(from));
+    if (fields.size() != 10) {
+        return false;
+    }
+
+    out.timeMs = std::strtoll(std::string(fields[0]).c_str(), nullptr, 10);
+    out.host = fields[1];
+    out.event = fields[2] == "spawn" ? RuleEvent::Spawn : fields[2] == "focus" ? RuleEvent::Focus : RuleEvent::Switch;
+    out.phase = fields[3] == "work"    ? RulePhase::Work
+              : fields[3] == "break"   ? RulePhase::Break
+              : fields[3] == "paused"  ? RulePhase::Paused
+                                       : RulePhase::Idle;
+    out.workspace = std::strtoll(std::string(fields[4]).c_str(), nullptr, 10);
+    out.monitor = fields[5];
+    out.windowClass = fields[6];
+    out.title = fields[7];
+    out.command = fields[8];
+    out.flags = static_cast<uint8_t>(std::strtoul(std::string(fields[9]).c_str(), nullptr, 10));
+    return true;
+}
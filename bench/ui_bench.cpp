@@ -0,0 +1,288 @@
+// ui_bench - processes, wall time and CPU behind each widget action
+//
+// Build with -DHYFOCUS_BUILD_BENCH=ON and run from the repository root:
+//   ./build/hyfocus-ui-bench [iterations] [eww config dir]
+//
+// Puts recording stand-ins for `eww` and `hyprctl` first on PATH (links to
+// this binary) and runs the eww/scripts the widgets run, the way they are
+// run: buttons call the script directly, the plugin through execAsync
+// (`sh -c`). The hyprctl stand-in answers dispatches the way the plugin
+// does, spawning the same execAsync eww calls (status windows on start and
+// stop), and the eww one keeps `update`d variables for `get`.
+//
+// Per action it reports the time until the script returns and until every
+// process it started has exited, the CPU they used, and how many processes
+// that took. The process count is the system-wide fork counter, so run it on
+// an otherwise idle machine; the eww/hyprctl call counts are exact.
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <string>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr const char* STATE_ENV = "HYFOCUS_UI_BENCH_DIR";
+
+std::string g_stateDir;
+
+void appendLine(const std::string& path, const std::string& line) {
+    // O_APPEND: backgrounded stand-ins write concurrently
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd >= 0) {
+        std::string out = line + "\n";
+        (void)!write(fd, out.data(), out.size());
+        close(fd);
+    }
+}
+
+std::string getVar(const std::string& name) {
+    std::ifstream in(g_stateDir + "/vars");
+    std::string line, value;
+    while (std::getline(in, line)) {
+        if (line.starts_with(name + "=")) {
+            value = line.substr(name.size() + 1);
+        }
+    }
+    return value;
+}
+
+void setVar(const std::string& name, const std::string& value) {
+    appendLine(g_stateDir + "/vars", name + "=" + value);
+}
+
+// Fire and forget, like execAsync; the bench reaps it as subreaper
+void execAsync(const std::string& cmd) {
+    if (fork() == 0) {
+        execl("/bin/sh", "sh", "-c", cmd.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+}
+
+int stubEww(int argc, char** argv) {
+    appendLine(g_stateDir + "/calls", "eww");
+    int i = 1;
+    if (i + 1 < argc && strcmp(argv[i], "-c") == 0) {
+        i += 2;
+    }
+    if (i < argc && strcmp(argv[i], "get") == 0 && i + 1 < argc) {
+        puts(getVar(argv[i + 1]).c_str());
+    } else if (i < argc && strcmp(argv[i], "update") == 0) {
+        for (i++; i < argc; i++) {
+            const char* eq = strchr(argv[i], '=');
+            if (eq) {
+                setVar(std::string(argv[i], eq - argv[i]), eq + 1);
+            }
+        }
+    }
+    return 0;
+}
+
+// What the plugin's dispatchers spawn (dispatchers.cpp, beginSession/closeSession)
+int stubHyprctl(int argc, char** argv) {
+    appendLine(g_stateDir + "/calls", "hyprctl");
+    std::string eww = "eww -c " + getVar("bench-eww-dir");
+    std::string dispatcher = argc > 2 && strcmp(argv[1], "dispatch") == 0 ? argv[2] : "";
+    if (dispatcher == "hyfocus:start") {
+        execAsync(eww + " open hyfocus-status");
+        execAsync(eww + " open hyfocus-status-2");
+    } else if (dispatcher == "hyfocus:stop") {
+        execAsync(eww + " close hyfocus-status");
+        execAsync(eww + " close hyfocus-status-2");
+    }
+    puts("ok");
+    return 0;
+}
+
+struct Action {
+    const char* name;
+    std::vector<std::string> args;  // script, then its arguments
+    bool fromPlugin;                // started by execAsync rather than a button
+};
+
+struct Sample {
+    double returnMs{0};
+    double settledMs{0};
+    double cpuMs{0};
+    long forks{0};
+    int ewwCalls{0};
+    int hyprctlCalls{0};
+};
+
+long readForks() {
+    std::ifstream in("/proc/stat");
+    std::string key;
+    long value = 0;
+    while (in >> key) {
+        if (key == "processes") {
+            in >> value;
+            return value;
+        }
+        in.ignore(LONG_MAX, '\n');
+    }
+    return 0;
+}
+
+double cpuMs(const rusage& usage) {
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e3 + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e3;
+}
+
+Sample run(const Action& action, const std::string& scriptDir) {
+    truncate((g_stateDir + "/calls").c_str(), 0);
+
+    std::vector<std::string> argv;
+    std::string script = scriptDir + "/" + action.args[0];
+    if (action.fromPlugin) {
+        std::string cmd = script;
+        for (size_t i = 1; i < action.args.size(); i++) {
+            cmd += " \"" + action.args[i] + "\"";
+        }
+        argv = {"/bin/sh", "-c", cmd};
+    } else {
+        argv = {script};
+        argv.insert(argv.end(), action.args.begin() + 1, action.args.end());
+    }
+    std::vector<char*> cargv;
+    for (auto& arg : argv) {
+        cargv.push_back(arg.data());
+    }
+    cargv.push_back(nullptr);
+
+    rusage before{}, after{};
+    getrusage(RUSAGE_CHILDREN, &before);
+    long forks = readForks();
+    auto t0 = std::chrono::steady_clock::now();
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        execv(cargv[0], cargv.data());
+        _exit(127);
+    }
+
+    Sample sample;
+    waitpid(pid, nullptr, 0);
+    sample.returnMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    // Backgrounded eww calls and execAsync children are reparented to us
+    while (wait(nullptr) > 0) {
+    }
+    sample.settledMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    getrusage(RUSAGE_CHILDREN, &after);
+    sample.cpuMs = cpuMs(after) - cpuMs(before);
+    sample.forks = readForks() - forks;
+
+    std::ifstream calls(g_stateDir + "/calls");
+    std::string line;
+    while (std::getline(calls, line)) {
+        (line == "eww" ? sample.ewwCalls : sample.hyprctlCalls)++;
+    }
+    return sample;
+}
+
+double percentile(std::vector<double> values, double p) {
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(p * values.size()))];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const char* base = strrchr(argv[0], '/');
+    base = base ? base + 1 : argv[0];
+    if (const char* dir = getenv(STATE_ENV)) {
+        g_stateDir = dir;
+        if (strcmp(base, "eww") == 0) {
+            return stubEww(argc, argv);
+        }
+        if (strcmp(base, "hyprctl") == 0) {
+            return stubHyprctl(argc, argv);
+        }
+    }
+
+    int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 50;
+    char ewwDir[PATH_MAX];
+    if (!realpath(argc > 2 ? argv[2] : "eww", ewwDir)) {
+        fprintf(stderr, "ui_bench: no eww config at '%s' (run from the repository root)\n", argc > 2 ? argv[2] : "eww");
+        return 1;
+    }
+    std::string scriptDir = std::string(ewwDir) + "/scripts";
+
+    char stateDir[] = "/tmp/hyfocus-ui-bench.XXXXXX";
+    char self[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (!mkdtemp(stateDir) || len <= 0) {
+        perror("ui_bench");
+        return 1;
+    }
+    self[len] = '\0';
+    g_stateDir = stateDir;
+    std::string binDir = g_stateDir + "/bin";
+    mkdir(binDir.c_str(), 0700);
+    if (symlink(self, (binDir + "/eww").c_str()) != 0 || symlink(self, (binDir + "/hyprctl").c_str()) != 0) {
+        perror("ui_bench: symlink");
+        return 1;
+    }
+    setenv(STATE_ENV, stateDir, 1);
+    setenv("PATH", (binDir + ":" + getenv("PATH")).c_str(), 1);
+
+    // Orphaned background jobs come back to us, so "settled" waits for them too
+    prctl(PR_SET_CHILD_SUBREAPER, 1);
+
+    setVar("bench-eww-dir", ewwDir);
+    setVar("focus-duration", "25");
+
+    const std::vector<Action> actions = {
+        {"open-start", {"open-start"}, false},
+        {"toggle-workspace", {"toggle-workspace", "3"}, false},
+        {"start-session", {"start-session"}, false},
+        {"show-flash", {"show-flash", "Stay focused", "0"}, true},
+        {"show-challenge", {"show-challenge"}, true},
+        {"submit-challenge", {"submit-challenge"}, false},
+    };
+
+    printf("%d runs per action, scripts from %s\n\n", iterations, scriptDir.c_str());
+    printf("%-18s %11s %11s %11s %9s %7s %5s %8s\n", "action", "return p50", "settled p50", "settled p95", "cpu ms",
+           "procs", "eww", "hyprctl");
+
+    for (const auto& action : actions) {
+        std::vector<double> returned, settled;
+        double cpu = 0;
+        long forks = 0;
+        Sample last;
+        for (int i = 0; i < iterations; i++) {
+            if (std::string(action.name) == "submit-challenge") {
+                // Typed the right answer: the path that stops the session
+                setVar("challenge-answer", "42");
+                setVar("challenge-input", "42");
+            }
+            last = run(action, scriptDir);
+            returned.push_back(last.returnMs);
+            settled.push_back(last.settledMs);
+            cpu += last.cpuMs;
+            forks += last.forks;
+        }
+        printf("%-18s %8.2f ms %8.2f ms %8.2f ms %9.2f %7.1f %5d %8d\n", action.name, percentile(returned, 0.5),
+               percentile(settled, 0.5), percentile(settled, 0.95), cpu / iterations,
+               static_cast<double>(forks) / iterations, last.ewwCalls, last.hyprctlCalls);
+    }
+
+    for (const char* file : {"/bin/eww", "/bin/hyprctl", "/calls", "/vars"}) {
+        unlink((g_stateDir + file).c_str());
+    }
+    rmdir(binDir.c_str());
+    rmdir(stateDir);
+    return 0;
+}
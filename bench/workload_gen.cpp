@@ -0,0 +1,333 @@
+// workload_gen - deterministic years of focus sessions for the benchmarks
+//
+// Build with -DHYFOCUS_BUILD_BENCH=ON and run:
+//   ./build/hyfocus-workload [--seed N] [--years N] [--hosts N] [--until YYYY-MM-DD] [--out DIR]
+//
+// Writes, under DIR (default ./workload):
+//   history/<host>/...   session log segments and tag dictionaries, exactly
+//                        as HistoryLog writes them (the journal)
+//   history-merge        the merged state of that root, as hyfocus-history and
+//                        the dashboard keep it (rollups, session columns, tag
+//                        postings)
+//   trace.tsv            every hook invocation during those sessions - window
+//                        focus changes, workspace switches, spawn attempts -
+//                        for `hyfocus-rule-bench --trace`
+//
+// The same seed gives byte-identical output: randomness comes from
+// mt19937_64, whose sequence is fixed by the standard, through hand-written
+// distributions rather than the library's implementation-defined ones, and
+// all times are UTC ending at --until rather than at "now".
+#include "FocusHistory.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+class Random {
+public:
+    explicit Random(uint64_t seed) : m_rng(seed) {}
+
+    uint64_t next() { return m_rng(); }
+    double uniform() { return static_cast<double>(m_rng() >> 11) * 0x1.0p-53; }
+    bool chance(double p) { return uniform() < p; }
+    size_t below(size_t n) { return static_cast<size_t>(uniform() * static_cast<double>(n)); }
+    double exponential(double mean) { return -mean * std::log1p(-uniform()); }
+    double normal(double mean, double stddev) {
+        double u = std::max(uniform(), 1e-12);
+        return mean + stddev * std::sqrt(-2.0 * std::log(u)) * std::cos(2.0 * M_PI * uniform());
+    }
+
+    // Zipf-like: index k picked with weight 1 / (k + 1)
+    size_t skewed(size_t n) {
+        double total = 0;
+        for (size_t k = 0; k < n; k++) total += 1.0 / static_cast<double>(k + 1);
+        double pick = uniform() * total;
+        for (size_t k = 0; k < n; k++) {
+            pick -= 1.0 / static_cast<double>(k + 1);
+            if (pick < 0) return k;
+        }
+        return n - 1;
+    }
+
+    std::string uuid() {
+        char text[33];
+        snprintf(text, sizeof(text), "%016llx%016llx", static_cast<unsigned long long>(next()),
+                 static_cast<unsigned long long>(next()));
+        return text;
+    }
+
+private:
+    std::mt19937_64 m_rng;
+};
+
+struct App {
+    const char* windowClass;
+    std::vector<const char*> titles;
+    bool distraction;
+};
+
+const std::vector<App> APPS = {
+    {"code", {"main.cpp - hyfocus - Visual Studio Code", "README.md - thesis - Visual Studio Code",
+              "FocusHistory.cpp - hyfocus - Visual Studio Code"}, false},
+    {"kitty", {"~/src/hyfocus", "nvim chapter3.tex", "make -j16", "htop"}, false},
+    {"firefox", {"cppreference.com - Mozilla Firefox", "Pull request #42 - Mozilla Firefox",
+                 "arXiv:2401.01234 - Mozilla Firefox"}, false},
+    {"org.pwmt.zathura", {"paper.pdf", "thesis-draft.pdf"}, false},
+    {"firefox", {"YouTube - Mozilla Firefox", "Reddit - Mozilla Firefox", "Hacker News - Mozilla Firefox"}, true},
+    {"discord", {"#general | Discord", "Friends - Discord"}, true},
+    {"steam", {"Steam", "Store - Steam"}, true},
+    {"rofi", {"rofi"}, false},  // launcher: in exception_classes
+};
+
+const std::vector<std::string> TAGS = {"thesis", "work", "hyfocus", "reading", "admin", "review",
+                                       "writing", "study/math", "study/german", "ops"};
+
+struct SpawnCommand {
+    const char* command;
+    bool whitelisted;  // matches the default bench spawn_whitelist (kitty, alacritty, code)
+};
+
+const std::vector<SpawnCommand> SPAWNS = {
+    {"kitty", true}, {"code ~/thesis", true}, {"firefox --new-window", false}, {"discord", false}, {"steam", false},
+};
+
+struct Host {
+    std::string name;
+    std::vector<std::string> monitors;
+    double weekdayActive;  // chance of any session on a weekday
+    double weekendActive;
+};
+
+struct Counts {
+    size_t sessions{0};
+    size_t events{0};
+    size_t blockedCandidates{0};  // switches off the allowlist, disallowed spawns
+};
+
+std::string monitorFor(const Host& host, int64_t workspace) {
+    return host.monitors[static_cast<size_t>(workspace - 1) * host.monitors.size() / 9];
+}
+
+// Hook invocations during one work or break interval
+void traceInterval(Random& rnd, const Host& host, int64_t from, int64_t to, RulePhase phase,
+                   const std::vector<int64_t>& allowed, int64_t& workspace, std::ofstream& trace, Counts& counts) {
+    double gapMean = phase == RulePhase::Work ? 45.0 : 25.0;
+    std::string windowClass = "kitty", title = "~/src/hyfocus";  // focused window, carried into switches/spawns
+    for (double t = static_cast<double>(from) + rnd.exponential(gapMean); t < static_cast<double>(to);
+         t += rnd.exponential(gapMean)) {
+        TraceEvent e;
+        e.timeMs = static_cast<int64_t>(t * 1000.0);
+        e.host = host.name;
+        e.phase = phase;
+
+        double kind = rnd.uniform();
+        if (kind < 0.6) {
+            // Mostly work apps; distractions creep in, more so on breaks
+            e.event = RuleEvent::Focus;
+            const App* app = &APPS[rnd.below(APPS.size())];
+            while (app->distraction && !rnd.chance(phase == RulePhase::Work ? 0.2 : 0.7)) {
+                app = &APPS[rnd.below(APPS.size())];
+            }
+            windowClass = app->windowClass;
+            title = app->titles[rnd.below(app->titles.size())];
+            e.workspace = workspace;
+            e.flags = windowClass == "rofi" ? RULE_FLAG_EXEMPT : 0;
+        } else if (kind < 0.9) {
+            e.event = RuleEvent::Switch;
+            int64_t target = rnd.chance(0.8) ? allowed[rnd.below(allowed.size())] : 5 + static_cast<int64_t>(rnd.below(5));
+            bool onList = std::find(allowed.begin(), allowed.end(), target) != allowed.end();
+            e.workspace = target;
+            e.flags = onList ? RULE_FLAG_ALLOWED : 0;
+            counts.blockedCandidates += !onList;
+            if (onList || phase == RulePhase::Break) {
+                workspace = target;
+            }
+        } else {
+            e.event = RuleEvent::Spawn;
+            const SpawnCommand& spawn = SPAWNS[rnd.skewed(SPAWNS.size())];
+            e.command = spawn.command;
+            e.flags = spawn.whitelisted ? RULE_FLAG_WHITELISTED : 0;
+            counts.blockedCandidates += !spawn.whitelisted;
+            e.workspace = workspace;
+        }
+        e.windowClass = windowClass;
+        e.title = title;
+        e.monitor = monitorFor(host, e.workspace);
+        trace << formatTraceEvent(e) << '\n';
+        counts.events++;
+    }
+}
+
+bool parseDay(const char* text, int64_t& out) {
+    int y = 0, m = 0, d = 0;
+    if (sscanf(text, "%d-%d-%d", &y, &m, &d) != 3) {
+        return false;
+    }
+    std::tm tm{};
+    tm.tm_year = y - 1900;
+    tm.tm_mon = m - 1;
+    tm.tm_mday = d;
+    out = static_cast<int64_t>(timegm(&tm));
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    uint64_t seed = 1;
+    int years = 1;
+    int hostCount = 2;
+    int64_t until = 0;
+    parseDay("2026-01-01", until);
+    fs::path out = "workload";
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--years" && i + 1 < argc) {
+            years = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--hosts" && i + 1 < argc) {
+            hostCount = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--until" && i + 1 < argc && parseDay(argv[i + 1], until)) {
+            i++;
+        } else if (arg == "--out" && i + 1 < argc) {
+            out = argv[++i];
+        } else {
+            fprintf(stderr, "usage: hyfocus-workload [--seed N] [--years N] [--hosts N] [--until YYYY-MM-DD] [--out DIR]\n");
+            return 2;
+        }
+    }
+
+    // Segment names and rollup dates follow the local zone; pin it
+    setenv("TZ", "UTC", 1);
+    tzset();
+
+    fs::path root = out / "history";
+    std::error_code ec;
+    if (fs::exists(root, ec) && !fs::is_empty(root, ec)) {
+        fprintf(stderr, "hyfocus-workload: %s is not empty; remove it so the output stays reproducible\n",
+                root.c_str());
+        return 1;
+    }
+    fs::create_directories(root, ec);
+    std::ofstream trace(out / "trace.tsv", std::ios::trunc);
+    if (ec || !trace) {
+        fprintf(stderr, "hyfocus-workload: cannot write to %s\n", out.c_str());
+        return 1;
+    }
+    trace << "# hyfocus trace v1 seed=" << seed << " years=" << years << " hosts=" << hostCount << '\n';
+
+    std::vector<Host> hosts;
+    for (int h = 0; h < hostCount; h++) {
+        if (h == 0) {
+            hosts.push_back({"desk", {"DP-1", "HDMI-A-1"}, 0.85, 0.3});
+        } else if (h == 1) {
+            hosts.push_back({"laptop", {"eDP-1"}, 0.35, 0.25});
+        } else {
+            hosts.push_back({"host" + std::to_string(h), {"DP-1"}, 0.3, 0.1});
+        }
+    }
+
+    Random rnd(seed);
+    Counts counts;
+    auto t0 = std::chrono::steady_clock::now();
+    int64_t first = until - static_cast<int64_t>(years) * 365 * 86400;
+
+    for (int64_t day = first; day < until; day += 86400) {
+        std::tm tm{};
+        time_t dayTime = static_cast<time_t>(day);
+        gmtime_r(&dayTime, &tm);
+        bool weekend = tm.tm_wday == 0 || tm.tm_wday == 6;
+
+        for (const Host& host : hosts) {
+            if (!rnd.chance(weekend ? host.weekendActive : host.weekdayActive)) {
+                continue;
+            }
+
+            HistoryLog log(root.string(), host.name);
+            // First session around 09:00, then gaps of ~45 min until evening
+            int64_t start = day + static_cast<int64_t>(std::clamp(rnd.normal(9.0, 1.2), 6.0, 14.0) * 3600);
+            int sessions = 1 + static_cast<int>(rnd.exponential(2.5));
+            for (int s = 0; s < sessions && start < day + 22 * 3600; s++) {
+                static constexpr int WORK_MINUTES[] = {25, 50, 90};
+                int work = WORK_MINUTES[rnd.skewed(3)] * 60;
+                int pause = work / 5;
+                int cycles = 1 + static_cast<int>(rnd.below(4));
+                bool completed = rnd.chance(0.75);
+                int64_t planned = static_cast<int64_t>(cycles) * (work + pause) - pause;
+                int64_t length = completed ? planned : static_cast<int64_t>(planned * (0.1 + 0.8 * rnd.uniform()));
+
+                std::vector<int64_t> allowed = {1, 2};
+                for (int64_t ws = 3; ws <= 4; ws++) {
+                    if (rnd.chance(0.5)) allowed.push_back(ws);
+                }
+                int64_t workspace = allowed.front();
+
+                SessionRecord record;
+                record.start = start;
+                record.end = start + length;
+                record.completed = completed;
+                record.uuid = rnd.uuid();
+                if (rnd.chance(0.7)) {
+                    record.tags.push_back(TAGS[rnd.skewed(TAGS.size())]);
+                    if (rnd.chance(0.15)) {
+                        const std::string& second = TAGS[rnd.skewed(TAGS.size())];
+                        if (second != record.tags.front()) record.tags.push_back(second);
+                    }
+                }
+
+                for (int64_t at = start; at < record.end; at += work + pause) {
+                    int64_t workEnd = std::min(at + work, record.end);
+                    record.workSecs += workEnd - at;
+                    traceInterval(rnd, host, at, workEnd, RulePhase::Work, allowed, workspace, trace, counts);
+                    traceInterval(rnd, host, workEnd, std::min(workEnd + pause, record.end), RulePhase::Break, allowed,
+                                  workspace, trace, counts);
+                }
+
+                std::string error;
+                if (!log.append(record, error)) {
+                    fprintf(stderr, "hyfocus-workload: %s\n", error.c_str());
+                    return 1;
+                }
+                counts.sessions++;
+                start = record.end + 300 + static_cast<int64_t>(rnd.exponential(45.0 * 60));
+            }
+        }
+    }
+    trace.close();
+    double generated = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    // The merged form, so query benchmarks can start from a warm state
+    HistoryMerger merger;
+    auto t1 = std::chrono::steady_clock::now();
+    HistoryMergeStats stats = merger.run({root.string()});
+    double merged = std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+    std::string error;
+    if (!merger.saveState((out / "history-merge").string(), error)) {
+        fprintf(stderr, "hyfocus-workload: %s\n", error.c_str());
+        return 1;
+    }
+
+    printf("seed %llu: %d years, %zu hosts -> %s\n", static_cast<unsigned long long>(seed), years, hosts.size(),
+           out.c_str());
+    printf("  sessions:      %zu (%zu segments, %.1f MiB journal)\n", counts.sessions, stats.segments,
+           stats.bytes / 1048576.0);
+    printf("  trace events:  %zu (%zu would-be blocks)\n", counts.events, counts.blockedCandidates);
+    printf("  generated in   %.2f s, full merge %.2f s\n", generated, merged);
+    return 0;
+}
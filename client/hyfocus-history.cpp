@@ -0,0 +1,175 @@
+// hyfocus-history - combined focus statistics from several machines
+//
+// Each machine's plugin appends finished sessions to its own directory
+// under a history root ($XDG_STATE_HOME/hyfocus/history by default, or
+// history_dir). Sync the roots between machines with any file sync, then:
+//
+//   hyfocus-history [DIR...]                 daily and per-host rollups
+//   hyfocus-history --sessions [DIR...]      also print newly merged sessions
+//   hyfocus-history --json [DIR...]          rollups as one JSON object
+//   hyfocus-history --rebuild [DIR...]       forget earlier runs, read everything
+//   hyfocus-history --tag thesis --from 2026-10-01 [--to 2026-10-31]
+//   hyfocus-history --tags [--from ...]      totals for every tag
+//
+// Runs are incremental: only segments (or parts of segments) that arrived
+// since the last run are read, and sessions seen before are not counted
+// again. See FocusHistory.hpp.
+#include "FocusHistory.hpp"
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+static void usage() {
+    fputs("usage: hyfocus-history [--sessions] [--json] [--rebuild] [--state FILE] [DIR...]\n"
+          "       hyfocus-history --tag NAME|--tags [--from YYYY-MM-DD] [--to YYYY-MM-DD] [DIR...]\n"
+          "\n"
+          "DIR is a history root holding one directory per host (default: this machine's,\n"
+          "$XDG_STATE_HOME/hyfocus/history). Merge state is kept in FILE\n"
+          "(default: $XDG_CACHE_HOME/hyfocus/history-merge). --from/--to are inclusive\n"
+          "local dates and select sessions by when they started.\n",
+          stderr);
+}
+
+static void printPiece(std::string_view piece) {
+    fwrite(piece.data(), 1, piece.size(), stdout);
+}
+
+static std::string formatDuration(int64_t seconds) {
+    char text[32];
+    snprintf(text, sizeof(text), "%lldh%02lldm", static_cast<long long>(seconds / 3600),
+             static_cast<long long>(seconds / 60 % 60));
+    return text;
+}
+
+static std::string formatLocal(int64_t when) {
+    char text[32];
+    time_t t = static_cast<time_t>(when);
+    strftime(text, sizeof(text), "%Y-%m-%d %H:%M", localtime(&t));
+    return text;
+}
+
+static void printTags(const std::vector<std::pair<std::string, HistoryTotals>>& tags, bool json) {
+    if (json) {
+        writeTagJson(tags, printPiece);
+        puts("");
+        return;
+    }
+    for (const auto& [tag, totals] : tags) {
+        printf("#%-19s  %8s  %3lld sessions (%lld completed)\n", tag.c_str(), formatDuration(totals.workSecs).c_str(),
+               static_cast<long long>(totals.sessions), static_cast<long long>(totals.completed));
+    }
+}
+
+static void printText(const HistoryMerger& merger) {
+    HistoryTotals all;
+    for (const auto& [date, totals] : merger.days()) {
+        printf("%04d-%02d-%02d  %8s  %3lld sessions (%lld completed)\n", date / 10000, date / 100 % 100, date % 100,
+               formatDuration(totals.workSecs).c_str(), static_cast<long long>(totals.sessions),
+               static_cast<long long>(totals.completed));
+        all.workSecs += totals.workSecs;
+        all.sessions += totals.sessions;
+        all.completed += totals.completed;
+    }
+
+    printf("\n");
+    for (const auto& [host, totals] : merger.hosts()) {
+        printf("%-20s  %8s  %3lld sessions\n", host.c_str(), formatDuration(totals.workSecs).c_str(),
+               static_cast<long long>(totals.sessions));
+    }
+    printf("%-20s  %8s  %3lld sessions (%lld completed)\n", "total", formatDuration(all.workSecs).c_str(),
+           static_cast<long long>(all.sessions), static_cast<long long>(all.completed));
+}
+
+int main(int argc, char** argv) {
+    bool sessions = false;
+    bool json = false;
+    bool rebuild = false;
+    bool allTags = false;
+    std::vector<std::string> tags;
+    int64_t from = INT64_MIN;
+    int64_t to = INT64_MAX;
+    std::string statePath = HistoryMerger::defaultStatePath();
+    std::vector<std::string> roots;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--sessions") {
+            sessions = true;
+        } else if (arg == "--json") {
+            json = true;
+        } else if (arg == "--rebuild") {
+            rebuild = true;
+        } else if (arg == "--state" && i + 1 < argc) {
+            statePath = argv[++i];
+        } else if (arg == "--tags") {
+            allTags = true;
+        } else if (arg == "--tag" && i + 1 < argc) {
+            std::string spec = std::string("#") + argv[++i];  // "thesis" or "#thesis"
+            for (const auto& tag : takeSessionTags(spec)) {
+                tags.push_back(tag);
+            }
+        } else if ((arg == "--from" || arg == "--to") && i + 1 < argc) {
+            if (!parseLocalDate(argv[++i], arg == "--to", arg == "--from" ? from : to)) {
+                fprintf(stderr, "hyfocus-history: expected YYYY-MM-DD, got '%s'\n", argv[i]);
+                return 2;
+            }
+        } else if (arg.starts_with("-")) {
+            usage();
+            return 2;
+        } else {
+            roots.push_back(arg);
+        }
+    }
+    if (roots.empty()) {
+        roots.push_back(HistoryLog::defaultRoot());
+    }
+
+    HistoryMerger merger;
+    std::string error;
+    if (!rebuild && !merger.loadState(statePath, error)) {
+        fprintf(stderr, "hyfocus-history: %s (use --rebuild to start over)\n", error.c_str());
+        return 1;
+    }
+
+    HistoryMergeStats stats = merger.run(roots, [&](const SessionRecord& record) {
+        if (sessions) {
+            printf("%s  %-16s  %8s  %s  %s\n", formatLocal(record.start).c_str(), record.host.c_str(),
+                   formatDuration(record.workSecs).c_str(), record.completed ? "completed" : "stopped  ",
+                   record.uuid.c_str());
+        }
+    });
+    if (sessions && stats.merged) {
+        printf("\n");
+    }
+
+    if (!merger.saveState(statePath, error)) {
+        fprintf(stderr, "hyfocus-history: %s\n", error.c_str());
+        return 1;
+    }
+
+    fprintf(stderr, "hyfocus-history: %zu new sessions from %zu segments (%zu bytes), %zu duplicates, %zu malformed lines\n",
+            stats.merged, stats.segments, stats.bytes, stats.duplicates, stats.malformed);
+    if (stats.waiting) {
+        fprintf(stderr, "hyfocus-history: %zu hosts wait for tags that haven't synced yet\n", stats.waiting);
+    }
+
+    if (allTags) {
+        printTags(merger.allTagTotals(from, to), json);
+    } else if (!tags.empty()) {
+        std::vector<std::pair<std::string, HistoryTotals>> selected;
+        for (const auto& tag : tags) {
+            selected.emplace_back(tag, merger.tagTotals(tag, from, to));
+        }
+        printTags(selected, json);
+    } else if (json) {
+        writeRollupJson(merger, printPiece);
+        puts("");
+    } else {
+        printText(merger);
+    }
+    return 0;
+}
@@ -0,0 +1,418 @@
+// hyfocusctl - command-line client for the HyFocus IPC socket
+//
+// Standalone (no Hyprland headers), so status bars can run it as one
+// long-lived process:
+//
+//   hyfocusctl send "batch allow 4; except kitty"   one request, print reply
+//   hyfocusctl status                                current state as JSON
+//   hyfocusctl subscribe catalogue|state             raw JSON stream
+//   hyfocusctl watch waybar|i3bar|polybar [--minutes]
+//
+// `watch` holds a state subscription. The plugin only pushes transitions
+// (start, pause, work/break, allowlist changes, stop); the countdown in
+// between is interpolated locally, so the process sleeps in poll() until
+// the displayed text would actually change.
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <poll.h>
+#include <string>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+static int connectSocket(const std::string& path);
+
+// The plugin keeps its socket under the Hyprland instance it runs in:
+// $XDG_RUNTIME_DIR/hypr/<signature>/hyfocus/ipc.sock. Started from Hyprland
+// we inherit the signature. Otherwise take the most recently started
+// instance whose socket actually answers.
+static std::string socketPath() {
+    if (const char* path = getenv("HYFOCUS_SOCKET"); path && *path) {
+        return path;
+    }
+
+    const char* runtimeDir = getenv("XDG_RUNTIME_DIR");
+    std::string hyprDir = std::string(runtimeDir ? runtimeDir : "/tmp") + "/hypr";
+    if (const char* signature = getenv("HYPRLAND_INSTANCE_SIGNATURE"); signature && *signature) {
+        return hyprDir + "/" + signature + "/hyfocus/ipc.sock";
+    }
+
+    std::string best;
+    std::filesystem::file_time_type bestTime;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(hyprDir, ec)) {
+        std::filesystem::path candidate = entry.path() / "hyfocus" / "ipc.sock";
+        auto mtime = std::filesystem::last_write_time(candidate, ec);
+        if (ec || (!best.empty() && mtime <= bestTime)) {
+            continue;
+        }
+        int fd = connectSocket(candidate.string());
+        if (fd >= 0) {
+            close(fd);
+            best = candidate.string();
+            bestTime = mtime;
+        }
+    }
+    return best.empty() ? hyprDir + "/default/hyfocus/ipc.sock" : best;
+}
+
+static int connectSocket(const std::string& path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool sendLine(int fd, const std::string& line) {
+    std::string msg = line + "\n";
+    size_t off = 0;
+    while (off < msg.size()) {
+        ssize_t n = send(fd, msg.data() + off, msg.size() - off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        off += n;
+    }
+    return true;
+}
+
+// Reads whole lines from a blocking socket
+class LineReader {
+public:
+    explicit LineReader(int fd) : m_fd(fd) {}
+
+    // Returns false on EOF/error. Only call when data is ready or blocking is fine.
+    bool readLine(std::string& line) {
+        while (true) {
+            size_t newline = m_buf.find('\n');
+            if (newline != std::string::npos) {
+                line = m_buf.substr(0, newline);
+                m_buf.erase(0, newline + 1);
+                return true;
+            }
+            char buf[4096];
+            ssize_t n = read(m_fd, buf, sizeof(buf));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            m_buf.append(buf, n);
+        }
+    }
+
+    bool hasBufferedLine() const { return m_buf.find('\n') != std::string::npos; }
+
+private:
+    int m_fd;
+    std::string m_buf;
+};
+
+// Just enough JSON for the plugin's flat state object
+static std::string jsonField(const std::string& json, const std::string& key) {
+    std::string needle = "\"" + key + "\":";
+    size_t pos = json.find(needle);
+    if (pos == std::string::npos) {
+        return "";
+    }
+    pos = json.find_first_not_of(' ', pos + needle.size());
+    if (pos == std::string::npos) {
+        return "";
+    }
+
+    if (json[pos] == '"') {
+        size_t end = json.find('"', pos + 1);
+        return json.substr(pos + 1, end - pos - 1);
+    }
+    if (json[pos] == '[') {
+        size_t end = json.find(']', pos);
+        return json.substr(pos + 1, end - pos - 1);
+    }
+    size_t end = json.find_first_of(",}", pos);
+    return json.substr(pos, end - pos);
+}
+
+static std::string jsonEscape(const std::string& str) {
+    std::string out;
+    for (char c : str) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (c == '\n') {
+            out += "\\n";
+            continue;
+        }
+        out += c;
+    }
+    return out;
+}
+
+enum class BarFormat {
+    Waybar,
+    I3bar,
+    Polybar
+};
+
+struct SessionView {
+    bool active{false};
+    std::string state{"inactive"};
+    std::string workspaces;
+    int intervalSecs{0};
+    int remainingAtUpdate{0};
+    Clock::time_point updatedAt;
+
+    void update(const std::string& json) {
+        active = jsonField(json, "active") == "true";
+        state = jsonField(json, "state");
+        workspaces = jsonField(json, "workspaces");
+        intervalSecs = atoi(jsonField(json, "interval_secs").c_str());
+        remainingAtUpdate = atoi(jsonField(json, "remaining_secs").c_str());
+        updatedAt = Clock::now();
+        if (state.empty()) state = "inactive";
+    }
+
+    bool counting() const { return active && (state == "working" || state == "break"); }
+
+    // Milliseconds left, interpolated from the last update
+    long long remainingMs(Clock::time_point now) const {
+        long long ms = remainingAtUpdate * 1000LL;
+        if (counting()) {
+            ms -= std::chrono::duration_cast<std::chrono::milliseconds>(now - updatedAt).count();
+        }
+        return std::max(0LL, ms);
+    }
+};
+
+static std::string formatRemaining(long long ms, bool minutesOnly) {
+    long long secs = (ms + 999) / 1000;  // round up: "00:00" only at the very end
+    char buf[32];
+    if (minutesOnly) {
+        snprintf(buf, sizeof(buf), "%lldm", (secs + 59) / 60);
+    } else {
+        snprintf(buf, sizeof(buf), "%02lld:%02lld", secs / 60, secs % 60);
+    }
+    return buf;
+}
+
+static const char* stateColor(const std::string& state) {
+    if (state == "working") return "#5fa8ff";
+    if (state == "break") return "#6fcf6f";
+    if (state == "paused") return "#ffb347";
+    return "#888888";
+}
+
+static std::string render(const SessionView& view, BarFormat format, bool minutesOnly, Clock::time_point now) {
+    std::string text;
+    int percentage = 0;
+    if (view.active) {
+        long long ms = view.remainingMs(now);
+        text = formatRemaining(ms, minutesOnly);
+        if (view.state == "break") text = "break " + text;
+        if (view.state == "paused") text = "paused " + text;
+        if (view.intervalSecs > 0) {
+            percentage = static_cast<int>(100 - ms / (view.intervalSecs * 10LL));
+            percentage = std::clamp(percentage, 0, 100);
+        }
+    }
+
+    switch (format) {
+        case BarFormat::Waybar: {
+            std::string tooltip = view.active ? "HyFocus: " + view.state + "\nWorkspaces: " + view.workspaces
+                                              : "HyFocus: no session";
+            return "{\"text\": \"" + jsonEscape(text) + "\", \"alt\": \"" + view.state +
+                   "\", \"class\": \"" + view.state + "\", \"tooltip\": \"" + jsonEscape(tooltip) +
+                   "\", \"percentage\": " + std::to_string(percentage) + "}";
+        }
+        case BarFormat::I3bar:
+            return "[{\"name\": \"hyfocus\", \"full_text\": \"" + jsonEscape(text) +
+                   "\", \"color\": \"" + stateColor(view.state) + "\"}],";
+        case BarFormat::Polybar:
+            if (!view.active) return "";
+            return std::string("%{F") + stateColor(view.state) + "}" + text + "%{F-}";
+    }
+    return "";
+}
+
+// Milliseconds until the rendered countdown changes, -1 = not until the next push
+static int nextChangeMs(const SessionView& view, bool minutesOnly, Clock::time_point now) {
+    if (!view.counting()) {
+        return -1;
+    }
+    long long ms = view.remainingMs(now);
+    if (ms <= 0) {
+        return -1;
+    }
+    long long step = minutesOnly ? 60000 : 1000;
+    long long wait = ms % step;
+    return static_cast<int>(wait == 0 ? step : wait) + 1;
+}
+
+static void emit(const std::string& line, std::string& last) {
+    if (line == last) {
+        return;
+    }
+    last = line;
+    fputs(line.c_str(), stdout);
+    fputc('\n', stdout);
+    fflush(stdout);
+}
+
+// Block until the socket shows up. A socket file nobody listens on (plugin
+// unloaded without cleanup) is retried on a slow timer instead.
+static void waitForSocket(const std::string& path) {
+    if (access(path.c_str(), F_OK) == 0) {
+        poll(nullptr, 0, 2000);
+        return;
+    }
+
+    std::string dir = path.substr(0, path.rfind('/'));
+    int ifd = inotify_init1(IN_CLOEXEC);
+    if (ifd >= 0 && inotify_add_watch(ifd, dir.c_str(), IN_CREATE | IN_MOVED_TO) >= 0) {
+        pollfd pfd{ifd, POLLIN, 0};
+        poll(&pfd, 1, 30000);
+    } else {
+        poll(nullptr, 0, 2000);
+    }
+    if (ifd >= 0) close(ifd);
+}
+
+static int runWatch(BarFormat format, bool minutesOnly) {
+    std::string last;
+
+    if (format == BarFormat::I3bar) {
+        puts("{\"version\": 1}\n[");
+        fflush(stdout);
+    }
+
+    while (true) {
+        // Re-resolved each time: a restarted Hyprland has a new signature
+        std::string path = socketPath();
+        SessionView view;
+        int fd = connectSocket(path);
+        if (fd < 0 || !sendLine(fd, "subscribe state")) {
+            if (fd >= 0) close(fd);
+            emit(render(view, format, minutesOnly, Clock::now()), last);
+            waitForSocket(path);
+            continue;
+        }
+
+        LineReader reader(fd);
+        bool connected = true;
+        while (connected) {
+            auto now = Clock::now();
+            pollfd pfd{fd, POLLIN, 0};
+            int timeout = reader.hasBufferedLine() ? 0 : nextChangeMs(view, minutesOnly, now);
+            int ready = poll(&pfd, 1, timeout);
+            if (ready < 0 && errno != EINTR) {
+                connected = false;
+            } else if (ready > 0 || reader.hasBufferedLine()) {
+                std::string line;
+                if (!reader.readLine(line)) {
+                    connected = false;
+                } else if (line.find("\"active\"") != std::string::npos) {
+                    view.update(line);
+                }
+            }
+            emit(render(connected ? view : SessionView{}, format, minutesOnly, Clock::now()), last);
+        }
+
+        // Plugin reloaded or Hyprland restarted
+        close(fd);
+        waitForSocket(path);
+    }
+}
+
+static int runRequest(const std::string& request, bool stream) {
+    std::string path = socketPath();
+    int fd = connectSocket(path);
+    if (fd < 0) {
+        fprintf(stderr, "hyfocusctl: cannot connect to %s: %s\n", path.c_str(), strerror(errno));
+        return 2;
+    }
+    if (!sendLine(fd, request)) {
+        fprintf(stderr, "hyfocusctl: send failed: %s\n", strerror(errno));
+        close(fd);
+        return 2;
+    }
+
+    LineReader reader(fd);
+    std::string line;
+    int rc = 1;
+    while (reader.readLine(line)) {
+        puts(line.c_str());
+        fflush(stdout);
+        rc = (line.find("\"ok\": false") != std::string::npos) ? 1 : 0;
+        if (!stream) break;
+    }
+    close(fd);
+    return rc;
+}
+
+static void usage() {
+    fputs("usage: hyfocusctl send <request>\n"
+          "       hyfocusctl status\n"
+          "       hyfocusctl stats [days]\n"
+          "       hyfocusctl subscribe catalogue|state\n"
+          "       hyfocusctl watch waybar|i3bar|polybar [--minutes]\n"
+          "\n"
+          "The socket is $XDG_RUNTIME_DIR/hypr/$HYPRLAND_INSTANCE_SIGNATURE/hyfocus/ipc.sock,\n"
+          "or the newest running instance's when the signature isn't set ($HYFOCUS_SOCKET overrides).\n",
+          stderr);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage();
+        return 2;
+    }
+
+    std::string command = argv[1];
+
+    if (command == "status") {
+        return runRequest("status", false);
+    }
+
+    if (command == "stats" && argc <= 3) {
+        return runRequest(argc == 3 ? std::string("stats ") + argv[2] : "stats", false);
+    }
+
+    if (command == "send" && argc >= 3) {
+        std::string request;
+        for (int i = 2; i < argc; i++) {
+            if (i > 2) request += ' ';
+            request += argv[i];
+        }
+        return runRequest(request, false);
+    }
+
+    if (command == "subscribe" && argc == 3) {
+        return runRequest(std::string("subscribe ") + argv[2], true);
+    }
+
+    if (command == "watch" && argc >= 3) {
+        std::string fmt = argv[2];
+        bool minutesOnly = (argc >= 4 && std::string(argv[3]) == "--minutes");
+        if (fmt == "waybar") return runWatch(BarFormat::Waybar, minutesOnly);
+        if (fmt == "i3bar") return runWatch(BarFormat::I3bar, minutesOnly);
+        if (fmt == "polybar") return runWatch(BarFormat::Polybar, minutesOnly);
+    }
+
+    usage();
+    return 2;
+}
@@ -0,0 +1,74 @@
+#include "ActivityEstimator.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+void ActivityEstimator::configure(int graceMinutes, int maxExtensions, int inputsPerMinute) {
+    m_graceSecs = std::max(0, graceMinutes) * 60;
+    m_maxExtensions = std::max(0, maxExtensions);
+    m_threshold = std::max(1, inputsPerMinute);
+
+    if (graceMinutes > 0) {
+        FE_INFO("Flow extensions: +{}min up to {}x at {} inputs/min", graceMinutes, maxExtensions, inputsPerMinute);
+    }
+}
+
+void ActivityEstimator::sample(Clock::time_point now) {
+    if (m_graceSecs.load(std::memory_order_relaxed) == 0 ||
+        (m_lastSample != Clock::time_point{} && now - m_lastSample < SAMPLE_PERIOD)) {
+        return;
+    }
+    update(now);
+}
+
+void ActivityEstimator::update(Clock::time_point now) {
+    uint64_t inputs = m_keys.load(std::memory_order_relaxed) + m_pointer.load(std::memory_order_relaxed);
+    uint64_t switches = m_switches.load(std::memory_order_relaxed);
+
+    // First sample only sets the baseline
+    if (m_lastSample == Clock::time_point{}) {
+        m_lastSample = now;
+        m_lastInputs = inputs;
+        m_lastSwitches = switches;
+        return;
+    }
+
+    double dt = std::chrono::duration<double>(now - m_lastSample).count();
+    if (dt < 1.0) {
+        return;
+    }
+
+    // Irregular spacing (pauses, late ticks) is handled by weighting with dt
+    double alpha = 1.0 - std::exp(-dt / TIME_CONSTANT_SECS);
+    m_inputRate += alpha * ((inputs - m_lastInputs) * 60.0 / dt - m_inputRate);
+    m_switchRate += alpha * ((switches - m_lastSwitches) * 60.0 / dt - m_switchRate);
+
+    m_lastSample = now;
+    m_lastInputs = inputs;
+    m_lastSwitches = switches;
+}
+
+int ActivityEstimator::decideExtension(Clock::time_point now) {
+    int grace = m_graceSecs.load(std::memory_order_relaxed);
+    if (grace == 0 || m_extensions.load(std::memory_order_relaxed) >= m_maxExtensions.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+
+    // Count whatever came in since the last periodic sample
+    update(now);
+
+    bool flowing = m_inputRate >= m_threshold.load(std::memory_order_relaxed) && m_switchRate <= MAX_SWITCHES_PER_MIN;
+    FE_INFO("Work interval ending: {} -> {}", describe(), flowing ? "in flow, extending" : "break");
+    if (!flowing) {
+        return 0;
+    }
+
+    m_extensions.fetch_add(1, std::memory_order_relaxed);
+    return grace;
+}
+
+std::string ActivityEstimator::describe() const {
+    char text[64];
+    snprintf(text, sizeof(text), "%.0f inputs/min, %.1f switches/min", m_inputRate, m_switchRate);
+    return text;
+}
@@ -0,0 +1,62 @@
+// ActivityEstimator - guesses whether the user is in flow from input rates
+#pragma once
+
+#include "globals.hpp"
+#include <atomic>
+#include <chrono>
+
+// Input callbacks only bump relaxed counters. The timer thread folds them
+// into exponentially weighted per-minute rates at most every SAMPLE_PERIOD
+// from its existing one-second tick, and the extend-or-break decision is
+// made once, when a work interval runs out.
+//
+// Flow means steady typing/clicking (keys plus pointer buttons and scroll
+// notches) without hopping between windows; pointer motion isn't counted.
+class ActivityEstimator {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::seconds SAMPLE_PERIOD{10};
+    static constexpr double TIME_CONSTANT_SECS = 120.0;
+    static constexpr double MAX_SWITCHES_PER_MIN = 4.0;
+
+    ActivityEstimator() = default;
+
+    // graceMinutes = 0 turns extensions off
+    void configure(int graceMinutes, int maxExtensions, int inputsPerMinute);
+
+    // Compositor thread, once per event
+    void noteKey() { m_keys.fetch_add(1, std::memory_order_relaxed); }
+    void notePointer() { m_pointer.fetch_add(1, std::memory_order_relaxed); }
+    void noteFocusSwitch() { m_switches.fetch_add(1, std::memory_order_relaxed); }
+
+    // Timer thread
+    void sample(Clock::time_point now = Clock::now());
+    void onWorkStart() { m_extensions.store(0, std::memory_order_relaxed); }
+    // At the end of a work interval: seconds to keep working, or 0 for the break
+    int decideExtension(Clock::time_point now = Clock::now());
+    // "43 inputs/min, 1.2 switches/min"
+    std::string describe() const;
+
+private:
+    void update(Clock::time_point now);
+
+    std::atomic<uint64_t> m_keys{0};
+    std::atomic<uint64_t> m_pointer{0};
+    std::atomic<uint64_t> m_switches{0};
+
+    // Timer thread only
+    Clock::time_point m_lastSample{};
+    uint64_t m_lastInputs{0};
+    uint64_t m_lastSwitches{0};
+    double m_inputRate{0};    // per minute
+    double m_switchRate{0};   // per minute
+
+    // Reset from the work-start callback, which also runs on the compositor
+    // thread when a room or align() moves the timer
+    std::atomic<int> m_extensions{0};
+
+    std::atomic<int> m_graceSecs{0};
+    std::atomic<int> m_maxExtensions{2};
+    std::atomic<int> m_threshold{40};
+};
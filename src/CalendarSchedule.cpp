@@ -0,0 +1,240 @@
+#include "CalendarSchedule.hpp"
+#include "dispatchers.hpp"
+#include "MainThreadExecutor.hpp"
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
+// How far ahead occurrences are expanded, and how often that is redone
+// when the file doesn't change
+static constexpr int64_t HORIZON_SECONDS = 7 * 24 * 3600;
+static constexpr int64_t REEXPAND_SECONDS = 3600;
+
+// Wall-clock deadlines on a monotonic timer: re-check at least this often
+// so suspend or clock changes can't make us miss a block by much
+static constexpr int64_t MAX_TIMER_MS = 60 * 1000;
+
+// Sync tools often write a file in several steps; wait for them to settle
+static constexpr int SETTLE_MS = 100;
+
+static std::atomic<uint64_t> s_generation{0};
+
+CalendarSchedule::~CalendarSchedule() {
+    stop();
+}
+
+bool CalendarSchedule::start(const std::string& path, const std::string& tag) {
+    if (m_running) {
+        return true;
+    }
+    if (!g_pCompositor || !g_pCompositor->m_wlEventLoop) {
+        return false;
+    }
+
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_timer = wl_event_loop_add_timer(g_pCompositor->m_wlEventLoop, &CalendarSchedule::onTimer, this);
+    if (m_inotifyFd < 0 || m_wakeFd < 0 || !m_timer) {
+        FE_ERR("Calendar: cannot set up watcher: {}", strerror(errno));
+        stop();
+        return false;
+    }
+
+    // Watch the directory: sync tools usually replace the file by renaming
+    // a new one over it, which a watch on the file itself would not survive
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    if (inotify_add_watch(m_inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) < 0) {
+        FE_WARN("Calendar: cannot watch {}: {}, changes need a config reload", dir, strerror(errno));
+    }
+
+    m_path = path;
+    m_tag = tag;
+    m_generation = ++s_generation;
+    m_running = true;
+    m_thread = std::thread(&CalendarSchedule::run, this);
+
+    FE_INFO("Calendar: following '{}' events in {}", m_tag, m_path);
+    return true;
+}
+
+void CalendarSchedule::stop() {
+    if (m_running.exchange(false)) {
+        uint64_t one = 1;
+        (void)write(m_wakeFd, &one, sizeof(one));
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    for (int* fd : {&m_inotifyFd, &m_wakeFd}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+    if (m_timer) {
+        wl_event_source_remove(m_timer);
+        m_timer = nullptr;
+    }
+
+    // Blocks still in flight from the worker are for the old generation
+    m_generation = 0;
+    m_queue.clear();
+    m_sessionEnd = 0;
+}
+
+void CalendarSchedule::run() {
+    // Re-indexing a large calendar is batch work
+    applyThreadQos(WorkQos::Background);
+
+    IcsCalendar calendar(m_tag);
+    std::string base = m_path.substr(m_path.rfind('/') + 1);
+    const uint64_t generation = m_generation;
+
+    bool dirty = true;
+    int64_t nextExpand = 0;
+    pollfd fds[2] = {{m_wakeFd, POLLIN, 0}, {m_inotifyFd, POLLIN, 0}};
+
+    while (m_running) {
+        int64_t now = time(nullptr);
+
+        if (dirty) {
+            dirty = false;
+            auto t0 = std::chrono::steady_clock::now();
+            std::string error;
+            if (calendar.load(m_path, error)) {
+                auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+                const auto& stats = calendar.lastLoad();
+                FE_INFO("Calendar: {} focus events, {} of {} VEVENTs parsed in {:.2f} ms", stats.events,
+                        stats.parsed, stats.blocks, ms);
+            } else {
+                // Keep the last good index; the file may be mid-replace
+                FE_WARN("Calendar: {}", error);
+            }
+            nextExpand = 0;
+        }
+
+        if (now >= nextExpand) {
+            auto blocks = calendar.expand(now, now + HORIZON_SECONDS);
+            runOnMainThread([generation, blocks = std::move(blocks)]() mutable {
+                if (g_fe_calendar) g_fe_calendar->setBlocks(generation, std::move(blocks));
+            });
+            nextExpand = now + REEXPAND_SECONDS;
+        }
+
+        int timeout = static_cast<int>(std::max<int64_t>(0, nextExpand - now) * 1000);
+        if (poll(fds, 2, timeout) < 0) {
+            if (errno == EINTR) continue;
+            FE_ERR("Calendar poll() failed: {}", strerror(errno));
+            return;
+        }
+        if (!(fds[1].revents & POLLIN)) {
+            continue;
+        }
+
+        // Drain, then keep draining until the writer has been quiet for a bit
+        alignas(inotify_event) char buf[4096];
+        do {
+            ssize_t n;
+            while ((n = read(m_inotifyFd, buf, sizeof(buf))) > 0) {
+                for (char* p = buf; p < buf + n;) {
+                    auto* event = reinterpret_cast<inotify_event*>(p);
+                    if (event->len > 0 && base == event->name) {
+                        dirty = true;
+                    }
+                    p += sizeof(inotify_event) + event->len;
+                }
+            }
+        } while (dirty && m_running && poll(&fds[1], 1, SETTLE_MS) > 0);
+    }
+}
+
+void CalendarSchedule::setBlocks(uint64_t generation, std::vector<FocusBlock> blocks) {
+    if (generation != m_generation) {
+        return;
+    }
+
+    // Blocks that already fired stay fired, even if the file was rewritten
+    // while they run (e.g. stopping a calendar session shouldn't restart it)
+    m_queue.clear();
+    for (auto& block : blocks) {
+        if (block.start > m_lastFired) {
+            m_queue.push_back(std::move(block));
+        }
+    }
+    arm();
+}
+
+int CalendarSchedule::onTimer(void* data) {
+    static_cast<CalendarSchedule*>(data)->fire();
+    return 0;
+}
+
+void CalendarSchedule::fire() {
+    int64_t now = time(nullptr);
+
+    if (m_sessionEnd && now >= m_sessionEnd) {
+        m_sessionEnd = 0;
+        // The block ran its course, same as a timer running out
+        if (g_fe_is_session_active.load()) {
+            completeSession();
+        }
+    }
+
+    while (!m_queue.empty() && m_queue.front().end <= now) {
+        m_queue.pop_front();
+    }
+
+    if (!m_queue.empty() && m_queue.front().start <= now) {
+        FocusBlock block = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_lastFired = block.start;
+
+        if (g_fe_is_session_active.load()) {
+            FE_INFO("Calendar block '{}' starts during a session, leaving it alone", block.title);
+        } else {
+            std::vector<WORKSPACEID> workspaces(block.workspaces.begin(), block.workspaces.end());
+            if (workspaces.empty()) {
+                auto focusState = Desktop::focusState();
+                auto pMonitor = focusState ? focusState->monitor() : nullptr;
+                if (pMonitor && pMonitor->m_activeWorkspace) {
+                    workspaces.push_back(pMonitor->m_activeWorkspace->m_id);
+                }
+            }
+
+            // Joined late (plugin load, resume): only what is left of the block
+            int minutes = static_cast<int>(std::max<int64_t>(1, (block.end - now + 59) / 60));
+            if (!workspaces.empty() && beginSession(workspaces, minutes)) {
+                m_sessionEnd = block.end;
+                showNotification("Calendar: " + block.title + " (" + std::to_string(minutes) + " min)",
+                                 {0.2, 0.6, 1.0, 1.0});
+            } else {
+                FE_WARN("Calendar block '{}': could not start a session", block.title);
+            }
+        }
+    }
+
+    arm();
+}
+
+void CalendarSchedule::arm() {
+    if (!m_timer) {
+        return;
+    }
+
+    int64_t due = INT64_MAX;
+    if (m_sessionEnd) {
+        due = m_sessionEnd;
+    }
+    if (!m_queue.empty()) {
+        due = std::min(due, m_queue.front().start);
+    }
+    if (due == INT64_MAX) {
+        wl_event_source_timer_update(m_timer, 0);  // disarm
+        return;
+    }
+
+    int64_t delayMs = (due - time(nullptr)) * 1000;
+    wl_event_source_timer_update(m_timer, static_cast<int>(std::clamp<int64_t>(delayMs, 1, MAX_TIMER_MS)));
+}
@@ -0,0 +1,57 @@
+// CalendarSchedule - starts focus sessions for calendar blocks
+#pragma once
+
+#include "globals.hpp"
+#include "IcsCalendar.hpp"
+#include <deque>
+
+// A worker thread owns the IcsCalendar: it watches the file with inotify,
+// re-indexes it after each write (only changed VEVENTs are parsed again)
+// and expands the next HORIZON of occurrences. The result is handed to the
+// compositor thread, which keeps it as a queue and arms one event-loop
+// timer for whatever comes next. When a block starts and no session is
+// running, one is started for the block's length; when it ends, a session
+// the calendar started is stopped again.
+class CalendarSchedule {
+public:
+    CalendarSchedule() = default;
+    ~CalendarSchedule();
+
+    CalendarSchedule(const CalendarSchedule&) = delete;
+    CalendarSchedule& operator=(const CalendarSchedule&) = delete;
+
+    bool start(const std::string& path, const std::string& tag);
+    void stop();
+
+    const std::string& path() const { return m_path; }
+    const std::string& tag() const { return m_tag; }
+
+    // Compositor thread. Blocks come from the worker tagged with the
+    // generation that produced them, so a restart drops stale ones.
+    void setBlocks(uint64_t generation, std::vector<FocusBlock> blocks);
+    const FocusBlock* next() const { return m_queue.empty() ? nullptr : &m_queue.front(); }
+
+    // Any session end; a session started by hand is never ours to stop
+    void onSessionEnded() { m_sessionEnd = 0; }
+
+private:
+    void run();
+    static int onTimer(void* data);
+    void fire();
+    void arm();
+
+    std::string m_path;
+    std::string m_tag;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    int m_inotifyFd{-1};
+    int m_wakeFd{-1};
+
+    // Compositor thread only
+    uint64_t m_generation{0};
+    wl_event_source* m_timer{nullptr};
+    std::deque<FocusBlock> m_queue;
+    int64_t m_lastFired{0};   // start of the last block handled
+    int64_t m_sessionEnd{0};  // end of the block whose session we started, 0 = none
+};
@@ -0,0 +1,71 @@
+#include "Checkpoint.hpp"
+#include <cerrno>
+#include <cstring>
+
+Checkpoint::Checkpoint(std::string path) : m_path(std::move(path)) {}
+
+std::string Checkpoint::defaultPath() {
+    const char* stateHome = getenv("XDG_STATE_HOME");
+    if (stateHome && *stateHome) {
+        return std::string(stateHome) + "/hyfocus/checkpoint";
+    }
+
+    const char* home = getenv("HOME");
+    if (!home) home = "/tmp";
+    return std::string(home) + "/.local/state/hyfocus/checkpoint";
+}
+
+bool Checkpoint::load() {
+    m_sections.clear();
+
+    std::ifstream f(m_path);
+    if (!f.is_open()) {
+        FE_DEBUG("No checkpoint at {}", m_path);
+        return false;
+    }
+
+    std::string line;
+    std::vector<std::string>* current = nullptr;
+    while (std::getline(f, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        if (line.front() == '[' && line.back() == ']') {
+            current = &m_sections[line.substr(1, line.size() - 2)];
+            continue;
+        }
+        if (current) {
+            current->push_back(line);
+        }
+    }
+
+    FE_DEBUG("Loaded checkpoint {} ({} sections)", m_path, m_sections.size());
+    return true;
+}
+
+void Checkpoint::save() const {
+    std::string data;
+    for (const auto& [name, records] : m_sections) {
+        data += '[' + name + "]\n";
+        for (const auto& record : records) {
+            data += record + '\n';
+        }
+    }
+
+    // tmp + fsync + rename on the I/O thread; the result comes back here
+    ioReplace(m_path, std::move(data), true, [path = m_path](int error) {
+        if (error) {
+            FE_WARN("Failed to write checkpoint {}: {}", path, strerror(error));
+        }
+    });
+}
+
+const std::vector<std::string>& Checkpoint::section(const std::string& name) const {
+    static const std::vector<std::string> empty;
+    auto it = m_sections.find(name);
+    return it != m_sections.end() ? it->second : empty;
+}
+
+void Checkpoint::setSection(const std::string& name, std::vector<std::string> records) {
+    m_sections[name] = std::move(records);
+}
@@ -0,0 +1,36 @@
+// Checkpoint - small on-disk record of state that must survive a plugin reload
+#pragma once
+
+#include "globals.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+// Plain text, one section per subsystem:
+//
+//   [budgets]
+//   ws:4 day 240000 20261018
+//
+// Each subsystem owns the record format of its own section; the checkpoint
+// only groups lines and writes the file atomically (tmp + rename).
+class Checkpoint {
+public:
+    explicit Checkpoint(std::string path = defaultPath());
+
+    bool load();
+
+    // Queues the write with the I/O service; failures are logged when it lands
+    void save() const;
+
+    const std::vector<std::string>& section(const std::string& name) const;
+    void setSection(const std::string& name, std::vector<std::string> records);
+
+    const std::string& path() const { return m_path; }
+
+    // $XDG_STATE_HOME/hyfocus/checkpoint (falls back to ~/.local/state)
+    static std::string defaultPath();
+
+private:
+    std::string m_path;
+    std::map<std::string, std::vector<std::string>> m_sections;
+};
@@ -0,0 +1,375 @@
+#include "Dashboard.hpp"
+#include "FocusStats.hpp"
+#include "Metrics.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+static constexpr size_t CHUNK_BYTES = 16 * 1024;
+
+static const char* DASHBOARD_HTML = R"HTML(<!doctype html>
+<html><head><meta charset="utf-8"><title>HyFocus</title>
+<style>
+body { font: 14px system-ui, sans-serif; background: #1e1e2e; color: #cdd6f4; margin: 2em; }
+h1 { font-size: 20px; }
+h2 { font-size: 15px; margin-top: 2em; color: #a6adc8; font-weight: normal; }
+.cards { display: flex; gap: 1em; }
+.card { background: #313244; padding: 1em 1.5em; border-radius: 8px; }
+.card b { display: block; font-size: 22px; }
+#heat { display: grid; grid-auto-flow: column; grid-template-rows: repeat(7, 12px); gap: 3px; }
+#week { display: grid; grid-template-columns: repeat(24, 12px); gap: 3px; }
+#heat div, #week div { width: 12px; height: 12px; border-radius: 2px; background: #313244; }
+td, th { padding: 4px 12px 4px 0; text-align: left; }
+th { color: #a6adc8; font-weight: normal; }
+</style></head><body>
+<h1>HyFocus</h1>
+<div class="cards">
+  <div class="card"><b id="today">-</b>minutes today</div>
+  <div class="card"><b id="streak">-</b>day streak</div>
+  <div class="card"><b id="best">-</b>best streak</div>
+</div>
+<h2>Last year</h2><div id="heat"></div>
+<h2>Hour of the week</h2><div id="week"></div>
+<h2>Tags, last 30 days</h2><table id="tags"></table>
+<h2>Machines</h2><table id="hosts"></table>
+<script>
+const esc = s => String(s).replace(/[&<>"]/g, c => '&#' + c.charCodeAt(0) + ';');
+const hm = s => Math.floor(s / 3600) + 'h' + String(Math.floor(s / 60) % 60).padStart(2, '0') + 'm';
+const day = t => { const d = new Date(t); return d.getFullYear() + '-' + String(d.getMonth() + 1).padStart(2, '0') + '-' + String(d.getDate()).padStart(2, '0'); };
+function cells(el, values, title) {
+  const max = Math.max(1, ...values);
+  values.forEach((v, i) => {
+    const d = document.createElement('div');
+    if (v > 0) d.style.background = `rgba(137, 180, 250, ${0.2 + 0.8 * v / max})`;
+    d.title = title(i, v);
+    el.appendChild(d);
+  });
+}
+function rows(el, head, items) {
+  el.innerHTML = '<tr>' + head.map(h => `<th>${h}</th>`).join('') + '</tr>' +
+    items.map(r => '<tr>' + r.map(c => `<td>${esc(c)}</td>`).join('') + '</tr>').join('');
+}
+fetch('api/stats').then(r => r.json()).then(s => {
+  today.textContent = s.today + ' / ' + s.goal;
+  streak.textContent = s.streak;
+  best.textContent = s.best_streak;
+  const first = Date.now() - (s.minutes.length - 1) * 864e5;
+  const pad = (new Date(first).getDay() + 6) % 7;  // columns start on Monday
+  cells(heat, Array(pad).fill(0).concat(s.minutes), (i, v) => i < pad ? '' : day(first + (i - pad) * 864e5) + ': ' + v + ' min');
+  const names = ['Mon', 'Tue', 'Wed', 'Thu', 'Fri', 'Sat', 'Sun'];
+  cells(week, s.hour_of_week, (i, v) => names[Math.floor(i / 24)] + ' ' + (i % 24) + ':00: ' + v + ' min');
+});
+fetch('api/tags?from=' + day(Date.now() - 29 * 864e5)).then(r => r.json()).then(j =>
+  rows(tags, ['Tag', 'Time', 'Sessions'], j.tags.map(t => ['#' + t.tag, hm(t.work_secs), t.sessions])));
+fetch('api/days').then(r => r.json()).then(j =>
+  rows(hosts, ['Host', 'Time', 'Sessions'], j.hosts.map(h => [h.host, hm(h.work_secs), h.sessions])));
+</script>
+</body></html>
+)HTML";
+
+static bool sendAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t n = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        data.remove_prefix(n);
+    }
+    return true;
+}
+
+static void sendResponse(int fd, const std::string& status, const std::string& type, const std::string& body) {
+    sendAll(fd, "HTTP/1.1 " + status + "\r\nContent-Type: " + type + "\r\nContent-Length: " +
+                    std::to_string(body.size()) + "\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n" + body);
+}
+
+// Transfer-Encoding: chunked, in CHUNK_BYTES pieces
+class ChunkedBody {
+public:
+    ChunkedBody(int fd, const std::string& type) : m_fd(fd) {
+        m_ok = sendAll(fd, "HTTP/1.1 200 OK\r\nContent-Type: " + type +
+                               "\r\nTransfer-Encoding: chunked\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n");
+    }
+
+    void write(std::string_view data) {
+        m_buffer += data;
+        if (m_buffer.size() >= CHUNK_BYTES) {
+            flush();
+        }
+    }
+
+    void finish() {
+        flush();
+        if (m_ok) {
+            sendAll(m_fd, "0\r\n\r\n");
+        }
+    }
+
+private:
+    void flush() {
+        if (m_buffer.empty() || !m_ok) {
+            m_buffer.clear();
+            return;
+        }
+        char size[16];
+        snprintf(size, sizeof(size), "%zx\r\n", m_buffer.size());
+        m_buffer += "\r\n";
+        m_ok = sendAll(m_fd, size) && sendAll(m_fd, m_buffer);
+        m_buffer.clear();
+    }
+
+    int m_fd;
+    bool m_ok{false};
+    std::string m_buffer;
+};
+
+// Value of `key` in "a=1&b=2", empty if absent
+static std::string queryParam(const std::string& query, const std::string& key) {
+    size_t pos = 0;
+    while (pos <= query.size()) {
+        size_t end = query.find('&', pos);
+        if (end == std::string::npos) end = query.size();
+        std::string pair = query.substr(pos, end - pos);
+        if (pair.starts_with(key + "=")) {
+            return pair.substr(key.size() + 1);
+        }
+        pos = end + 1;
+    }
+    return "";
+}
+
+// Host header of an HTTP request, lowercased; empty if absent
+static std::string hostHeader(const std::string& request) {
+    size_t pos = 0;
+    while ((pos = request.find("\r\n", pos)) != std::string::npos) {
+        pos += 2;
+        size_t end = request.find("\r\n", pos);
+        std::string line = request.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+        if (line.empty()) {
+            break;
+        }
+        std::transform(line.begin(), line.end(), line.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (line.starts_with("host:")) {
+            size_t first = line.find_first_not_of(" \t", 5);
+            size_t last = line.find_last_not_of(" \t");
+            return first == std::string::npos ? "" : line.substr(first, last - first + 1);
+        }
+    }
+    return "";
+}
+
+DashboardServer::~DashboardServer() {
+    stop();
+}
+
+bool DashboardServer::start(const std::string& socketPath, int port, std::vector<std::string> historyRoots) {
+    if (m_running) {
+        return true;
+    }
+
+    if (!socketPath.empty()) {
+        m_unixFd = listenUnixSocket(socketPath);
+        if (m_unixFd >= 0) m_path = socketPath;
+    }
+    if (port > 0 && port < 65536) {
+        m_tcpFd = listenLoopbackPort(port);
+    }
+    if (m_unixFd < 0 && m_tcpFd < 0) {
+        return false;
+    }
+
+    m_roots = std::move(historyRoots);
+    m_port = port;
+    // Not hyfocus-history's state file: the two would overwrite each other
+    m_statePath = HistoryMerger::defaultStatePath() + "-dashboard";
+    // Without it stop() could never wake the thread to join it
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0) {
+        FE_ERR("Dashboard: cannot create wake fd: {}", strerror(errno));
+        stop();
+        return false;
+    }
+    m_running = true;
+    m_thread = std::thread(&DashboardServer::run, this);
+
+    FE_INFO("Dashboard served on {}{}{}", m_path, (m_unixFd >= 0 && m_tcpFd >= 0) ? " and " : "",
+            m_tcpFd >= 0 ? "http://127.0.0.1:" + std::to_string(port) + "/" : "");
+    return true;
+}
+
+void DashboardServer::stop() {
+    if (m_running.exchange(false)) {
+        uint64_t one = 1;
+        (void)write(m_wakeFd, &one, sizeof(one));
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    for (int* fd : {&m_unixFd, &m_tcpFd, &m_wakeFd}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+    if (!m_path.empty()) {
+        unlink(m_path.c_str());
+        m_path.clear();
+    }
+}
+
+void DashboardServer::run() {
+    // Rendering a dashboard is never worth a dropped frame
+    applyThreadQos(WorkQos::Idle);
+
+    pollfd fds[3] = {{m_wakeFd, POLLIN, 0}, {m_unixFd, POLLIN, 0}, {m_tcpFd, POLLIN, 0}};
+
+    while (m_running) {
+        if (poll(fds, 3, -1) < 0) {
+            if (errno == EINTR) continue;
+            FE_ERR("Dashboard poll() failed: {}", strerror(errno));
+            return;
+        }
+
+        for (size_t i = 1; i < 3; i++) {
+            if (fds[i].fd < 0 || !(fds[i].revents & POLLIN)) {
+                continue;
+            }
+            int clientFd = accept4(fds[i].fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (clientFd >= 0) {
+                serve(clientFd, fds[i].fd == m_tcpFd);
+                close(clientFd);
+            }
+        }
+    }
+}
+
+void DashboardServer::refreshHistory() {
+    auto now = std::chrono::steady_clock::now();
+    if (m_stateLoaded && now - m_lastRefresh < REFRESH_PERIOD) {
+        return;
+    }
+    m_lastRefresh = now;
+
+    std::string error;
+    if (!m_stateLoaded) {
+        m_stateLoaded = true;
+        if (!m_merger.loadState(m_statePath, error)) {
+            FE_WARN("Dashboard: {}, merging history from scratch", error);
+            m_merger = HistoryMerger();
+        }
+    }
+
+    HistoryMergeStats stats = m_merger.run(m_roots);
+    if (stats.bytes > 0) {
+        FE_DEBUG("Dashboard: merged {} new sessions from {} segments", stats.merged, stats.segments);
+        if (!m_merger.saveState(m_statePath, error)) {
+            FE_WARN("Dashboard: {}", error);
+        }
+    }
+}
+
+bool DashboardServer::isLoopbackHost(const std::string& host) const {
+    std::string port = ":" + std::to_string(m_port);
+    for (const char* name : {"localhost", "127.0.0.1", "[::1]"}) {
+        if (host == name || host == name + port) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void DashboardServer::serve(int fd, bool tcp) {
+    // Browsers send a short request; don't let a silent one hold the thread
+    timeval timeout{1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buf[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        request.append(buf, n);
+    }
+
+    if (!request.starts_with("GET ")) {
+        sendResponse(fd, "405 Method Not Allowed", "text/plain", "GET only\n");
+        return;
+    }
+
+    // A page on any site can reach 127.0.0.1 through a name that rebinds to
+    // it; only a request addressed to loopback by name is ours to answer
+    if (tcp && !isLoopbackHost(hostHeader(request))) {
+        sendResponse(fd, "403 Forbidden", "text/plain", "Host must be localhost or 127.0.0.1\n");
+        return;
+    }
+
+    // "GET /api/tags?from=2026-10-01 HTTP/1.1"
+    size_t targetEnd = request.find(' ', 4);
+    std::string target = request.substr(4, targetEnd == std::string::npos ? std::string::npos : targetEnd - 4);
+    size_t question = target.find('?');
+    std::string path = target.substr(0, question);
+    std::string query = question == std::string::npos ? "" : target.substr(question + 1);
+
+    if (path == "/" || path == "/index.html") {
+        sendResponse(fd, "200 OK", "text/html; charset=utf-8", DASHBOARD_HTML);
+        return;
+    }
+
+    if (path == "/api/stats") {
+        if (!g_fe_stats) {
+            sendResponse(fd, "503 Service Unavailable", "text/plain", "stats unavailable\n");
+            return;
+        }
+        std::string days = queryParam(query, "days");
+        int count = FocusStats::HEATMAP_DAYS;
+        if (!days.empty()) {
+            count = atoi(days.c_str());
+        }
+        sendResponse(fd, "200 OK", "application/json", g_fe_stats->toJson(count));
+        return;
+    }
+
+    if (path != "/api/days" && path != "/api/tags" && path != "/api/sessions") {
+        sendResponse(fd, "404 Not Found", "text/plain", "not found\n");
+        return;
+    }
+
+    int64_t from = INT64_MIN;
+    int64_t to = INT64_MAX;
+    std::string fromText = queryParam(query, "from");
+    std::string toText = queryParam(query, "to");
+    if ((!fromText.empty() && !parseLocalDate(fromText, false, from)) || (!toText.empty() && !parseLocalDate(toText, true, to))) {
+        sendResponse(fd, "400 Bad Request", "text/plain", "from/to must be YYYY-MM-DD\n");
+        return;
+    }
+
+    refreshHistory();
+
+    ChunkedBody body(fd, "application/json");
+    auto sink = [&body](std::string_view piece) { body.write(piece); };
+    if (path == "/api/days") {
+        writeRollupJson(m_merger, sink, from == INT64_MIN ? 0 : localDateOf(from),
+                        to == INT64_MAX ? 99999999 : localDateOf(to - 1));
+    } else if (path == "/api/tags") {
+        writeTagJson(m_merger.allTagTotals(from, to), sink);
+    } else {
+        body.write("{\"sessions\": [");
+        bool first = true;
+        for (const auto& session : m_merger.sessions()) {
+            if (session.start < from || session.start >= to) {
+                continue;
+            }
+            body.write(std::string(first ? "" : ",") + "[" + std::to_string(session.start) + "," +
+                       std::to_string(session.workSecs) + "," + (session.completed ? "1" : "0") + "]");
+            first = false;
+        }
+        body.write("]}");
+    }
+    body.finish();
+}
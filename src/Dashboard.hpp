@@ -0,0 +1,66 @@
+// Dashboard - read-only focus history in a browser, over local HTTP
+#pragma once
+
+#include "globals.hpp"
+#include "FocusHistory.hpp"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Off unless dashboard_socket or dashboard_port is set. Like the metrics
+// endpoint it listens on a Unix socket and/or a loopback port, serves one
+// request per connection from its own thread, and never binds anything but
+// 127.0.0.1. Requests over TCP must name localhost, 127.0.0.1 or [::1] in
+// their Host header, so a rebinding DNS name can't read the history.
+//
+//   GET /                               the dashboard page
+//   GET /api/stats[?days=N]             FocusStats::toJson()
+//   GET /api/days[?from=&to=]           daily rollups, per-host totals
+//   GET /api/tags[?from=&to=]           per-tag totals, most time first
+//   GET /api/sessions[?from=&to=]       [[start, work_secs, completed], ...]
+//
+// from/to are inclusive local dates (YYYY-MM-DD). List responses are
+// streamed with chunked encoding as they are rendered.
+//
+// The thread runs at SCHED_IDLE. It only reads the history files (merged
+// incrementally, at most every REFRESH_PERIOD, into a state file of its own
+// next to hyfocus-history's) and FocusStats, which has its own lock - nothing is
+// posted to or waited for on the compositor thread.
+class DashboardServer {
+public:
+    static constexpr std::chrono::seconds REFRESH_PERIOD{30};
+
+    DashboardServer() = default;
+    ~DashboardServer();
+
+    DashboardServer(const DashboardServer&) = delete;
+    DashboardServer& operator=(const DashboardServer&) = delete;
+
+    // Empty path / port 0 disables that listener; false if nothing listens
+    bool start(const std::string& socketPath, int port, std::vector<std::string> historyRoots);
+    void stop();
+
+private:
+    void run();
+    // tcp: check the Host header (DNS rebinding)
+    void serve(int fd, bool tcp);
+    bool isLoopbackHost(const std::string& host) const;
+    void refreshHistory();
+
+    int m_unixFd{-1};
+    int m_tcpFd{-1};
+    int m_wakeFd{-1};
+    int m_port{0};
+    std::string m_path;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+
+    // Dashboard thread only
+    std::vector<std::string> m_roots;
+    std::string m_statePath;
+    HistoryMerger m_merger;
+    bool m_stateLoaded{false};
+    std::chrono::steady_clock::time_point m_lastRefresh{};
+};
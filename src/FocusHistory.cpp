@@ -0,0 +1,694 @@
+#include "FocusHistory.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t UUID_DIGITS = 32;
+constexpr int SEEN_PER_LINE = 8;
+constexpr const char* TAG_DICTIONARY = "tags.dict";
+
+// Stable across builds, unlike std::hash - the values are persisted
+uint64_t fnv1a(std::string_view text) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// YYYYMMDD of a timestamp in local time
+int localDate(int64_t when) {
+    time_t t = static_cast<time_t>(when);
+    std::tm local{};
+    localtime_r(&t, &local);
+    return (local.tm_year + 1900) * 10000 + (local.tm_mon + 1) * 100 + local.tm_mday;
+}
+
+bool nextField(std::string_view& line, std::string_view& field) {
+    size_t start = line.find_first_not_of(' ');
+    if (start == std::string_view::npos) {
+        return false;
+    }
+    line.remove_prefix(start);
+    size_t end = line.find(' ');
+    field = line.substr(0, end);
+    line.remove_prefix(end == std::string_view::npos ? line.size() : end);
+    return true;
+}
+
+template <typename T>
+bool nextNumber(std::string_view& line, T& value, int base = 10) {
+    std::string_view field;
+    if (!nextField(line, field)) {
+        return false;
+    }
+    auto [ptr, ec] = std::from_chars(field.data(), field.data() + field.size(), value, base);
+    return ec == std::errc() && ptr == field.data() + field.size();
+}
+
+// "<id> <name>" per line
+std::unordered_map<uint32_t, std::string> readTagDictionary(const fs::path& file) {
+    std::unordered_map<uint32_t, std::string> names;
+    std::ifstream in(file);
+    std::string text;
+    while (std::getline(in, text)) {
+        std::string_view line = text;
+        uint32_t id = 0;
+        std::string_view name;
+        if (nextNumber(line, id) && nextField(line, name)) {
+            names[id] = name;
+        }
+    }
+    return names;
+}
+
+bool writeAtomically(const std::string& path, const std::string& contents, std::string& error) {
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+
+    // A temporary of our own: two writers sharing one would rename a mix of both
+    std::string tmp = path + ".XXXXXX";
+    int fd = mkstemp(tmp.data());
+    if (fd < 0) {
+        error = tmp + ": " + strerror(errno);
+        return false;
+    }
+    size_t written = 0;
+    while (written < contents.size()) {
+        ssize_t n = write(fd, contents.data() + written, contents.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            error = tmp + ": " + strerror(errno);
+            close(fd);
+            unlink(tmp.c_str());
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    close(fd);
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        error = path + ": " + strerror(errno);
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Streams one host directory: its segments oldest first, one record at a time
+struct HostCursor {
+    std::string host;
+    fs::path dir;
+    std::vector<std::string> segments;
+    size_t nextSegment{0};
+    std::unordered_map<uint32_t, std::string> tagNames;
+    bool tagsLoaded{false};
+
+    std::ifstream in;
+    std::string path;  // segment `in` is reading
+    uint64_t offset{0};
+
+    SessionRecord current;
+
+    // Move `current` to the next complete, well-formed record
+    bool advance(std::unordered_map<std::string, uint64_t>& offsets, HistoryMergeStats& stats) {
+        std::string line;
+        while (true) {
+            if (!in.is_open()) {
+                if (nextSegment == segments.size()) {
+                    return false;
+                }
+                path = segments[nextSegment++];
+
+                auto known = offsets.find(path);
+                offset = known == offsets.end() ? 0 : known->second;
+                std::error_code ec;
+                uint64_t size = fs::file_size(path, ec);
+                if (ec || size == offset) {
+                    continue;  // nothing new: not even opened
+                }
+                if (size < offset) {
+                    offset = 0;  // replaced rather than appended to; UUIDs catch repeats
+                }
+
+                in.clear();
+                in.open(path, std::ios::binary);
+                in.seekg(static_cast<std::streamoff>(offset));
+                stats.segments++;
+            }
+
+            if (!std::getline(in, line) || in.eof()) {
+                // End of segment, or a last line the sync hasn't finished
+                in.close();
+                continue;
+            }
+
+            bool parsed = !line.empty() && line[0] != '#' && parseSessionRecord(line, current);
+            if (parsed && !resolveTags()) {
+                // Its dictionary line hasn't synced yet: stop this host here
+                // and pick the record up on a later run
+                stats.waiting++;
+                in.close();
+                nextSegment = segments.size();
+                return false;
+            }
+
+            offset += line.size() + 1;
+            offsets[path] = offset;
+            stats.bytes += line.size() + 1;
+
+            if (parsed) {
+                current.host = host;
+                return true;
+            }
+            if (!line.empty() && line[0] != '#') {
+                stats.malformed++;
+            }
+        }
+    }
+
+    bool resolveTags() {
+        current.tags.clear();
+        for (uint32_t id : current.tagIds) {
+            auto name = tagNames.find(id);
+            if (name == tagNames.end() && !tagsLoaded) {
+                // Read once per run, on the first tagged record
+                tagNames = readTagDictionary(dir / TAG_DICTIONARY);
+                tagsLoaded = true;
+                name = tagNames.find(id);
+            }
+            if (name == tagNames.end()) {
+                return false;
+            }
+            current.tags.push_back(name->second);
+        }
+        return true;
+    }
+};
+
+}  // namespace
+
+std::string formatSessionRecord(const SessionRecord& record) {
+    std::string line = std::to_string(record.start) + " " + std::to_string(record.end) + " " +
+                       std::to_string(record.workSecs) + " " + (record.completed ? "1" : "0") + " " + record.uuid;
+    for (size_t i = 0; i < record.tagIds.size(); i++) {
+        line += (i == 0 ? " " : ",") + std::to_string(record.tagIds[i]);
+    }
+    return line;
+}
+
+bool parseSessionRecord(std::string_view line, SessionRecord& out) {
+    int completed = 0;
+    std::string_view uuid;
+    if (!nextNumber(line, out.start) || !nextNumber(line, out.end) || !nextNumber(line, out.workSecs) ||
+        !nextNumber(line, completed) || !nextField(line, uuid)) {
+        return false;
+    }
+    if (uuid.size() != UUID_DIGITS || !std::all_of(uuid.begin(), uuid.end(), [](char c) { return isxdigit(static_cast<unsigned char>(c)); })) {
+        return false;
+    }
+    out.completed = completed != 0;
+    out.uuid = uuid;
+
+    out.tagIds.clear();
+    std::string_view ids;
+    if (nextField(line, ids)) {
+        while (!ids.empty()) {
+            size_t comma = ids.find(',');
+            std::string_view field = ids.substr(0, comma);
+            uint32_t id = 0;
+            if (!nextNumber(field, id)) {
+                return false;
+            }
+            out.tagIds.push_back(id);
+            ids.remove_prefix(comma == std::string_view::npos ? ids.size() : comma + 1);
+        }
+    }
+    return true;
+}
+
+std::vector<std::string> takeSessionTags(std::string& spec) {
+    std::vector<std::string> tags;
+    std::string rest;
+    std::istringstream words(spec);
+    std::string word;
+    while (words >> word) {
+        if (!word.starts_with('#')) {
+            rest += (rest.empty() ? "" : " ") + word;
+            continue;
+        }
+        std::string tag;
+        for (char c : word.substr(1)) {
+            c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+            if (isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-' || c == '.' || c == '/') {
+                tag += c;
+            }
+        }
+        if (!tag.empty() && std::find(tags.begin(), tags.end(), tag) == tags.end()) {
+            tags.push_back(tag);
+        }
+    }
+    spec = rest;
+    return tags;
+}
+
+std::string newSessionUuid() {
+    std::random_device random;
+    char text[UUID_DIGITS + 1];
+    for (size_t i = 0; i < UUID_DIGITS; i += 8) {
+        snprintf(text + i, 9, "%08x", static_cast<unsigned>(random()));
+    }
+    return text;
+}
+
+HistoryLog::HistoryLog(std::string root, std::string host) : m_root(std::move(root)), m_host(std::move(host)) {}
+
+std::string HistoryLog::defaultRoot() {
+    const char* stateHome = getenv("XDG_STATE_HOME");
+    if (stateHome && *stateHome) {
+        return std::string(stateHome) + "/hyfocus/history";
+    }
+
+    const char* home = getenv("HOME");
+    if (!home) home = "/tmp";
+    return std::string(home) + "/.local/state/hyfocus/history";
+}
+
+std::string HistoryLog::localHost() {
+    char name[256] = {};
+    if (gethostname(name, sizeof(name) - 1) != 0 || !*name) {
+        return "localhost";
+    }
+    std::string host = name;
+    std::replace(host.begin(), host.end(), '/', '_');
+    return host;
+}
+
+bool HistoryLog::append(const SessionRecord& record, std::string& error) {
+    fs::path dir = fs::path(m_root) / m_host;
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec) {
+        error = dir.string() + ": " + ec.message();
+        return false;
+    }
+
+    // Tags first, so no record ever points at a missing dictionary line
+    SessionRecord stored = record;
+    stored.tagIds.clear();
+    if (!record.tags.empty()) {
+        // Held from reading the highest ID until the new ones are written, so
+        // another instance (or tool) sharing this host directory can't hand
+        // out the same IDs
+        std::string dictionaryPath = (dir / TAG_DICTIONARY).string();
+        int lockFd = open(dictionaryPath.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+        if (lockFd < 0 || flock(lockFd, LOCK_EX) != 0) {
+            error = dictionaryPath + ": " + strerror(errno);
+            if (lockFd >= 0) close(lockFd);
+            return false;
+        }
+
+        auto names = readTagDictionary(dictionaryPath);
+        uint32_t nextId = 1;
+        for (const auto& [id, name] : names) {
+            nextId = std::max(nextId, id + 1);
+        }
+
+        std::string added;
+        for (const auto& tag : record.tags) {
+            auto known = std::find_if(names.begin(), names.end(), [&tag](const auto& entry) { return entry.second == tag; });
+            if (known != names.end()) {
+                stored.tagIds.push_back(known->first);
+                continue;
+            }
+            stored.tagIds.push_back(nextId);
+            names[nextId] = tag;
+            added += std::to_string(nextId++) + " " + tag + "\n";
+        }
+
+        bool ok = added.empty() || write(lockFd, added.data(), added.size()) == static_cast<ssize_t>(added.size());
+        if (!ok) {
+            error = dictionaryPath + ": " + strerror(errno);
+        }
+        flock(lockFd, LOCK_UN);
+        close(lockFd);
+        if (!ok) {
+            return false;
+        }
+    }
+
+    char segment[16];
+    snprintf(segment, sizeof(segment), "%08d.log", localDate(record.end));
+    std::string path = (dir / segment).string();
+
+    // One short O_APPEND write per session, so a reader never sees half a
+    // line from us (a sync tool copying the file still might)
+    std::string line = formatSessionRecord(stored) + "\n";
+    int fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    bool ok = write(fd, line.data(), line.size()) == static_cast<ssize_t>(line.size());
+    if (!ok) {
+        error = path + ": " + strerror(errno);
+    }
+    close(fd);
+    return ok;
+}
+
+void HistoryTotals::add(const SessionRecord& record) {
+    workSecs += record.workSecs;
+    sessions++;
+    completed += record.completed;
+}
+
+std::string HistoryMerger::defaultStatePath() {
+    const char* cacheHome = getenv("XDG_CACHE_HOME");
+    if (cacheHome && *cacheHome) {
+        return std::string(cacheHome) + "/hyfocus/history-merge";
+    }
+
+    const char* home = getenv("HOME");
+    if (!home) home = "/tmp";
+    return std::string(home) + "/.cache/hyfocus/history-merge";
+}
+
+bool HistoryMerger::loadState(const std::string& path, std::string& error) {
+    std::error_code ec;
+    if (!fs::exists(path, ec)) {
+        return true;
+    }
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+
+    std::string text;
+    while (std::getline(in, text)) {
+        std::string_view line = text;
+        std::string_view key;
+        if (!nextField(line, key) || key.starts_with('#')) {
+            continue;
+        }
+
+        bool ok = true;
+        if (key == "offset") {
+            uint64_t bytes = 0;
+            ok = nextNumber(line, bytes) && line.size() > 1;
+            if (ok) m_offsets[std::string(line.substr(1))] = bytes;
+        } else if (key == "seen") {
+            uint64_t hash = 0;
+            while (nextNumber(line, hash, 16)) {
+                m_seen.insert(hash);
+            }
+        } else if (key == "day") {
+            int date = 0;
+            HistoryTotals totals;
+            ok = nextNumber(line, date) && nextNumber(line, totals.workSecs) && nextNumber(line, totals.sessions) &&
+                 nextNumber(line, totals.completed);
+            if (ok) m_days[date] = totals;
+        } else if (key == "tag") {
+            uint32_t id = 0;
+            ok = nextNumber(line, id) && id == m_tagNames.size() && line.size() > 1;
+            if (ok) internTag(std::string(line.substr(1)));
+        } else if (key == "session") {
+            HistorySession session;
+            int completed = 0;
+            ok = nextNumber(line, session.start) && nextNumber(line, session.workSecs) && nextNumber(line, completed);
+            session.completed = completed != 0;
+            if (ok) m_sessions.push_back(session);
+        } else if (key == "postings") {
+            uint32_t id = 0;
+            ok = nextNumber(line, id) && id < m_postings.size();
+            std::string_view range;
+            while (ok && nextField(line, range)) {
+                size_t dash = range.find('-');
+                std::string_view first = range.substr(0, dash);
+                std::string_view last = dash == std::string_view::npos ? first : range.substr(dash + 1);
+                uint32_t a = 0, b = 0;
+                ok = nextNumber(first, a) && nextNumber(last, b) && a <= b && b < m_sessions.size();
+                if (ok) m_postings[id].emplace_back(a, b);
+            }
+        } else if (key == "host") {
+            HistoryTotals totals;
+            ok = nextNumber(line, totals.workSecs) && nextNumber(line, totals.sessions) &&
+                 nextNumber(line, totals.completed) && line.size() > 1;
+            if (ok) m_hosts[std::string(line.substr(1))] = totals;
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            error = path + ": bad line '" + text + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HistoryMerger::saveState(const std::string& path, std::string& error) const {
+    std::string out = "# hyfocus-history merge state, rewritten after every merge\n";
+    char hex[24];
+
+    for (const auto& [segment, bytes] : m_offsets) {
+        out += "offset " + std::to_string(bytes) + " " + segment + "\n";
+    }
+
+    int onLine = 0;
+    for (uint64_t hash : m_seen) {
+        snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+        out += (onLine == 0 ? "seen " : " ");
+        out += hex;
+        if (++onLine == SEEN_PER_LINE) {
+            out += "\n";
+            onLine = 0;
+        }
+    }
+    if (onLine) {
+        out += "\n";
+    }
+
+    for (const auto& [date, totals] : m_days) {
+        out += "day " + std::to_string(date) + " " + std::to_string(totals.workSecs) + " " +
+               std::to_string(totals.sessions) + " " + std::to_string(totals.completed) + "\n";
+    }
+    for (const auto& [host, totals] : m_hosts) {
+        out += "host " + std::to_string(totals.workSecs) + " " + std::to_string(totals.sessions) + " " +
+               std::to_string(totals.completed) + " " + host + "\n";
+    }
+
+    // Tag index: names by ID, then sessions by number, then each tag's ranges
+    for (size_t id = 0; id < m_tagNames.size(); id++) {
+        out += "tag " + std::to_string(id) + " " + m_tagNames[id] + "\n";
+    }
+    for (const auto& session : m_sessions) {
+        out += "session " + std::to_string(session.start) + " " + std::to_string(session.workSecs) + " " +
+               (session.completed ? "1" : "0") + "\n";
+    }
+    for (size_t id = 0; id < m_postings.size(); id++) {
+        out += "postings " + std::to_string(id);
+        for (const auto& [first, last] : m_postings[id]) {
+            out += " " + std::to_string(first);
+            if (last != first) {
+                out += "-" + std::to_string(last);
+            }
+        }
+        out += "\n";
+    }
+
+    return writeAtomically(path, out, error);
+}
+
+HistoryMergeStats HistoryMerger::run(const std::vector<std::string>& roots, const RecordCallback& onRecord) {
+    HistoryMergeStats stats;
+
+    std::vector<HostCursor> cursors;
+    for (const auto& root : roots) {
+        std::error_code ec;
+        for (const auto& hostDir : fs::directory_iterator(root, ec)) {
+            if (!hostDir.is_directory(ec)) {
+                continue;
+            }
+            HostCursor cursor;
+            cursor.host = hostDir.path().filename().string();
+            cursor.dir = hostDir.path();
+            for (const auto& file : fs::directory_iterator(hostDir.path(), ec)) {
+                if (file.path().extension() == ".log" && file.is_regular_file(ec)) {
+                    cursor.segments.push_back(file.path().string());
+                }
+            }
+            // YYYYMMDD names: lexical order is time order
+            std::sort(cursor.segments.begin(), cursor.segments.end());
+            cursors.push_back(std::move(cursor));
+        }
+    }
+
+    // Min-heap on (end, start) of each cursor's current record
+    auto later = [&cursors](size_t a, size_t b) {
+        const SessionRecord& ra = cursors[a].current;
+        const SessionRecord& rb = cursors[b].current;
+        return ra.end != rb.end ? ra.end > rb.end : ra.start > rb.start;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+    for (size_t i = 0; i < cursors.size(); i++) {
+        if (cursors[i].advance(m_offsets, stats)) {
+            heap.push(i);
+        }
+    }
+
+    while (!heap.empty()) {
+        size_t i = heap.top();
+        heap.pop();
+
+        const SessionRecord& record = cursors[i].current;
+        if (m_seen.insert(fnv1a(record.uuid)).second) {
+            m_days[localDate(record.start)].add(record);
+            m_hosts[record.host].add(record);
+            index(record);
+            stats.merged++;
+            if (onRecord) {
+                onRecord(record);
+            }
+        } else {
+            stats.duplicates++;
+        }
+
+        if (cursors[i].advance(m_offsets, stats)) {
+            heap.push(i);
+        }
+    }
+
+    return stats;
+}
+
+uint32_t HistoryMerger::internTag(const std::string& name) {
+    auto [it, added] = m_tagIds.try_emplace(name, static_cast<uint32_t>(m_tagNames.size()));
+    if (added) {
+        m_tagNames.push_back(name);
+        m_postings.emplace_back();
+    }
+    return it->second;
+}
+
+void HistoryMerger::index(const SessionRecord& record) {
+    uint32_t number = static_cast<uint32_t>(m_sessions.size());
+    m_sessions.push_back({record.start, record.workSecs, record.completed});
+
+    for (const auto& tag : record.tags) {
+        Postings& postings = m_postings[internTag(tag)];
+        if (!postings.empty() && postings.back().second + 1 == number) {
+            postings.back().second = number;  // runs of one project stay one range
+        } else {
+            postings.emplace_back(number, number);
+        }
+    }
+}
+
+HistoryTotals HistoryMerger::sumPostings(const Postings& postings, int64_t from, int64_t to) const {
+    HistoryTotals totals;
+    for (const auto& [first, last] : postings) {
+        for (uint32_t number = first; number <= last; number++) {
+            const HistorySession& session = m_sessions[number];
+            if (session.start >= from && session.start < to) {
+                totals.workSecs += session.workSecs;
+                totals.sessions++;
+                totals.completed += session.completed;
+            }
+        }
+    }
+    return totals;
+}
+
+HistoryTotals HistoryMerger::tagTotals(const std::string& tag, int64_t from, int64_t to) const {
+    auto id = m_tagIds.find(tag);
+    return id == m_tagIds.end() ? HistoryTotals{} : sumPostings(m_postings[id->second], from, to);
+}
+
+std::vector<std::pair<std::string, HistoryTotals>> HistoryMerger::allTagTotals(int64_t from, int64_t to) const {
+    std::vector<std::pair<std::string, HistoryTotals>> result;
+    for (size_t id = 0; id < m_tagNames.size(); id++) {
+        HistoryTotals totals = sumPostings(m_postings[id], from, to);
+        if (totals.sessions) {
+            result.emplace_back(m_tagNames[id], totals);
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) { return a.second.workSecs > b.second.workSecs; });
+    return result;
+}
+
+int localDateOf(int64_t when) {
+    return localDate(when);
+}
+
+bool parseLocalDate(const std::string& text, bool endOfDay, int64_t& out) {
+    std::tm local{};
+    char extra = 0;
+    if (sscanf(text.c_str(), "%d-%d-%d%c", &local.tm_year, &local.tm_mon, &local.tm_mday, &extra) != 3) {
+        return false;
+    }
+    local.tm_year -= 1900;
+    local.tm_mon -= 1;
+    local.tm_mday += endOfDay;
+    local.tm_isdst = -1;
+    out = static_cast<int64_t>(mktime(&local));
+    return out != -1;
+}
+
+static std::string totalsJson(const HistoryTotals& totals) {
+    return "\"work_secs\": " + std::to_string(totals.workSecs) + ", \"sessions\": " + std::to_string(totals.sessions) +
+           ", \"completed\": " + std::to_string(totals.completed);
+}
+
+static std::string jsonEscape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) >= 0x20) out += c;
+    }
+    return out;
+}
+
+void writeRollupJson(const HistoryMerger& merger, const JsonSink& sink, int fromDate, int toDate) {
+    sink("{\"days\": [");
+    bool first = true;
+    char day[16];
+    for (auto it = merger.days().lower_bound(fromDate); it != merger.days().end() && it->first <= toDate; ++it) {
+        snprintf(day, sizeof(day), "%04d-%02d-%02d", it->first / 10000, it->first / 100 % 100, it->first % 100);
+        sink(std::string(first ? "" : ", ") + "{\"date\": \"" + day + "\", " + totalsJson(it->second) + "}");
+        first = false;
+    }
+    sink("], \"hosts\": [");
+    first = true;
+    for (const auto& [host, totals] : merger.hosts()) {
+        sink(std::string(first ? "" : ", ") + "{\"host\": \"" + jsonEscape(host) + "\", " + totalsJson(totals) + "}");
+        first = false;
+    }
+    sink("]}");
+}
+
+void writeTagJson(const std::vector<std::pair<std::string, HistoryTotals>>& tags, const JsonSink& sink) {
+    sink("{\"tags\": [");
+    for (size_t i = 0; i < tags.size(); i++) {
+        sink(std::string(i ? ", " : "") + "{\"tag\": \"" + jsonEscape(tags[i].first) + "\", " + totalsJson(tags[i].second) + "}");
+    }
+    sink("]}");
+}
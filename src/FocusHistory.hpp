@@ -0,0 +1,160 @@
+// FocusHistory - per-host session log, and a streaming merge across hosts
+#pragma once
+
+// Free of Hyprland headers: the plugin appends to the log and the
+// hyfocus-history tool (client/hyfocus-history.cpp) merges it.
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// One finished session. On disk it is one line of its host's segment:
+//   <start> <end> <work_secs> <completed> <uuid> [<tag id>,<tag id>...]
+// Tag IDs index the host's own dictionary (tags.dict next to the segments).
+struct SessionRecord {
+    int64_t start{0};      // Unix seconds
+    int64_t end{0};
+    int64_t workSecs{0};   // time spent in work intervals
+    bool completed{false}; // ran to the end rather than being stopped
+    std::string uuid;      // 32 hex digits, unique per session
+    std::vector<uint32_t> tagIds;   // as stored, host-local
+    std::vector<std::string> tags;  // resolved names
+    std::string host;      // directory it was read from; not stored in the line
+};
+
+std::string formatSessionRecord(const SessionRecord& record);
+bool parseSessionRecord(std::string_view line, SessionRecord& out);
+std::string newSessionUuid();
+
+// Removes "#tag" words from a start spec ("1,2@50 #thesis") and returns the
+// tags, lowercased, without the '#'. Tags keep [a-z0-9_-./]; others are dropped.
+std::vector<std::string> takeSessionTags(std::string& spec);
+
+// A history root holds one directory per host, each with one segment per
+// local day: <root>/<host>/<YYYYMMDD>.log. A host only ever writes its own
+// directory and only appends, one line per session in the order sessions
+// end, so the root can be shared by any file sync without conflicts.
+//
+// Tags go through a per-host dictionary, <root>/<host>/tags.dict, with one
+// "<id> <name>" line per tag. A new tag's line is written before the first
+// record that uses it, with the dictionary flocked so writers on the same
+// machine never assign one ID twice.
+class HistoryLog {
+public:
+    HistoryLog(std::string root, std::string host);
+
+    // record.tags are looked up (or added) in the dictionary; tagIds is ignored
+    bool append(const SessionRecord& record, std::string& error);
+
+    // $XDG_STATE_HOME/hyfocus/history (falls back to ~/.local/state)
+    static std::string defaultRoot();
+    static std::string localHost();
+
+private:
+    std::string m_root;
+    std::string m_host;
+};
+
+struct HistoryTotals {
+    int64_t workSecs{0};
+    int64_t sessions{0};
+    int64_t completed{0};
+
+    void add(const SessionRecord& record);
+};
+
+// What a merged session keeps for tag queries
+struct HistorySession {
+    int64_t start{0};
+    int64_t workSecs{0};
+    bool completed{false};
+};
+
+struct HistoryMergeStats {
+    size_t segments{0};  // segment files with unread bytes
+    size_t bytes{0};     // bytes read this run
+    size_t merged{0};    // sessions added to the rollups
+    size_t duplicates{0};
+    size_t malformed{0};
+    size_t waiting{0};   // hosts held back by a tag not yet in their dictionary
+};
+
+// K-way merge of every host directory under the given roots, ordered by
+// session end. Each host is one cursor that streams its segments line by
+// line, so memory is one open segment per host regardless of how much
+// history there is.
+//
+// Between runs the merger keeps, in a small state file: how many bytes of
+// each segment it has consumed, a 64-bit hash of every session UUID it has
+// counted, the rollups and the tag index. A rerun only reads bytes appended or synced
+// since, and a session that shows up twice (the same host directory synced
+// into two roots, say) is counted once. A trailing line without a newline
+// is left for the next run, as the sync may still be writing it, and so is
+// a record whose tag hasn't reached the host's dictionary yet.
+//
+// Tags are interned into the merger's own dictionary. Every merged session
+// gets the next sequence number and a compact HistorySession; each tag keeps
+// a posting list of sequence ranges, extended in place while consecutive
+// sessions share the tag. A tag query only walks that tag's ranges.
+class HistoryMerger {
+public:
+    using RecordCallback = std::function<void(const SessionRecord&)>;
+
+    // A missing file is a fresh start, not an error
+    bool loadState(const std::string& path, std::string& error);
+    bool saveState(const std::string& path, std::string& error) const;
+
+    // onRecord sees each newly merged session, in end order
+    HistoryMergeStats run(const std::vector<std::string>& roots, const RecordCallback& onRecord = {});
+
+    // Keyed by local date of the session start as YYYYMMDD
+    const std::map<int, HistoryTotals>& days() const { return m_days; }
+    const std::map<std::string, HistoryTotals>& hosts() const { return m_hosts; }
+    // Every merged session, in merge order
+    const std::vector<HistorySession>& sessions() const { return m_sessions; }
+
+    // Sessions carrying the tag that started in [from, to)
+    HistoryTotals tagTotals(const std::string& tag, int64_t from = INT64_MIN, int64_t to = INT64_MAX) const;
+    // Every tag with its totals over [from, to); tags without sessions there are left out
+    std::vector<std::pair<std::string, HistoryTotals>> allTagTotals(int64_t from = INT64_MIN, int64_t to = INT64_MAX) const;
+
+    // $XDG_CACHE_HOME/hyfocus/history-merge (falls back to ~/.cache); kept
+    // out of the history root since it describes what this machine has read
+    static std::string defaultStatePath();
+
+private:
+    using Postings = std::vector<std::pair<uint32_t, uint32_t>>;  // inclusive ranges of session numbers
+
+    uint32_t internTag(const std::string& name);
+    void index(const SessionRecord& record);
+    HistoryTotals sumPostings(const Postings& postings, int64_t from, int64_t to) const;
+
+    std::unordered_map<std::string, uint64_t> m_offsets;  // segment path -> bytes consumed
+    std::unordered_set<uint64_t> m_seen;                  // FNV-1a of counted UUIDs
+    std::map<int, HistoryTotals> m_days;
+    std::map<std::string, HistoryTotals> m_hosts;
+
+    std::vector<std::string> m_tagNames;                 // by merger tag ID
+    std::unordered_map<std::string, uint32_t> m_tagIds;
+    std::vector<HistorySession> m_sessions;              // by session number, in merge order
+    std::vector<Postings> m_postings;                    // by merger tag ID
+};
+
+// JSON shared by hyfocus-history and the dashboard. Written to the sink
+// piece by piece, so a long history can be streamed as it is rendered.
+using JsonSink = std::function<void(std::string_view)>;
+
+// {"days": [{"date": "YYYY-MM-DD", "work_secs": .., ...}], "hosts": [...]}
+// for days in [fromDate, toDate] (YYYYMMDD); host totals are all-time
+void writeRollupJson(const HistoryMerger& merger, const JsonSink& sink, int fromDate = 0, int toDate = 99999999);
+// {"tags": [{"tag": .., "work_secs": .., "sessions": .., "completed": ..}]}
+void writeTagJson(const std::vector<std::pair<std::string, HistoryTotals>>& tags, const JsonSink& sink);
+
+// "YYYY-MM-DD" to the local midnight starting it, or (endOfDay) ending it
+bool parseLocalDate(const std::string& text, bool endOfDay, int64_t& out);
+int localDateOf(int64_t when);  // YYYYMMDD
@@ -0,0 +1,446 @@
+#include "FocusRoom.hpp"
+#include "dispatchers.hpp"
+#include <cerrno>
+#include <cstring>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static constexpr size_t MAX_LINE_BYTES = 256;
+
+static int64_t wallClockMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+static bool validRoomName(const std::string& name) {
+    if (name.empty() || name.size() > 32) {
+        return false;
+    }
+    return std::all_of(name.begin(), name.end(), [](unsigned char c) {
+        return std::isalnum(c) || c == '-' || c == '_';
+    });
+}
+
+std::string formatRoomPhase(const RoomPhase& phase) {
+    return "phase " + std::to_string(phase.seq) + " " +
+           (phase.phase == TimerState::Break ? "break" : "work") + " " + std::to_string(phase.deadlineMs);
+}
+
+bool parseRoomPhase(const std::string& line, RoomPhase& out) {
+    std::istringstream in(line);
+    std::string verb, kind;
+    RoomPhase phase;
+    if (!(in >> verb >> phase.seq >> kind >> phase.deadlineMs) || verb != "phase" || phase.seq == 0) {
+        return false;
+    }
+
+    if (kind == "work") {
+        phase.phase = TimerState::Working;
+    } else if (kind == "break") {
+        phase.phase = TimerState::Break;
+    } else {
+        return false;
+    }
+    out = phase;
+    return true;
+}
+
+FocusRoom::~FocusRoom() {
+    leave();
+}
+
+std::string FocusRoom::roomDir() {
+    if (!g_fe_room_dir.empty()) {
+        return g_fe_room_dir;
+    }
+    // Shared by every instance of this user, unlike the per-instance runtime dir
+    const char* runtimeDir = getenv("XDG_RUNTIME_DIR");
+    return std::string(runtimeDir ? runtimeDir : "/tmp") + "/hyfocus-rooms";
+}
+
+bool FocusRoom::join(const std::string& name, const std::vector<WORKSPACEID>& workspaces, std::string& error) {
+    if (!validRoomName(name)) {
+        error = "room names are 1-32 letters, digits, '-' or '_'";
+        return false;
+    }
+    if (!g_pCompositor || !g_pCompositor->m_wlEventLoop) {
+        error = "compositor event loop unavailable";
+        return false;
+    }
+
+    leave();
+
+    std::string dir = roomDir();
+    // Group-writable so two users sharing a group can meet in a common room_dir
+    if (mkdir(dir.c_str(), 0770) == 0) {
+        chmod(dir.c_str(), 0770);  // past the umask
+    } else if (errno != EEXIST) {
+        error = "cannot create " + dir + ": " + strerror(errno);
+        return false;
+    }
+
+    m_name = name;
+    m_path = dir + "/" + name + ".sock";
+    m_workspaces = workspaces;
+    m_phase = {};
+
+    if (!connectOrHost(error)) {
+        m_name.clear();
+        m_path.clear();
+        return false;
+    }
+
+    FE_INFO("Joined focus room '{}' as {}", m_name, isHost() ? "host" : "member");
+    return true;
+}
+
+void FocusRoom::leave() {
+    if (!joined()) {
+        return;
+    }
+
+    if (isHost()) {
+        // Unlink while still listening and under the election lock: members
+        // that see the hangup wait for the lock, so none of them can bind a
+        // new socket at m_path before this unlink
+        std::string error;
+        int lockFd = lockElection(error);
+        if (lockFd < 0) {
+            FE_WARN("Focus room '{}': {}", m_name, error);
+        }
+        unlink(m_path.c_str());
+        closeAll();
+        unlockElection(lockFd);
+    } else {
+        closeAll();
+    }
+
+    FE_INFO("Left focus room '{}'", m_name);
+    m_name.clear();
+    m_path.clear();
+    m_phase = {};
+    m_following = false;
+}
+
+void FocusRoom::finish() {
+    if (!joined()) {
+        return;
+    }
+
+    if (isHost()) {
+        std::vector<int> fds;
+        for (const auto& [fd, peer] : m_peers) {
+            fds.push_back(fd);
+        }
+        for (int fd : fds) {
+            sendTo(fd, "end");
+        }
+    }
+    leave();
+}
+
+size_t FocusRoom::participants() const {
+    return isHost() ? m_peers.size() + 1 : 0;
+}
+
+int FocusRoom::lockElection(std::string& error) const {
+    std::string lockPath = m_path + ".lock";
+    int lockFd = open(lockPath.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0660);
+    if (lockFd < 0 || flock(lockFd, LOCK_EX) != 0) {
+        error = "cannot lock " + lockPath + ": " + strerror(errno);
+        if (lockFd >= 0) close(lockFd);
+        return -1;
+    }
+    return lockFd;
+}
+
+void FocusRoom::unlockElection(int lockFd) {
+    if (lockFd >= 0) {
+        flock(lockFd, LOCK_UN);
+        close(lockFd);
+    }
+}
+
+bool FocusRoom::connectOrHost(std::string& error) {
+    // Serialize elections: without the lock two instances could both find the
+    // socket dead, and the second unlink would orphan the first one's listener
+    int lockFd = lockElection(error);
+    if (lockFd < 0) {
+        return false;
+    }
+
+    sockaddr_un addr{};
+    if (m_path.size() >= sizeof(addr.sun_path)) {
+        unlockElection(lockFd);
+        error = "room socket path too long";
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, m_path.c_str(), m_path.size() + 1);
+
+    bool ok = false;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        ok = addPeer(fd);
+        if (ok && m_phase.seq > 0) {
+            // Re-election: let the new host catch up if it missed a transition
+            sendTo(fd, formatRoomPhase(m_phase));
+        }
+    } else {
+        if (fd >= 0) close(fd);
+
+        // Nobody is listening, so any socket file is stale
+        unlink(m_path.c_str());
+        m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (m_listenFd >= 0 && bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+            listen(m_listenFd, 16) == 0) {
+            chmod(m_path.c_str(), 0660);
+            m_listenSource = wl_event_loop_add_fd(g_pCompositor->m_wlEventLoop, m_listenFd, WL_EVENT_READABLE,
+                                                  &FocusRoom::onAccept, this);
+            ok = m_listenSource != nullptr;
+        }
+        if (!ok) {
+            error = std::string("cannot host room: ") + strerror(errno);
+            // Still under the lock, so this can only be our own half-set-up socket
+            unlink(m_path.c_str());
+            if (m_listenFd >= 0) close(m_listenFd);
+            m_listenFd = -1;
+        }
+    }
+
+    unlockElection(lockFd);
+    return ok;
+}
+
+bool FocusRoom::addPeer(int fd) {
+    Peer peer;
+    peer.fd = fd;
+    peer.source = wl_event_loop_add_fd(g_pCompositor->m_wlEventLoop, fd, WL_EVENT_READABLE,
+                                       &FocusRoom::onPeerEvent, this);
+    if (!peer.source) {
+        close(fd);
+        return false;
+    }
+    m_peers[fd] = std::move(peer);
+    return true;
+}
+
+void FocusRoom::dropPeer(int fd) {
+    auto it = m_peers.find(fd);
+    if (it == m_peers.end()) {
+        return;
+    }
+    wl_event_source_remove(it->second.source);
+    close(fd);
+    m_peers.erase(it);
+}
+
+void FocusRoom::closeAll() {
+    while (!m_peers.empty()) {
+        dropPeer(m_peers.begin()->first);
+    }
+    if (m_listenSource) {
+        wl_event_source_remove(m_listenSource);
+        m_listenSource = nullptr;
+    }
+    if (m_listenFd >= 0) {
+        close(m_listenFd);
+        m_listenFd = -1;
+    }
+}
+
+int FocusRoom::onAccept(int fd, uint32_t mask, void* data) {
+    (void)mask;
+    auto* self = static_cast<FocusRoom*>(data);
+
+    int peerFd;
+    while ((peerFd = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        if (self->addPeer(peerFd) && self->m_phase.seq > 0) {
+            self->sendTo(peerFd, formatRoomPhase(self->m_phase));
+        }
+    }
+    FE_DEBUG("Focus room '{}': {} participants", self->m_name, self->participants());
+    return 0;
+}
+
+int FocusRoom::onPeerEvent(int fd, uint32_t mask, void* data) {
+    auto* self = static_cast<FocusRoom*>(data);
+    auto it = self->m_peers.find(fd);
+    if (it == self->m_peers.end()) {
+        return 0;
+    }
+
+    bool closed = (mask & (WL_EVENT_HANGUP | WL_EVENT_ERROR)) != 0;
+    char buf[512];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        it->second.in.append(buf, n);
+    }
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        closed = true;
+    }
+
+    std::vector<std::string> lines;
+    std::string& in = it->second.in;
+    size_t newline;
+    while ((newline = in.find('\n')) != std::string::npos) {
+        lines.push_back(in.substr(0, newline));
+        in.erase(0, newline + 1);
+    }
+    if (in.size() > MAX_LINE_BYTES) {
+        closed = true;
+    }
+
+    for (const auto& line : lines) {
+        self->handleLine(fd, line);
+        if (!self->joined()) {
+            return 0;  // the room ended; leave() closed fd
+        }
+    }
+
+    if (closed) {
+        bool lostHost = !self->isHost();
+        self->dropPeer(fd);
+        if (lostHost && self->joined()) {
+            FE_INFO("Focus room '{}' lost its host, re-electing", self->m_name);
+            std::string error;
+            if (!self->connectOrHost(error)) {
+                FE_WARN("Focus room '{}': {}", self->m_name, error);
+                showWarning("Left focus room " + self->m_name + ": " + error);
+                self->m_name.clear();
+            }
+        }
+    }
+    return 0;
+}
+
+void FocusRoom::handleLine(int fd, const std::string& line) {
+    (void)fd;
+    if (line == "end") {
+        if (isHost()) {
+            return;
+        }
+        // Only sessions the room started end with it; our own keeps going
+        bool started = m_following && g_fe_is_session_active.load();
+        std::string name = m_name;
+        FE_INFO("Focus room '{}' ended by its host", name);
+        leave();
+        if (started) {
+            completeSession();
+        } else {
+            showNotification("Focus room " + name + " ended", {0.5, 0.7, 1.0, 1.0});
+        }
+        return;
+    }
+
+    RoomPhase phase;
+    if (!parseRoomPhase(line, phase)) {
+        FE_DEBUG("Focus room '{}': ignoring '{}'", m_name, line);
+        return;
+    }
+
+    // Members send proposals to the host; the host sends decisions to members
+    if (isHost()) {
+        accept(phase);
+    } else if (phase.seq > m_phase.seq) {
+        m_phase = phase;
+        apply(phase);
+    }
+}
+
+void FocusRoom::onLocalPhase() {
+    if (!joined() || !g_fe_timer) {
+        return;
+    }
+
+    TimerState state = g_fe_timer->getState();
+    if (state != TimerState::Working && state != TimerState::Break) {
+        return;
+    }
+
+    // Already where the room is (usually because the room put us here)
+    int64_t now = wallClockMs();
+    if (state == m_phase.phase && m_phase.deadlineMs > now) {
+        return;
+    }
+
+    propose({m_phase.seq + 1, state, now + g_fe_timer->getRemainingSeconds() * 1000LL});
+}
+
+void FocusRoom::propose(const RoomPhase& phase) {
+    if (isHost()) {
+        accept(phase);
+        return;
+    }
+    for (const auto& [fd, peer] : m_peers) {
+        sendTo(fd, formatRoomPhase(phase));
+    }
+}
+
+void FocusRoom::accept(const RoomPhase& phase) {
+    // First proposal for a sequence number wins; late duplicates are dropped
+    if (phase.seq <= m_phase.seq) {
+        return;
+    }
+    m_phase = phase;
+
+    std::string line = formatRoomPhase(phase);
+    std::vector<int> fds;
+    for (const auto& [fd, peer] : m_peers) {
+        fds.push_back(fd);
+    }
+    for (int fd : fds) {
+        sendTo(fd, line);
+    }
+    apply(phase);
+}
+
+void FocusRoom::apply(const RoomPhase& phase) {
+    int remaining = static_cast<int>((phase.deadlineMs - wallClockMs() + 999) / 1000);
+    if (remaining <= 0 || !g_fe_timer) {
+        return;  // stale, the next transition will carry a fresh deadline
+    }
+
+    if (!g_fe_is_session_active.load()) {
+        // Join at the start of a work interval, not in the middle of a break
+        if (phase.phase != TimerState::Working) {
+            return;
+        }
+
+        std::vector<WORKSPACEID> workspaces = m_workspaces;
+        if (workspaces.empty()) {
+            auto focusState = Desktop::focusState();
+            auto pMonitor = focusState ? focusState->monitor() : nullptr;
+            if (pMonitor && pMonitor->m_activeWorkspace) {
+                workspaces.push_back(pMonitor->m_activeWorkspace->m_id);
+            }
+        }
+        if (workspaces.empty() || !beginSession(workspaces, std::max(1, (remaining + 59) / 60))) {
+            FE_WARN("Focus room '{}': could not start a session here", m_name);
+            return;
+        }
+        // Follow the room's phases, not one local cycle, until its host ends it
+        g_fe_timer->runUntilStopped();
+        m_following = true;
+        showNotification("Focus room " + m_name + ": session started", {0.2, 0.6, 1.0, 1.0});
+    }
+
+    g_fe_timer->align(phase.phase, remaining);
+    FE_DEBUG("Focus room '{}': seq {} {} for {}s", m_name, phase.seq,
+             phase.phase == TimerState::Break ? "break" : "work", remaining);
+}
+
+void FocusRoom::sendTo(int fd, const std::string& line) {
+    // Lines are tiny and rare; a peer whose buffer is full is not keeping up
+    std::string msg = line + "\n";
+    ssize_t n = ::send(fd, msg.data(), msg.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n != static_cast<ssize_t>(msg.size())) {
+        FE_WARN("Focus room '{}': dropping unresponsive peer", m_name);
+        if (isHost()) {
+            dropPeer(fd);
+        }
+    }
+}
@@ -0,0 +1,97 @@
+// FocusRoom - shared work/break schedule between HyFocus instances on one machine
+#pragma once
+
+#include "globals.hpp"
+#include "FocusTimer.hpp"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One point in a room's schedule. Deadlines are wall-clock milliseconds,
+// which every instance on the machine reads from the same clock.
+struct RoomPhase {
+    uint64_t seq{0};
+    TimerState phase{TimerState::Idle};  // Working or Break
+    int64_t deadlineMs{0};
+};
+
+// "phase <seq> work|break <deadline_ms>"
+std::string formatRoomPhase(const RoomPhase& phase);
+bool parseRoomPhase(const std::string& line, RoomPhase& out);
+
+// Instances join a room through <room_dir>/<name>.sock. The first to arrive
+// listens on it and orders transitions; the rest connect. Whenever a local
+// timer starts a work or break interval that the room isn't in yet, the
+// instance proposes it with the next sequence number. The host accepts the
+// first proposal for each number and sends it to everybody, and each
+// instance aligns its own timer to the deadline. Enforcement stays local.
+//
+// Only (seq, phase, deadline) is ever sent, one short line per transition,
+// so a participant's cost doesn't depend on how many others there are.
+// If the host leaves, the remaining instances elect a new one (under a
+// lock file, which the leaving host also holds while it removes its
+// socket) and the new host carries on from the last phase it saw. When
+// the host's session ends it sends "end": everyone leaves, and sessions
+// the room started end with it.
+//
+// Compositor thread only.
+class FocusRoom {
+public:
+    FocusRoom() = default;
+    ~FocusRoom();
+
+    FocusRoom(const FocusRoom&) = delete;
+    FocusRoom& operator=(const FocusRoom&) = delete;
+
+    // Workspaces are used when the room starts a session here; empty means
+    // the current workspace at that time
+    bool join(const std::string& name, const std::vector<WORKSPACEID>& workspaces, std::string& error);
+    void leave();
+    // Our session ended: as host, end the room's sessions everywhere; then leave
+    void finish();
+
+    bool joined() const { return !m_name.empty(); }
+    bool isHost() const { return m_listenFd >= 0; }
+    const std::string& name() const { return m_name; }
+    size_t participants() const;  // host only; members report 0
+
+    // The local timer entered a work or break interval
+    void onLocalPhase();
+
+    static std::string roomDir();
+
+private:
+    struct Peer {
+        int fd{-1};
+        wl_event_source* source{nullptr};
+        std::string in;
+    };
+
+    // Held while creating or removing the socket at m_path; -1 on failure
+    int lockElection(std::string& error) const;
+    static void unlockElection(int lockFd);
+
+    bool connectOrHost(std::string& error);
+    bool addPeer(int fd);
+    void dropPeer(int fd);
+    void closeAll();
+
+    static int onAccept(int fd, uint32_t mask, void* data);
+    static int onPeerEvent(int fd, uint32_t mask, void* data);
+    void handleLine(int fd, const std::string& line);
+
+    void propose(const RoomPhase& phase);
+    void accept(const RoomPhase& phase);  // host
+    void apply(const RoomPhase& phase);   // everyone
+    void sendTo(int fd, const std::string& line);
+
+    std::string m_name;
+    std::string m_path;
+    std::vector<WORKSPACEID> m_workspaces;
+    bool m_following{false};  // the running session was started by the room
+
+    int m_listenFd{-1};
+    wl_event_source* m_listenSource{nullptr};
+    std::unordered_map<int, Peer> m_peers;  // host: members, member: the host
+    RoomPhase m_phase;
+};
@@ -0,0 +1,224 @@
+#include "FocusStats.hpp"
+#include "Checkpoint.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <sstream>
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+static int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+int64_t FocusStats::localDay(std::time_t when) {
+    std::tm local{};
+    localtime_r(&when, &local);
+    return daysFromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+}
+
+void FocusStats::advanceTo(int64_t day) {
+    if (m_today == 0) {
+        m_today = day;
+        return;
+    }
+    if (day <= m_today) {
+        return;  // same day, or the clock went back: keep crediting today
+    }
+
+    int64_t delta = day - m_today;
+    m_today = day;
+    if (delta >= HISTORY_DAYS) {
+        m_minutes.fill(0);
+        m_goalBits.fill(0);
+        return;
+    }
+
+    // Everything ages by `delta` slots; the new days start empty
+    std::move_backward(m_minutes.begin(), m_minutes.end() - delta, m_minutes.end());
+    std::fill_n(m_minutes.begin(), delta, 0);
+
+    int words = static_cast<int>(delta / 64);
+    int bits = static_cast<int>(delta % 64);
+    for (int i = static_cast<int>(m_goalBits.size()) - 1; i >= 0; i--) {
+        int src = i - words;
+        uint64_t value = 0;
+        if (src >= 0) {
+            value = m_goalBits[src] << bits;
+            if (bits && src > 0) {
+                value |= m_goalBits[src - 1] >> (64 - bits);
+            }
+        }
+        m_goalBits[i] = value;
+    }
+}
+
+void FocusStats::setDailyGoal(int minutes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_goal = std::max(1, minutes);
+
+    // Only today follows a new goal; past days keep the verdict they had
+    if (m_minutes[0] >= m_goal) {
+        m_goalBits[0] |= 1;
+    } else {
+        m_goalBits[0] &= ~uint64_t{1};
+    }
+}
+
+bool FocusStats::addFocusSeconds(int seconds, std::time_t now) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    advanceTo(localDay(now));
+
+    m_pendingSeconds += seconds;
+    if (m_pendingSeconds < 60) {
+        return false;
+    }
+    int minutes = m_pendingSeconds / 60;
+    m_pendingSeconds %= 60;
+
+    m_minutes[0] = static_cast<uint16_t>(std::min(0xffff, m_minutes[0] + minutes));
+    if (m_minutes[0] >= m_goal) {
+        m_goalBits[0] |= 1;
+    }
+
+    std::tm local{};
+    localtime_r(&now, &local);
+    m_hourOfWeek[((local.tm_wday + 6) % 7) * 24 + local.tm_hour] += minutes;
+    return true;
+}
+
+int FocusStats::todayMinutes(std::time_t now) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    advanceTo(localDay(now));
+    return m_minutes[0];
+}
+
+// Length of the run of set bits starting at `bit`, in age order
+int FocusStats::onesFrom(int bit) const {
+    int count = 0;
+    for (size_t word = bit / 64; word < m_goalBits.size(); word++) {
+        int skip = (word == static_cast<size_t>(bit / 64)) ? bit % 64 : 0;
+        int ones = std::countr_one(m_goalBits[word] >> skip);
+        count += std::min(ones, 64 - skip);
+        if (ones < 64 - skip) {
+            break;
+        }
+    }
+    return count;
+}
+
+int FocusStats::currentStreak(std::time_t now) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    advanceTo(localDay(now));
+    return goalMet(0) ? onesFrom(0) : onesFrom(1);
+}
+
+int FocusStats::longestStreak() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return longestRun();
+}
+
+int FocusStats::longestRun() const {
+    int best = 0;
+    int run = 0;  // run still open at the top of the previous word
+    for (uint64_t word : m_goalBits) {
+        int used = 0;
+        while (used < 64) {
+            int ones = std::countr_one(word);
+            run += ones;
+            used += ones;
+            if (used >= 64) {
+                break;  // run carries into the next word
+            }
+            best = std::max(best, run);
+            run = 0;
+            word >>= ones;
+            int zeros = word ? std::countr_zero(word) : 64 - used;
+            used += zeros;
+            word = used < 64 ? word >> zeros : 0;
+        }
+    }
+    return std::max(best, run);
+}
+
+std::string FocusStats::toJson(int days, std::time_t now) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    advanceTo(localDay(now));
+    days = std::clamp(days, 1, HISTORY_DAYS);
+
+    std::ostringstream out;
+    out << "{\"today\": " << m_minutes[0] << ", \"goal\": " << m_goal
+        << ", \"streak\": " << (goalMet(0) ? onesFrom(0) : onesFrom(1))
+        << ", \"best_streak\": " << longestRun() << ", \"minutes\": [";
+    for (int age = days - 1; age >= 0; age--) {
+        out << m_minutes[age] << (age ? "," : "");
+    }
+
+    out << "], \"goal_met\": \"";
+    char hex[17];
+    for (int word = 0; word < (days + 63) / 64; word++) {
+        snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(m_goalBits[word]));
+        out << hex;
+    }
+
+    out << "\", \"hour_of_week\": [";
+    for (size_t i = 0; i < m_hourOfWeek.size(); i++) {
+        out << m_hourOfWeek[i] << (i + 1 < m_hourOfWeek.size() ? "," : "");
+    }
+    out << "]}";
+    return out.str();
+}
+
+void FocusStats::saveTo(Checkpoint& checkpoint) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Trailing empty days/words are left out; a new install writes a few bytes
+    auto lastUsed = [](const auto& values) {
+        size_t n = values.size();
+        while (n > 0 && values[n - 1] == 0) n--;
+        return n;
+    };
+
+    std::ostringstream minutes, goals, hours;
+    minutes << "minutes";
+    for (size_t i = 0; i < lastUsed(m_minutes); i++) {
+        minutes << ' ' << m_minutes[i];
+    }
+    goals << "goals";
+    for (size_t i = 0; i < lastUsed(m_goalBits); i++) {
+        goals << ' ' << std::hex << m_goalBits[i];
+    }
+    hours << "hours";
+    for (uint32_t value : m_hourOfWeek) {
+        hours << ' ' << value;
+    }
+
+    checkpoint.setSection("stats", {"day " + std::to_string(m_today), minutes.str(), goals.str(), hours.str()});
+}
+
+void FocusStats::loadFrom(const Checkpoint& checkpoint) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (const auto& line : checkpoint.section("stats")) {
+        std::istringstream in(line);
+        std::string key;
+        in >> key;
+        if (key == "day") {
+            in >> m_today;
+        } else if (key == "minutes") {
+            for (size_t i = 0; i < m_minutes.size() && in >> m_minutes[i]; i++) {}
+        } else if (key == "goals") {
+            in >> std::hex;
+            for (size_t i = 0; i < m_goalBits.size() && in >> m_goalBits[i]; i++) {}
+        } else if (key == "hours") {
+            for (size_t i = 0; i < m_hourOfWeek.size() && in >> m_hourOfWeek[i]; i++) {}
+        } else {
+            FE_WARN("Ignoring unknown stats checkpoint record '{}'", key);
+        }
+    }
+}
@@ -0,0 +1,65 @@
+// FocusStats - per-day focus minutes, goal streaks and an hour-of-week histogram
+#pragma once
+
+#include "globals.hpp"
+#include <array>
+#include <ctime>
+#include <mutex>
+#include <string>
+
+class Checkpoint;
+
+// Everything a heatmap or streak widget shows, kept ready to send:
+//  - minutes focused per day for the last HISTORY_DAYS days
+//  - one "goal met" bit per day, packed 64 to a word
+//  - minutes per hour of the week (Monday 00:00 = 0), summed over all time
+//
+// Both day arrays are indexed by age: slot 0 is today, slot 1 yesterday.
+// The first credit on a new day shifts them along by the days that passed,
+// so streaks are bit scans from slot 0 and the heatmap is one copy - no
+// history is ever replayed.
+//
+// Written from the timer thread, read by IPC on the compositor thread.
+class FocusStats {
+public:
+    static constexpr int HISTORY_DAYS = 18 * 64;  // a bit over three years
+    static constexpr int HEATMAP_DAYS = 53 * 7;   // default for toJson()
+
+    FocusStats() = default;
+
+    void setDailyGoal(int minutes);
+
+    // Credit focused work. Whole minutes go to the day and hour they end in.
+    // Returns true when a minute was credited (worth persisting now and then).
+    bool addFocusSeconds(int seconds, std::time_t now = std::time(nullptr));
+
+    int todayMinutes(std::time_t now = std::time(nullptr));
+    // Days in a row the goal was met, up to today (or yesterday, if today
+    // isn't done yet)
+    int currentStreak(std::time_t now = std::time(nullptr));
+    int longestStreak() const;
+
+    // {"today": .., "goal": .., "streak": .., "best_streak": ..,
+    //  "minutes": [oldest .. today], "goal_met": "<hex, today first>",
+    //  "hour_of_week": [168]}
+    std::string toJson(int days = HEATMAP_DAYS, std::time_t now = std::time(nullptr));
+
+    // [stats] section of the checkpoint
+    void saveTo(Checkpoint& checkpoint);
+    void loadFrom(const Checkpoint& checkpoint);
+
+private:
+    static int64_t localDay(std::time_t when);
+    void advanceTo(int64_t day);
+    int onesFrom(int bit) const;
+    int longestRun() const;
+    bool goalMet(int age) const { return (m_goalBits[age / 64] >> (age % 64)) & 1; }
+
+    mutable std::mutex m_mutex;
+    int64_t m_today{0};  // local days since 1970-01-01 that slot 0 stands for
+    int m_goal{120};
+    int m_pendingSeconds{0};
+    std::array<uint16_t, HISTORY_DAYS> m_minutes{};
+    std::array<uint64_t, HISTORY_DAYS / 64> m_goalBits{};
+    std::array<uint32_t, 7 * 24> m_hourOfWeek{};
+};
@@ -17,11 +17,17 @@ void FocusTimer::configure(int totalMinutes, int workMinutes, int breakMinutes)
     m_totalDuration = std::chrono::minutes(totalMinutes);
     m_workInterval = std::chrono::minutes(workMinutes);
     m_breakInterval = std::chrono::minutes(breakMinutes);
+    m_untilStopped = false;
     
     FE_INFO("Timer configured: {}min total, {}min work, {}min break",
             totalMinutes, workMinutes, breakMinutes);
 }
 
+void FocusTimer::runUntilStopped() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_untilStopped = true;
+}
+
 bool FocusTimer::start() {
     {
         std::lock_guard<std::mutex> lock(m_mutex);
@@ -79,6 +85,7 @@ void FocusTimer::pause() {
                              ? m_workInterval 
                              : m_breakInterval;
     m_pausedRemaining = std::chrono::duration_cast<std::chrono::seconds>(intervalDuration) - elapsed;
+    m_pausedAt = now;
     
     m_state = TimerState::Paused;
     m_cv.notify_all();
@@ -99,6 +106,8 @@ void FocusTimer::resume() {
                              ? m_workInterval 
                              : m_breakInterval;
     m_intervalStart = now - (std::chrono::duration_cast<std::chrono::seconds>(intervalDuration) - m_pausedRemaining);
+    // Paused time doesn't count toward the total duration either
+    m_sessionStart += now - m_pausedAt;
     
     // Resume to previous state (working if even intervals completed, break if odd)
     m_state = (m_completedWorkIntervals % 2 == 0) ? TimerState::Working : TimerState::Break;
@@ -107,6 +116,38 @@ void FocusTimer::resume() {
     FE_INFO("Timer resumed");
 }
 
+void FocusTimer::align(TimerState phase, int remainingSeconds) {
+    TimerState previous;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        
+        previous = m_state.load();
+        if ((previous != TimerState::Working && previous != TimerState::Break) ||
+            (phase != TimerState::Working && phase != TimerState::Break)) {
+            return;
+        }
+        
+        // Parity of completed work intervals is what resume() goes by
+        if (phase != previous && phase == TimerState::Break) {
+            m_completedWorkIntervals++;
+        } else if (phase != previous && m_completedWorkIntervals % 2 != 0) {
+            m_completedWorkIntervals++;
+        }
+        
+        auto intervalDuration = (phase == TimerState::Working) ? m_workInterval : m_breakInterval;
+        m_intervalStart = std::chrono::steady_clock::now() -
+            (std::chrono::duration_cast<std::chrono::seconds>(intervalDuration) - std::chrono::seconds(remainingSeconds));
+        m_state = phase;
+        m_cv.notify_all();
+    }
+    
+    FE_DEBUG("Timer aligned: {} with {}s remaining", phase == TimerState::Working ? "work" : "break", remainingSeconds);
+    
+    if (phase != previous) {
+        invokeCallback(phase == TimerState::Working ? m_onWorkStart : m_onBreakStart);
+    }
+}
+
 int FocusTimer::getRemainingSeconds() const {
     if (m_state.load() == TimerState::Paused) {
         return static_cast<int>(m_pausedRemaining.count());
@@ -126,6 +167,19 @@ int FocusTimer::getRemainingSeconds() const {
     return std::max(0, static_cast<int>(remaining.count()));
 }
 
+int FocusTimer::getIntervalSeconds() const {
+    auto state = m_state.load();
+    if (state == TimerState::Idle || state == TimerState::Completed) {
+        return 0;
+    }
+    
+    // Paused: even number of completed work intervals means we were working
+    bool working = (state == TimerState::Paused) ? (m_completedWorkIntervals % 2 == 0)
+                                                 : (state == TimerState::Working);
+    auto interval = working ? m_workInterval : m_breakInterval;
+    return static_cast<int>(std::chrono::duration_cast<std::chrono::seconds>(interval).count());
+}
+
 int FocusTimer::getElapsedSeconds() const {
     if (m_state.load() == TimerState::Idle) {
         return 0;
@@ -165,7 +219,31 @@ void FocusTimer::timerLoop() {
                                 ? std::chrono::duration_cast<std::chrono::seconds>(m_workInterval)
                                 : std::chrono::duration_cast<std::chrono::seconds>(m_breakInterval);
         
-        if (intervalElapsed >= currentInterval) {
+        // Running out of work time mid-flow: keep working a while longer
+        int extension = 0;
+        if (intervalElapsed >= currentInterval && m_state.load() == TimerState::Working && m_extendCheck) {
+            extension = m_extendCheck();
+        }
+        
+        if (extension > 0) {
+            // Interval now ends `extension` seconds from here
+            m_intervalStart = now - (currentInterval - std::chrono::seconds(extension));
+            FE_INFO("Work interval extended by {}s", extension);
+            if (m_onWorkExtended) {
+                try {
+                    m_onWorkExtended(extension);
+                } catch (const std::exception& e) {
+                    FE_ERR("Callback threw exception: {}", e.what());
+                }
+            }
+        } else if (intervalElapsed >= currentInterval) {
+            // The session ends with the first interval to finish past the total
+            if (!m_untilStopped && now - m_sessionStart >= m_totalDuration) {
+                m_state = TimerState::Completed;
+                FE_INFO("Focus session completed");
+                invokeCallback(m_onSessionComplete);
+                break;
+            }
             if (m_state.load() == TimerState::Working) {
                 m_completedWorkIntervals++;
                 transitionToBreak();
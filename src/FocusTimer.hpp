@@ -1,4 +1,4 @@
-// FocusTimer - Pomodoro timer that loops work/break cycles
+// FocusTimer - Pomodoro timer that loops work/break cycles until the total duration
 #pragma once
 
 #include "globals.hpp"
@@ -21,6 +21,9 @@ class FocusTimer {
 public:
     using Callback = std::function<void()>;
     using TickCallback = std::function<void(int minutesRemaining, TimerState state)>;
+    // Asked when a work interval runs out: seconds to keep working, 0 = break
+    using ExtendCheck = std::function<int()>;
+    using ExtendCallback = std::function<void(int extraSeconds)>;
 
     FocusTimer();
     ~FocusTimer();
@@ -29,13 +32,21 @@ public:
     FocusTimer& operator=(const FocusTimer&) = delete;
 
     void configure(int totalMinutes, int workMinutes, int breakMinutes);
+    // Ignore the total until the next configure(): the session ends only
+    // through stop() (someone else keeps the schedule)
+    void runUntilStopped();
     bool start();
     void stop();
     void pause();
     void resume();
 
+    // Jump to `phase` with `remainingSeconds` left in it (shared schedules).
+    // Fires the work/break callback if the phase changes; no-op when paused.
+    void align(TimerState phase, int remainingSeconds);
+
     TimerState getState() const { return m_state.load(); }
     int getRemainingSeconds() const;
+    int getIntervalSeconds() const;  // length of the current work/break interval
     int getElapsedSeconds() const;
     bool isBreakTime() const { return m_state.load() == TimerState::Break; }
     bool isRunning() const {
@@ -45,8 +56,11 @@ public:
 
     void setOnWorkStart(Callback cb) { m_onWorkStart = std::move(cb); }
     void setOnBreakStart(Callback cb) { m_onBreakStart = std::move(cb); }
+    // Timer thread, once the total duration is up; the state is Completed
     void setOnSessionComplete(Callback cb) { m_onSessionComplete = std::move(cb); }
     void setOnTick(TickCallback cb) { m_onTick = std::move(cb); }
+    void setExtendCheck(ExtendCheck cb) { m_extendCheck = std::move(cb); }
+    void setOnWorkExtended(ExtendCallback cb) { m_onWorkExtended = std::move(cb); }
 
 private:
     void timerLoop();
@@ -57,10 +71,12 @@ private:
     std::chrono::minutes m_totalDuration{120};
     std::chrono::minutes m_workInterval{25};
     std::chrono::minutes m_breakInterval{5};
+    bool m_untilStopped{false};
 
     std::atomic<TimerState> m_state{TimerState::Idle};
     std::chrono::steady_clock::time_point m_sessionStart;
     std::chrono::steady_clock::time_point m_intervalStart;
+    std::chrono::steady_clock::time_point m_pausedAt;
     std::chrono::seconds m_pausedRemaining{0};
     int m_completedWorkIntervals{0};
 
@@ -73,4 +89,6 @@ private:
     Callback m_onBreakStart;
     Callback m_onSessionComplete;
     TickCallback m_onTick;
+    ExtendCheck m_extendCheck;
+    ExtendCallback m_onWorkExtended;
 };
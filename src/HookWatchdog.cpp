@@ -0,0 +1,141 @@
+#include "HookWatchdog.hpp"
+#include "globals.hpp"
+#include <bit>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+static constexpr uint64_t CALIBRATION_NS = 2'000'000;
+
+static constexpr int WINDOW = 32;
+static constexpr int TRIP_OVERRUNS = 4;
+static constexpr uint64_t WINDOW_MASK = (uint64_t{1} << WINDOW) - 1;
+
+static constexpr std::chrono::seconds MIN_HOLD{10};
+static constexpr std::chrono::seconds MAX_HOLD{300};
+static constexpr std::chrono::seconds RELAPSE{60};   // tripping again within this doubles the hold
+
+static constexpr const char* HOOK_NAMES[] = {"workspace", "activewindow", "spawn"};
+
+static double s_nsPerTick = 0;   // 0: ticks are monotonic nanoseconds
+static uint64_t s_budgetNs = 200'000;
+
+struct HookHealth {
+    uint64_t history{0};   // bit i set: the call i calls ago overran
+    bool degraded{false};
+    std::chrono::steady_clock::time_point until{};
+    std::chrono::steady_clock::time_point lastOverrun{};
+    std::chrono::steady_clock::time_point recovered{};
+    std::chrono::seconds hold{MIN_HOLD};
+};
+
+static HookHealth s_health[static_cast<size_t>(MetricHook::COUNT)];
+
+static uint64_t monotonicNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void calibrateHookClock() {
+#if defined(__x86_64__)
+    // CPUID 0x80000007, EDX bit 8: invariant TSC, same rate in every P/C-state
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8))) {
+        FE_DEBUG("No invariant TSC, hooks are timed with the monotonic clock");
+        return;
+    }
+
+    uint64_t ns0 = monotonicNs();
+    uint64_t tsc0 = __rdtsc();
+    uint64_t ns1;
+    while ((ns1 = monotonicNs()) - ns0 < CALIBRATION_NS) {
+    }
+    uint64_t tsc1 = __rdtsc();
+    if (tsc1 > tsc0) {
+        s_nsPerTick = static_cast<double>(ns1 - ns0) / static_cast<double>(tsc1 - tsc0);
+        FE_DEBUG("Hook clock: TSC at {:.0f} MHz", 1e3 / s_nsPerTick);
+    }
+#endif
+}
+
+uint64_t hookClockTicks() {
+#if defined(__x86_64__)
+    if (s_nsPerTick > 0) {
+        return __rdtsc();
+    }
+#endif
+    return monotonicNs();
+}
+
+uint64_t hookTicksToNs(uint64_t ticks) {
+    return s_nsPerTick > 0 ? static_cast<uint64_t>(static_cast<double>(ticks) * s_nsPerTick) : ticks;
+}
+
+void hookWatchdogConfigure(int budgetUs) {
+    s_budgetNs = static_cast<uint64_t>(std::max(0, budgetUs)) * 1000;
+    if (s_budgetNs == 0) {
+        // Off: nothing stays degraded
+        for (auto& health : s_health) {
+            health = {};
+        }
+    }
+}
+
+static void maybeRecover(size_t h, std::chrono::steady_clock::time_point now) {
+    HookHealth& health = s_health[h];
+    if (!health.degraded || now < health.until) {
+        return;
+    }
+
+    // A clean window, or a whole hold without an overrun: whichever comes first
+    if ((health.history & WINDOW_MASK) != 0 && now - health.lastOverrun < health.hold) {
+        return;
+    }
+    health.degraded = false;
+    health.history = 0;
+    health.recovered = now;
+    FE_INFO("{} hook back within budget, optional work restored", HOOK_NAMES[h]);
+}
+
+void hookWatchdogRecord(MetricHook hook, uint64_t ns, const char* phase, uint64_t phaseNs) {
+    if (s_budgetNs == 0) {
+        return;
+    }
+    size_t h = static_cast<size_t>(hook);
+    HookHealth& health = s_health[h];
+
+    bool overrun = ns > s_budgetNs;
+    health.history = (health.history << 1) | (overrun ? 1 : 0);
+    auto now = std::chrono::steady_clock::now();
+    if (overrun) {
+        metricCount(MetricCounter::HookOverruns);
+        health.lastOverrun = now;
+    }
+
+    if (!health.degraded) {
+        if (overrun && std::popcount(health.history & WINDOW_MASK) >= TRIP_OVERRUNS) {
+            bool relapse = health.recovered.time_since_epoch().count() != 0 && now - health.recovered < RELAPSE;
+            health.hold = relapse ? std::min(health.hold * 2, MAX_HOLD) : MIN_HOLD;
+            health.degraded = true;
+            health.until = now + health.hold;
+            FE_WARN("{} hook over its {} us budget: {} us, {} us of it in '{}'; shedding optional work for at least {}s",
+                    HOOK_NAMES[h], s_budgetNs / 1000, ns / 1000, phaseNs / 1000, phase, health.hold.count());
+            showWarning("Hook '" + std::string(HOOK_NAMES[h]) + "' is slow (mostly in " + phase +
+                        "), feedback reduced. Check logs.");
+        }
+        return;
+    }
+
+    maybeRecover(h, now);
+}
+
+bool hookDegraded(MetricHook hook) {
+    size_t h = static_cast<size_t>(hook);
+    if (s_health[h].degraded) {
+        maybeRecover(h, std::chrono::steady_clock::now());
+    }
+    return s_health[h].degraded;
+}
@@ -0,0 +1,33 @@
+// HookWatchdog - execution-time budgets for compositor hooks
+#pragma once
+
+// Free of Hyprland headers so Metrics.hpp can include it.
+#include <cstdint>
+
+enum class MetricHook : uint8_t;
+
+// Hook clock: the TSC on x86-64 CPUs whose TSC runs at a constant rate,
+// calibrated against the monotonic clock once; monotonic nanoseconds
+// elsewhere. Calibrate before any hook is registered.
+void calibrateHookClock();
+uint64_t hookClockTicks();
+uint64_t hookTicksToNs(uint64_t ticks);
+
+// Each hook call is checked against hook_budget_us (0 = off). A hook whose
+// calls overran it TRIP_OVERRUNS times within the last WINDOW calls is
+// degraded: until it recovers it sheds optional work (debug logging, shake
+// and flash feedback, flow accounting), and a warning names the phase
+// where the time went. Once degraded for its hold time it recovers after
+// WINDOW calls in a row within budget, or once no call has overrun for a
+// whole hold time (checked on hookDegraded() too, so a hook that is rarely
+// called isn't stuck). A hook that trips again soon after
+// recovering holds twice as long, up to MAX_HOLD. Revert and refocus
+// dispatches are not charged (HookBudgetExempt).
+//
+// Compositor thread only, like the hooks themselves.
+void hookWatchdogConfigure(int budgetUs);
+
+// One finished call; phase/phaseNs is its slowest phase (HookTimer::phase)
+void hookWatchdogRecord(MetricHook hook, uint64_t ns, const char* phase, uint64_t phaseNs);
+
+bool hookDegraded(MetricHook hook);
@@ -0,0 +1,657 @@
+#include "IcsCalendar.hpp"
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int64_t DAY = 86400;
+
+struct IcsTime {
+    int64_t day{0};   // civil days since 1970-01-01
+    int seconds{0};   // into that day
+    bool utc{false};  // 'Z' suffix; otherwise floating or TZID, read as local
+    bool dateOnly{false};
+    bool valid{false};
+};
+
+enum class Freq : uint8_t { None, Daily, Weekly, Monthly, Yearly };
+
+int64_t floorDiv(int64_t a, int64_t b) {
+    return a / b - ((a % b != 0) && ((a < 0) != (b < 0)));
+}
+
+// Howard Hinnant's civil calendar algorithms
+int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+void civilFromDays(int64_t z, int64_t& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+}
+
+unsigned daysInMonth(int64_t y, unsigned m) {
+    static constexpr unsigned days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    return (m == 2 && leap) ? 29 : days[m - 1];
+}
+
+int weekday(int64_t day) {  // Monday = 0
+    return static_cast<int>(((day % 7) + 7 + 3) % 7);
+}
+
+int64_t toUnix(int64_t day, int seconds, bool utc) {
+    if (utc) {
+        return day * DAY + seconds;
+    }
+
+    int64_t y;
+    unsigned m, d;
+    civilFromDays(day, y, m, d);
+    std::tm tm{};
+    tm.tm_year = static_cast<int>(y - 1900);
+    tm.tm_mon = static_cast<int>(m - 1);
+    tm.tm_mday = static_cast<int>(d);
+    tm.tm_hour = seconds / 3600;
+    tm.tm_min = seconds / 60 % 60;
+    tm.tm_sec = seconds % 60;
+    tm.tm_isdst = -1;
+    return static_cast<int64_t>(std::mktime(&tm));
+}
+
+int64_t toUnix(const IcsTime& t) {
+    return toUnix(t.day, t.seconds, t.utc);
+}
+
+bool parseDigits(std::string_view s, size_t pos, size_t n, int& out) {
+    if (pos + n > s.size()) {
+        return false;
+    }
+    out = 0;
+    for (size_t i = pos; i < pos + n; i++) {
+        if (!std::isdigit(static_cast<unsigned char>(s[i]))) {
+            return false;
+        }
+        out = out * 10 + (s[i] - '0');
+    }
+    return true;
+}
+
+// YYYYMMDD[THHMMSS[Z]]
+IcsTime parseTime(std::string_view value) {
+    IcsTime t;
+    int y, m, d;
+    if (!parseDigits(value, 0, 4, y) || !parseDigits(value, 4, 2, m) || !parseDigits(value, 6, 2, d) ||
+        m < 1 || m > 12 || d < 1 || d > 31) {
+        return t;
+    }
+    t.day = daysFromCivil(y, m, d);
+
+    if (value.size() == 8) {
+        t.dateOnly = true;
+        t.valid = true;
+        return t;
+    }
+
+    int hh, mm, ss;
+    if (value[8] != 'T' || !parseDigits(value, 9, 2, hh) || !parseDigits(value, 11, 2, mm) ||
+        !parseDigits(value, 13, 2, ss)) {
+        return t;
+    }
+    t.seconds = hh * 3600 + mm * 60 + ss;
+    t.utc = value.size() > 15 && value[15] == 'Z';
+    t.valid = true;
+    return t;
+}
+
+// [+-]P[nW][nD][T[nH][nM][nS]]
+int64_t parseDuration(std::string_view value) {
+    int64_t total = 0, n = 0;
+    bool negative = !value.empty() && value[0] == '-';
+    for (char c : value) {
+        if (std::isdigit(static_cast<unsigned char>(c))) {
+            n = n * 10 + (c - '0');
+            continue;
+        }
+        switch (c) {
+            case 'W': total += n * 7 * DAY; break;
+            case 'D': total += n * DAY; break;
+            case 'H': total += n * 3600; break;
+            case 'M': total += n * 60; break;
+            case 'S': total += n; break;
+            default: break;
+        }
+        n = 0;
+    }
+    return negative ? -total : total;
+}
+
+std::string unescapeText(std::string_view value) {
+    std::string out;
+    out.reserve(value.size());
+    for (size_t i = 0; i < value.size(); i++) {
+        if (value[i] == '\\' && i + 1 < value.size()) {
+            char next = value[++i];
+            out += (next == 'n' || next == 'N') ? '\n' : next;
+        } else {
+            out += value[i];
+        }
+    }
+    return out;
+}
+
+bool iequals(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+bool icontains(std::string_view haystack, std::string_view needle) {
+    if (needle.size() > haystack.size()) {
+        return false;
+    }
+    for (size_t i = 0; i + needle.size() <= haystack.size(); i++) {
+        if (iequals(haystack.substr(i, needle.size()), needle)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// "ws:3,4" anywhere in the text
+std::vector<int64_t> parseWorkspaceTag(std::string_view text) {
+    std::vector<int64_t> out;
+    size_t pos = text.find("ws:");
+    if (pos == std::string_view::npos) {
+        return out;
+    }
+
+    int64_t n = 0;
+    bool digits = false;
+    for (size_t i = pos + 3; i <= text.size(); i++) {
+        char c = i < text.size() ? text[i] : ' ';
+        if (std::isdigit(static_cast<unsigned char>(c))) {
+            n = n * 10 + (c - '0');
+            digits = true;
+            continue;
+        }
+        if (digits && n >= 1) {
+            out.push_back(n);
+        }
+        n = 0;
+        digits = false;
+        if (c != ',') {
+            break;
+        }
+    }
+    return out;
+}
+
+// Only has to tell an edited block from its previous version, so eight
+// bytes per step instead of FNV's one keeps re-indexing memory-bound
+uint64_t hashBytes(std::string_view data) {
+    constexpr uint64_t K = 0x9e3779b97f4a7c15ULL;
+    uint64_t h = data.size() * K;
+    size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        uint64_t word;
+        memcpy(&word, data.data() + i, 8);
+        h = (h ^ word) * K;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, data.data() + i, data.size() - i);
+    h = (h ^ tail) * K;
+    return h ^ (h >> 32);
+}
+
+// Calls fn(name, params, value) for each unfolded content line
+template <typename Fn>
+void forEachProperty(std::string_view block, Fn&& fn) {
+    std::string line;
+    auto flush = [&]() {
+        if (line.empty()) {
+            return;
+        }
+        size_t colon = std::string::npos;
+        bool quoted = false;
+        for (size_t i = 0; i < line.size(); i++) {
+            if (line[i] == '"') {
+                quoted = !quoted;
+            } else if (line[i] == ':' && !quoted) {
+                colon = i;
+                break;
+            }
+        }
+        if (colon != std::string::npos) {
+            std::string_view head(line.data(), colon);
+            size_t semi = head.find(';');
+            std::string_view name = head.substr(0, semi);
+            std::string_view params = semi == std::string_view::npos ? std::string_view{} : head.substr(semi + 1);
+            fn(name, params, std::string_view(line).substr(colon + 1));
+        }
+        line.clear();
+    };
+
+    size_t pos = 0;
+    while (pos < block.size()) {
+        size_t eol = block.find('\n', pos);
+        if (eol == std::string_view::npos) {
+            eol = block.size();
+        }
+        std::string_view physical = block.substr(pos, eol - pos);
+        if (!physical.empty() && physical.back() == '\r') {
+            physical.remove_suffix(1);
+        }
+
+        if (!physical.empty() && (physical[0] == ' ' || physical[0] == '\t')) {
+            line.append(physical.substr(1));  // folded continuation
+        } else {
+            flush();
+            line.assign(physical);
+        }
+        pos = eol + 1;
+    }
+    flush();
+}
+
+}  // namespace
+
+struct IcsEvent {
+    std::string uid;
+    std::string summary;
+    std::vector<int64_t> workspaces;
+
+    IcsTime start;
+    int64_t duration{0};
+
+    Freq freq{Freq::None};
+    int interval{1};
+    int count{0};  // 0 = unbounded
+    int64_t until{INT64_MAX};
+    uint8_t byday{0};  // bit 0 = Monday
+
+    std::vector<int64_t> exdates;
+    int64_t recurrenceId{0};  // nonzero: this event replaces one occurrence of uid
+
+    bool tagged{false};
+    bool cancelled{false};
+};
+
+namespace {
+
+void parseRule(std::string_view rule, IcsEvent& ev) {
+    static constexpr std::string_view days[] = {"MO", "TU", "WE", "TH", "FR", "SA", "SU"};
+
+    while (!rule.empty()) {
+        size_t semi = rule.find(';');
+        std::string_view part = rule.substr(0, semi);
+        rule = semi == std::string_view::npos ? std::string_view{} : rule.substr(semi + 1);
+
+        size_t eq = part.find('=');
+        if (eq == std::string_view::npos) {
+            continue;
+        }
+        std::string_view key = part.substr(0, eq);
+        std::string_view value = part.substr(eq + 1);
+
+        if (key == "FREQ") {
+            ev.freq = value == "DAILY"   ? Freq::Daily
+                    : value == "WEEKLY"  ? Freq::Weekly
+                    : value == "MONTHLY" ? Freq::Monthly
+                    : value == "YEARLY"  ? Freq::Yearly
+                                         : Freq::None;
+        } else if (key == "INTERVAL") {
+            ev.interval = std::max(1, std::atoi(std::string(value).c_str()));
+        } else if (key == "COUNT") {
+            ev.count = std::max(0, std::atoi(std::string(value).c_str()));
+        } else if (key == "UNTIL") {
+            IcsTime until = parseTime(value);
+            if (until.valid) {
+                // A date-only UNTIL includes that whole day
+                ev.until = until.dateOnly ? toUnix(until.day + 1, 0, false) - 1 : toUnix(until);
+            }
+        } else if (key == "BYDAY") {
+            // Ordinals ("1MO") only mean something for monthly rules; weekly uses the day
+            while (!value.empty()) {
+                size_t comma = value.find(',');
+                std::string_view day = value.substr(0, comma);
+                value = comma == std::string_view::npos ? std::string_view{} : value.substr(comma + 1);
+                if (day.size() >= 2) {
+                    day = day.substr(day.size() - 2);
+                }
+                for (int i = 0; i < 7; i++) {
+                    if (day == days[i]) {
+                        ev.byday |= 1 << i;
+                    }
+                }
+            }
+        }
+    }
+}
+
+std::shared_ptr<const IcsEvent> parseEvent(std::string_view block, const std::string& tag) {
+    auto ev = std::make_shared<IcsEvent>();
+    std::string description;
+    IcsTime end;
+    int nested = 0;  // inside VALARM and friends
+
+    // Parameters (TZID, VALUE=DATE) aren't needed: the value's own form says it all
+    forEachProperty(block, [&](std::string_view name, std::string_view, std::string_view value) {
+        if (name == "BEGIN") {
+            nested += value != "VEVENT";
+            return;
+        }
+        if (name == "END") {
+            nested -= nested > 0 && value != "VEVENT";
+            return;
+        }
+        if (nested > 0) {
+            return;
+        }
+
+        if (name == "UID") {
+            ev->uid = value;
+        } else if (name == "SUMMARY") {
+            ev->summary = unescapeText(value);
+        } else if (name == "DESCRIPTION") {
+            description = unescapeText(value);
+        } else if (name == "CATEGORIES") {
+            while (!value.empty() && !ev->tagged) {
+                size_t comma = value.find(',');
+                ev->tagged = iequals(value.substr(0, comma), tag);
+                value = comma == std::string_view::npos ? std::string_view{} : value.substr(comma + 1);
+            }
+        } else if (name == "STATUS") {
+            ev->cancelled = value == "CANCELLED";
+        } else if (name == "DTSTART") {
+            ev->start = parseTime(value);
+        } else if (name == "DTEND") {
+            end = parseTime(value);
+        } else if (name == "DURATION") {
+            ev->duration = parseDuration(value);
+        } else if (name == "RRULE") {
+            parseRule(value, *ev);
+        } else if (name == "EXDATE") {
+            while (!value.empty()) {
+                size_t comma = value.find(',');
+                IcsTime t = parseTime(value.substr(0, comma));
+                if (t.valid) {
+                    ev->exdates.push_back(toUnix(t));
+                }
+                value = comma == std::string_view::npos ? std::string_view{} : value.substr(comma + 1);
+            }
+        } else if (name == "RECURRENCE-ID") {
+            IcsTime t = parseTime(value);
+            if (t.valid) {
+                ev->recurrenceId = toUnix(t);
+            }
+        }
+    });
+
+    ev->tagged = ev->tagged || icontains(ev->summary, "#" + tag);
+    // Overrides are kept even untagged: they still cancel the master's occurrence
+    if ((!ev->tagged && ev->recurrenceId == 0) || !ev->start.valid || ev->start.dateOnly) {
+        return nullptr;
+    }
+
+    if (end.valid) {
+        ev->duration = toUnix(end) - toUnix(ev->start);
+    }
+    if (ev->duration <= 0) {
+        return nullptr;
+    }
+
+    ev->workspaces = parseWorkspaceTag(ev->summary);
+    if (ev->workspaces.empty()) {
+        ev->workspaces = parseWorkspaceTag(description);
+    }
+    std::sort(ev->exdates.begin(), ev->exdates.end());
+    return ev;
+}
+
+void expandEvent(const IcsEvent& ev, int64_t from, int64_t to, const std::vector<int64_t>* overridden,
+                 std::vector<FocusBlock>& out) {
+    const int64_t day0 = ev.start.day;
+    const int64_t dayLo = floorDiv(from - ev.duration, DAY) - 1;  // slack for UTC offsets
+
+    // False once past the window or UNTIL; days only increase from here
+    auto emit = [&](int64_t day) {
+        int64_t start = toUnix(day, ev.start.seconds, ev.start.utc);
+        if (start > ev.until || start >= to) {
+            return false;
+        }
+        if (start + ev.duration <= from || std::binary_search(ev.exdates.begin(), ev.exdates.end(), start)) {
+            return true;
+        }
+        if (overridden && std::find(overridden->begin(), overridden->end(), start) != overridden->end()) {
+            return true;
+        }
+        out.push_back({start, start + ev.duration, ev.workspaces, ev.summary});
+        return true;
+    };
+
+    switch (ev.freq) {
+        case Freq::None:
+            emit(day0);
+            break;
+
+        case Freq::Daily: {
+            int64_t i = day0 >= dayLo ? 0 : (dayLo - day0 + ev.interval - 1) / ev.interval;
+            for (; ev.count == 0 || i < ev.count; i++) {
+                if (!emit(day0 + i * ev.interval)) break;
+            }
+            break;
+        }
+
+        case Freq::Weekly: {
+            const int wd0 = weekday(day0);
+            const uint8_t mask = ev.byday ? ev.byday : static_cast<uint8_t>(1 << wd0);
+            const int64_t week0 = day0 - wd0;
+            const int64_t span = 7LL * ev.interval;
+            const int perWeek = std::popcount(mask);
+            const int firstWeek = std::popcount(static_cast<uint8_t>(mask & ~((1u << wd0) - 1)));
+
+            // Skip whole periods before the window without visiting them
+            int64_t j = std::max<int64_t>(0, floorDiv(dayLo - week0, span));
+            int64_t index = j == 0 ? 0 : firstWeek + (j - 1) * perWeek;
+            for (bool more = true; more; j++) {
+                for (int k = 0; k < 7 && more; k++) {
+                    int64_t day = week0 + j * span + k;
+                    if (!(mask & (1 << k)) || day < day0) {
+                        continue;
+                    }
+                    if (ev.count && index >= ev.count) {
+                        more = false;
+                        break;
+                    }
+                    index++;
+                    more = emit(day);
+                }
+            }
+            break;
+        }
+
+        case Freq::Monthly:
+        case Freq::Yearly: {
+            int64_t y;
+            unsigned m, d;
+            civilFromDays(day0, y, m, d);
+            const int64_t step = ev.freq == Freq::Yearly ? 12LL * ev.interval : ev.interval;
+
+            // Few enough periods since any plausible DTSTART to just walk them
+            int64_t index = 0;
+            for (int64_t j = 0;; j++) {
+                int64_t months = static_cast<int64_t>(m - 1) + j * step;
+                int64_t year = y + months / 12;
+                unsigned month = static_cast<unsigned>(months % 12) + 1;
+                if (d > daysInMonth(year, month)) {
+                    continue;  // e.g. the 31st in a 30-day month: no occurrence
+                }
+                if (ev.count && index >= ev.count) {
+                    break;
+                }
+                index++;
+                int64_t day = daysFromCivil(year, month, d);
+                if (day < dayLo) {
+                    continue;
+                }
+                if (!emit(day)) {
+                    break;
+                }
+            }
+            break;
+        }
+    }
+}
+
+}  // namespace
+
+IcsCalendar::IcsCalendar(std::string tag) : m_tag(std::move(tag)) {}
+
+IcsCalendar::~IcsCalendar() = default;
+
+bool IcsCalendar::load(const std::string& path, std::string& error) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        error = path + ": not a regular file";
+        close(fd);
+        return false;
+    }
+
+    // Copied rather than mapped: sync tools rewrite the file in place, and
+    // touching a mapped page past a truncation raises SIGBUS
+    std::string data;
+    data.resize(static_cast<size_t>(st.st_size) + 1);
+    size_t used = 0;
+    while (true) {
+        if (used == data.size()) {
+            data.resize(data.size() * 2);  // grew since fstat
+        }
+        ssize_t n = read(fd, data.data() + used, data.size() - used);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            error = path + ": " + strerror(errno);
+            close(fd);
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        used += static_cast<size_t>(n);
+    }
+    close(fd);
+
+    data.resize(used);
+    loadBuffer(data);
+    return true;
+}
+
+void IcsCalendar::loadBuffer(std::string_view data) {
+    static constexpr std::string_view BEGIN = "BEGIN:VEVENT";
+    static constexpr std::string_view END = "END:VEVENT";
+
+    m_load++;
+    m_events.clear();
+    m_stats = {};
+    m_stats.bytes = data.size();
+
+    size_t pos = 0;
+    while ((pos = data.find(BEGIN, pos)) != std::string_view::npos) {
+        if (pos > 0 && data[pos - 1] != '\n') {
+            pos += BEGIN.size();
+            continue;
+        }
+        size_t endPos = data.find(END, pos);
+        if (endPos == std::string_view::npos) {
+            break;  // truncated, e.g. mid-write
+        }
+        size_t eol = data.find('\n', endPos);
+        size_t blockEnd = eol == std::string_view::npos ? data.size() : eol + 1;
+
+        std::string_view block = data.substr(pos, blockEnd - pos);
+        uint64_t hash = hashBytes(block);
+        m_stats.blocks++;
+        pos = blockEnd;
+
+        // Unchanged blocks are found and reused in place, without allocating
+        auto [it, added] = m_blocks.try_emplace(hash);
+        if (!added && it->second.seen == m_load) {
+            continue;  // identical to an earlier block in this file: same event
+        }
+        if (added) {
+            it->second.event = parseEvent(block, m_tag);
+            m_stats.parsed++;
+        }
+        it->second.seen = m_load;
+        if (it->second.event) {
+            m_events.push_back(it->second.event);
+        }
+    }
+
+    // Whatever wasn't seen this time was edited or deleted
+    std::erase_if(m_blocks, [this](const auto& entry) {
+        return entry.second.seen != m_load;
+    });
+    m_stats.events = m_events.size();
+}
+
+std::vector<FocusBlock> IcsCalendar::expand(int64_t from, int64_t to) const {
+    std::unordered_map<std::string, std::vector<int64_t>> overridden;
+    for (const auto& ev : m_events) {
+        if (ev->recurrenceId) {
+            overridden[ev->uid].push_back(ev->recurrenceId);
+        }
+    }
+
+    std::vector<FocusBlock> out;
+    for (const auto& ev : m_events) {
+        if (!ev->tagged || ev->cancelled) {
+            continue;
+        }
+        if (ev->recurrenceId) {
+            // A moved occurrence is a one-off at its new time
+            int64_t start = toUnix(ev->start);
+            if (start < to && start + ev->duration > from) {
+                out.push_back({start, start + ev->duration, ev->workspaces, ev->summary});
+            }
+            continue;
+        }
+
+        auto it = overridden.find(ev->uid);
+        expandEvent(*ev, from, to, it == overridden.end() ? nullptr : &it->second, out);
+    }
+
+    std::sort(out.begin(), out.end(), [](const FocusBlock& a, const FocusBlock& b) {
+        return a.start < b.start;
+    });
+    return out;
+}
@@ -0,0 +1,64 @@
+// IcsCalendar - focus blocks read from an iCalendar (.ics) file
+#pragma once
+
+// Free of Hyprland headers so the parser can be benchmarked on its own
+// (see bench/ics_bench.cpp).
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// One occurrence of a tagged event, in Unix seconds
+struct FocusBlock {
+    int64_t start{0};
+    int64_t end{0};
+    std::vector<int64_t> workspaces;  // from "ws:3,4" in the summary/description; empty = current
+    std::string title;
+};
+
+struct IcsLoadStats {
+    size_t bytes{0};
+    size_t blocks{0};   // VEVENTs in the file
+    size_t parsed{0};   // of those, parsed this time (new or changed)
+    size_t events{0};   // focus events kept (tagged, or overrides of them)
+};
+
+struct IcsEvent;
+
+// Events count as focus blocks if CATEGORIES lists the tag or the summary
+// contains "#tag". Recurring events support RRULE FREQ=DAILY/WEEKLY/MONTHLY/
+// YEARLY with INTERVAL, COUNT, UNTIL and (weekly) BYDAY, plus EXDATE and
+// RECURRENCE-ID overrides. TZID times are taken as local time.
+class IcsCalendar {
+public:
+    explicit IcsCalendar(std::string tag = "focus");
+    ~IcsCalendar();
+
+    IcsCalendar(const IcsCalendar&) = delete;
+    IcsCalendar& operator=(const IcsCalendar&) = delete;
+
+    // Read and index the file. VEVENT blocks are keyed by a hash of their
+    // bytes, so only blocks that were added or edited since the last load
+    // are parsed; the rest are reused as-is.
+    bool load(const std::string& path, std::string& error);
+    void loadBuffer(std::string_view data);
+
+    // Occurrences overlapping [from, to), sorted by start
+    std::vector<FocusBlock> expand(int64_t from, int64_t to) const;
+
+    const IcsLoadStats& lastLoad() const { return m_stats; }
+
+private:
+    struct CachedBlock {
+        std::shared_ptr<const IcsEvent> event;  // null: not a focus block
+        uint64_t seen{0};                       // last load that found it
+    };
+
+    std::string m_tag;
+    std::unordered_map<uint64_t, CachedBlock> m_blocks;  // keyed by hash of the VEVENT's bytes
+    uint64_t m_load{0};
+    std::vector<std::shared_ptr<const IcsEvent>> m_events;
+    IcsLoadStats m_stats;
+};
@@ -0,0 +1,61 @@
+#include "InputCooldown.hpp"
+
+void InputCooldown::configure(int attempts, int windowMs, int durationMs, int maxMs) {
+    m_recent.assign(std::max(0, attempts), 0);
+    m_window = std::max(1, windowMs);
+    m_duration = std::max(1, durationMs);
+    m_max = std::max(m_duration, static_cast<int64_t>(maxMs));
+    reset();
+
+    if (attempts > 0) {
+        FE_INFO("Input cooldown: {} blocked switches in {}ms -> {}ms, up to {}ms",
+                attempts, m_window, m_duration, m_max);
+    }
+}
+
+void InputCooldown::reset() {
+    m_head = 0;
+    m_count = 0;
+    m_level = 0;
+    m_lastDuration = 0;
+    m_untilMs.store(0, std::memory_order_relaxed);
+}
+
+bool InputCooldown::onBlocked(Clock::time_point now) {
+    if (m_recent.empty()) {
+        return false;
+    }
+
+    int64_t nowMs = toMs(now);
+    int64_t until = m_untilMs.load(std::memory_order_relaxed);
+    if (nowMs < until) {
+        return false;  // already cooling down (e.g. a bind the prefilter doesn't cover)
+    }
+
+    // Calm for as long as the last cooldown lasted: start over
+    if (m_level > 0 && nowMs - until > m_lastDuration) {
+        m_level = 0;
+    }
+
+    m_recent[m_head] = nowMs;
+    m_head = (m_head + 1) % m_recent.size();
+    m_count = std::min(m_count + 1, m_recent.size());
+
+    // m_head now points at the oldest of the last `attempts` timestamps
+    if (m_count < m_recent.size() || nowMs - m_recent[m_head] > m_window) {
+        return false;
+    }
+
+    m_lastDuration = std::min(m_max, m_duration << std::min(m_level, 20));
+    m_level++;
+    m_count = 0;
+    m_untilMs.store(nowMs + m_lastDuration, std::memory_order_relaxed);
+
+    FE_INFO("Input cooldown level {}: swallowing workspace binds for {}ms", m_level, m_lastDuration);
+    return true;
+}
+
+int InputCooldown::remainingSeconds(Clock::time_point now) const {
+    int64_t left = m_untilMs.load(std::memory_order_relaxed) - toMs(now);
+    return left > 0 ? static_cast<int>((left + 999) / 1000) : 0;
+}
@@ -0,0 +1,57 @@
+// InputCooldown - backs off from storms of blocked workspace switches
+#pragma once
+
+#include "globals.hpp"
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+// Holding or mashing a restricted workspace key produces one blocked switch
+// per repeat, each with a revert, a shake and a flash. After `attempts`
+// blocked switches within `window`, workspace binds are swallowed before
+// they reach the compositor for `duration`, doubling each time the storm
+// carries on past a cooldown (up to `max`). A quiet spell as long as the
+// last cooldown starts the escalation over.
+//
+// While cooling down nothing reaches the full hook path, so a storm costs
+// at most `attempts` full blocks per cooldown, however fast keys repeat.
+//
+// Compositor thread, except remainingSeconds() which the timer thread reads
+// for the state file.
+class InputCooldown {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    InputCooldown() = default;
+
+    // attempts = 0 turns cooldowns off
+    void configure(int attempts, int windowMs, int durationMs, int maxMs);
+    void reset();
+
+    // A switch was blocked. Returns true if this one starts a cooldown.
+    bool onBlocked(Clock::time_point now = Clock::now());
+
+    bool isActive(Clock::time_point now = Clock::now()) const {
+        return toMs(now) < m_untilMs.load(std::memory_order_relaxed);
+    }
+    int remainingSeconds(Clock::time_point now = Clock::now()) const;
+    int level() const { return m_level; }
+
+private:
+    static int64_t toMs(Clock::time_point t) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(t.time_since_epoch()).count();
+    }
+
+    int64_t m_window{2000};
+    int64_t m_duration{1000};
+    int64_t m_max{30000};
+
+    // Ring of the last `attempts` blocked switches
+    std::vector<int64_t> m_recent;
+    size_t m_head{0};
+    size_t m_count{0};
+
+    int m_level{0};
+    int64_t m_lastDuration{0};
+    std::atomic<int64_t> m_untilMs{0};
+};
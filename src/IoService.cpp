@@ -0,0 +1,645 @@
+#include "IoService.hpp"
+#include "MainThreadExecutor.hpp"
+#include <algorithm>
+#include <iterator>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <system_error>
+
+static constexpr unsigned RING_ENTRIES = 64;
+
+// Every stage queues at most two entries per operation, so a round of this
+// many always fits the submission queue in one go
+static constexpr size_t MAX_ROUND = RING_ENTRIES / 2;
+
+static constexpr mode_t FILE_MODE = 0666;   // less umask, as ofstream did
+
+// io_uring over the raw syscalls, just what a stage needs: queue entries,
+// submit them together and wait for all of their completions.
+class IoRing {
+public:
+    IoRing() = default;
+    ~IoRing();
+
+    IoRing(const IoRing&) = delete;
+    IoRing& operator=(const IoRing&) = delete;
+
+    // 0, or why this kernel/sandbox can't be used
+    int init();
+
+    // A zeroed entry completing under `tag`
+    io_uring_sqe* next(uint64_t tag);
+
+    // Submit everything next() queued, wait for it, results[tag] = res.
+    // False if the ring itself failed; whatever the kernel had already taken
+    // has completed by then, so the buffers can go and no fd is left behind.
+    bool run(std::vector<int>& results);
+
+private:
+    unsigned reap(std::vector<int>& results);
+    void drain(unsigned first, unsigned reaped, std::vector<int>& results);
+
+    int m_fd{-1};
+    void* m_sqMap{MAP_FAILED};
+    void* m_cqMap{MAP_FAILED};
+    void* m_sqeMap{MAP_FAILED};
+    size_t m_sqMapSize{0};
+    size_t m_cqMapSize{0};
+    size_t m_sqeMapSize{0};
+
+    unsigned* m_sqHead{nullptr};
+    unsigned* m_sqTail{nullptr};
+    unsigned* m_sqArray{nullptr};
+    unsigned m_sqMask{0};
+    unsigned m_sqEntries{0};
+    io_uring_sqe* m_sqes{nullptr};
+
+    unsigned* m_cqHead{nullptr};
+    unsigned* m_cqTail{nullptr};
+    unsigned m_cqMask{0};
+    io_uring_cqe* m_cqes{nullptr};
+
+    unsigned m_tail{0};
+    unsigned m_queued{0};
+};
+
+IoRing::~IoRing() {
+    if (m_sqeMap != MAP_FAILED) {
+        munmap(m_sqeMap, m_sqeMapSize);
+    }
+    if (m_cqMap != MAP_FAILED && m_cqMap != m_sqMap) {
+        munmap(m_cqMap, m_cqMapSize);
+    }
+    if (m_sqMap != MAP_FAILED) {
+        munmap(m_sqMap, m_sqMapSize);
+    }
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+int IoRing::init() {
+    io_uring_params params{};
+    m_fd = static_cast<int>(syscall(__NR_io_uring_setup, RING_ENTRIES, &params));
+    if (m_fd < 0) {
+        return errno;
+    }
+
+    m_sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        m_sqMapSize = m_cqMapSize = std::max(m_sqMapSize, m_cqMapSize);
+    }
+    m_sqMap = mmap(nullptr, m_sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+    if (m_sqMap == MAP_FAILED) {
+        return errno;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        m_cqMap = m_sqMap;
+    } else {
+        m_cqMap = mmap(nullptr, m_cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+        if (m_cqMap == MAP_FAILED) {
+            return errno;
+        }
+    }
+    m_sqeMapSize = params.sq_entries * sizeof(io_uring_sqe);
+    m_sqeMap = mmap(nullptr, m_sqeMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+    if (m_sqeMap == MAP_FAILED) {
+        return errno;
+    }
+
+    auto* sq = static_cast<char*>(m_sqMap);
+    m_sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    m_sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    m_sqEntries = params.sq_entries;
+    m_sqes = static_cast<io_uring_sqe*>(m_sqeMap);
+    m_tail = *m_sqTail;
+
+    auto* cq = static_cast<char*>(m_cqMap);
+    m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    m_cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // renameat/unlinkat need 5.11; older kernels take the pwrite path
+    std::vector<char> buffer(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+    auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+    if (syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+        return errno;
+    }
+    for (int op : {IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_FSYNC, IORING_OP_CLOSE, IORING_OP_RENAMEAT,
+                   IORING_OP_UNLINKAT}) {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+            return EOPNOTSUPP;
+        }
+    }
+    return 0;
+}
+
+io_uring_sqe* IoRing::next(uint64_t tag) {
+    if (m_tail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries) {
+        return nullptr;
+    }
+    unsigned index = m_tail & m_sqMask;
+    io_uring_sqe* sqe = &m_sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = tag;
+    m_sqArray[index] = index;
+    m_tail++;
+    m_queued++;
+    return sqe;
+}
+
+unsigned IoRing::reap(std::vector<int>& results) {
+    unsigned head = *m_cqHead;
+    unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+    unsigned count = 0;
+    for (; head != tail; head++, count++) {
+        const io_uring_cqe& cqe = m_cqes[head & m_cqMask];
+        if (cqe.user_data < results.size()) {
+            results[cqe.user_data] = cqe.res;
+        }
+    }
+    __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+    return count;
+}
+
+bool IoRing::run(std::vector<int>& results) {
+    unsigned pending = m_queued;
+    unsigned unsubmitted = m_queued;
+    unsigned first = m_tail - m_queued;
+    m_queued = 0;
+    __atomic_store_n(m_sqTail, m_tail, __ATOMIC_RELEASE);
+
+    unsigned reaped = 0;
+    for (; reaped < pending; reaped += reap(results)) {
+        long n = syscall(__NR_io_uring_enter, m_fd, unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                continue;
+            }
+            int error = errno;
+            drain(first, reaped, results);
+            errno = error;
+            return false;
+        }
+        unsubmitted -= std::min<unsigned>(unsubmitted, static_cast<unsigned>(n));
+    }
+    return true;
+}
+
+void IoRing::drain(unsigned first, unsigned reaped, std::vector<int>& results) {
+    // Entries the kernel took (the SQ head moved past them) still read our
+    // paths and data, and a late openat returns an fd the caller must close.
+    // Their completions keep arriving in the mapped CQ without entering, so
+    // poll for them like a blocking pwrite would wait.
+    unsigned taken = __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) - first;
+    for (int polls = 0; reaped < taken; polls++) {
+        unsigned n = reap(results);
+        reaped += n;
+        if (n == 0) {
+            if (polls == 1000) {
+                FE_WARN("io_uring: waiting for {} requests still in flight", taken - reaped);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+// One step of a round. With a ring the calls queue entries and run() submits
+// them together; without one they happen right away. Either way each result
+// (fd, bytes written, 0 or -errno) ends up under its tag.
+class IoStage {
+public:
+    IoStage(IoRing* ring, size_t tags) : m_ring(ring), m_results(tags, -ECANCELED) {}
+
+    void open(uint64_t tag, const char* path, int flags) {
+        if (io_uring_sqe* sqe = queue(tag)) {
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<uint64_t>(path);
+            sqe->len = FILE_MODE;
+            sqe->open_flags = flags;
+        } else {
+            m_results[tag] = result(::open(path, flags, FILE_MODE));
+        }
+    }
+
+    // Replace writes from offset 0, Append at the end (O_APPEND). syncTag >= 0
+    // chains an fdatasync that only runs if the write succeeds.
+    void write(uint64_t tag, int fd, const std::string& data, bool append, int64_t syncTag) {
+        if (io_uring_sqe* sqe = queue(tag)) {
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = fd;
+            sqe->addr = reinterpret_cast<uint64_t>(data.data());
+            sqe->len = static_cast<uint32_t>(data.size());
+            sqe->off = append ? static_cast<uint64_t>(-1) : 0;
+            if (syncTag >= 0) {
+                sqe->flags |= IOSQE_IO_LINK;
+                io_uring_sqe* sync = queue(syncTag);
+                sync->opcode = IORING_OP_FSYNC;
+                sync->fd = fd;
+                sync->fsync_flags = IORING_FSYNC_DATASYNC;
+            }
+            return;
+        }
+        ssize_t n = append ? ::write(fd, data.data(), data.size()) : pwrite(fd, data.data(), data.size(), 0);
+        m_results[tag] = result(n);
+        if (syncTag >= 0 && n == static_cast<ssize_t>(data.size())) {
+            m_results[syncTag] = result(fdatasync(fd));
+        }
+    }
+
+    void close(uint64_t tag, int fd) {
+        if (io_uring_sqe* sqe = queue(tag)) {
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = fd;
+        } else {
+            m_results[tag] = result(::close(fd));
+        }
+    }
+
+    void rename(uint64_t tag, const char* from, const char* to) {
+        if (io_uring_sqe* sqe = queue(tag)) {
+            sqe->opcode = IORING_OP_RENAMEAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<uint64_t>(from);
+            sqe->len = static_cast<uint32_t>(AT_FDCWD);
+            sqe->addr2 = reinterpret_cast<uint64_t>(to);
+        } else {
+            m_results[tag] = result(::rename(from, to));
+        }
+    }
+
+    void unlink(uint64_t tag, const char* path) {
+        if (io_uring_sqe* sqe = queue(tag)) {
+            sqe->opcode = IORING_OP_UNLINKAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<uint64_t>(path);
+        } else {
+            m_results[tag] = result(::unlink(path));
+        }
+    }
+
+    // False if the ring broke
+    bool run() {
+        return !m_ring || m_ring->run(m_results);
+    }
+
+    int operator[](size_t tag) const { return m_results[tag]; }
+
+private:
+    io_uring_sqe* queue(uint64_t tag) {
+        return m_ring ? m_ring->next(tag) : nullptr;
+    }
+
+    static int result(ssize_t ret) {
+        return ret < 0 ? -errno : static_cast<int>(std::min<ssize_t>(ret, INT32_MAX));
+    }
+
+    IoRing* m_ring;
+    std::vector<int> m_results;
+};
+
+// mkdir -p of the directory holding `path`
+static bool makeParents(const std::string& path) {
+    size_t slash = path.rfind('/');
+    if (slash == std::string::npos || slash == 0) {
+        return false;
+    }
+    std::string dir = path.substr(0, slash);
+    for (size_t pos = 1; pos != std::string::npos; ) {
+        pos = dir.find('/', pos + 1);
+        if (mkdir(dir.substr(0, pos).c_str(), 0700) != 0 && errno != EEXIST) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Finish a short write with plain calls
+static int writeRest(int fd, const std::string& data, size_t done, bool append) {
+    while (done < data.size()) {
+        ssize_t n = append ? write(fd, data.data() + done, data.size() - done)
+                           : pwrite(fd, data.data() + done, data.size() - done, static_cast<off_t>(done));
+        if (n < 0 && errno != EINTR) {
+            return errno;
+        }
+        done += n > 0 ? static_cast<size_t>(n) : 0;
+    }
+    return 0;
+}
+
+IoService::IoService() = default;
+
+IoService::~IoService() {
+    stop();
+}
+
+bool IoService::start() {
+    std::lock_guard<std::mutex> exec(m_execMutex);
+    if (m_thread.joinable()) {
+        return true;
+    }
+
+    auto ring = std::make_unique<IoRing>();
+    if (int error = ring->init()) {
+        FE_INFO("io_uring unavailable ({}), file writes fall back to pwrite", strerror(error));
+        ring.reset();
+    }
+    m_ring = std::move(ring);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    try {
+        m_thread = std::thread(&IoService::run, this);
+    } catch (const std::system_error& e) {
+        FE_ERR("Failed to start I/O thread: {}", e.what());
+        return false;
+    }
+    m_running = true;
+    FE_DEBUG("I/O service started ({})", m_ring ? "io_uring" : "pwrite");
+    return true;
+}
+
+void IoService::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_thread.joinable()) {
+            return;
+        }
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+
+    // Queued between the thread's last pass and now
+    std::vector<Request> leftover;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+        m_stopping = false;
+        leftover.swap(m_queue);
+    }
+    runBatch(leftover);
+}
+
+const char* IoService::backend() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_running) {
+        return "inline";
+    }
+    return m_ring ? "io_uring" : "pwrite";
+}
+
+void IoService::replace(std::string path, std::string data, bool durable, Completion done) {
+    Request request{IoOp::Replace, durable, std::move(path), std::move(data), {}};
+    if (done) {
+        request.done.push_back(std::move(done));
+    }
+    enqueue(std::move(request));
+}
+
+void IoService::append(std::string path, std::string data) {
+    enqueue({IoOp::Append, false, std::move(path), std::move(data), {}});
+}
+
+void IoService::remove(std::string path, Completion done) {
+    Request request{IoOp::Remove, false, std::move(path), {}, {}};
+    if (done) {
+        request.done.push_back(std::move(done));
+    }
+    enqueue(std::move(request));
+}
+
+void IoService::enqueue(Request request) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_running) {
+            m_queue.push_back(std::move(request));
+            metricSetGauge(MetricGauge::IoQueueDepth, static_cast<int64_t>(m_queue.size()));
+            m_wake.notify_one();
+            return;
+        }
+    }
+
+    std::vector<Request> batch;
+    batch.push_back(std::move(request));
+    runBatch(batch);
+}
+
+void IoService::run() {
+    applyThreadQos(WorkQos::Background);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [this] { return !m_queue.empty() || m_stopping; });
+        if (m_queue.empty()) {
+            return;  // stopping, and drained
+        }
+        std::vector<Request> batch;
+        batch.swap(m_queue);
+        metricSetGauge(MetricGauge::IoQueueDepth, 0);
+
+        lock.unlock();
+        runBatch(batch);
+        lock.lock();
+    }
+}
+
+void IoService::runBatch(std::vector<Request>& batch) {
+    std::lock_guard<std::mutex> exec(m_execMutex);
+
+    // Coalesce into the last queued operation on the same path
+    std::vector<Request> ops;
+    for (auto& request : batch) {
+        auto prev = std::find_if(ops.rbegin(), ops.rend(), [&](const Request& r) { return r.path == request.path; });
+        if (prev != ops.rend() && prev->op == request.op && request.op != IoOp::Remove) {
+            if (request.op == IoOp::Replace) {
+                prev->data = std::move(request.data);
+                prev->durable |= request.durable;
+            } else {
+                prev->data += request.data;
+            }
+            std::move(request.done.begin(), request.done.end(), std::back_inserter(prev->done));
+            continue;
+        }
+        ops.push_back(std::move(request));
+    }
+
+    // Rounds touch each path at most once, so their steps can run concurrently
+    while (!ops.empty()) {
+        std::vector<Request> round, later;
+        for (auto& request : ops) {
+            auto samePath = [&](const Request& r) { return r.path == request.path; };
+            bool defer = round.size() >= MAX_ROUND || std::ranges::any_of(round, samePath) ||
+                         std::ranges::any_of(later, samePath);
+            (defer ? later : round).push_back(std::move(request));
+        }
+        runRound(round);
+        ops = std::move(later);
+    }
+}
+
+void IoService::runRound(std::vector<Request>& round) {
+    struct Job {
+        std::string target;   // what gets opened: <path>.tmp for Replace
+        int fd{-1};
+        int error{0};
+    };
+    std::vector<Job> jobs(round.size());
+
+    // What a broken ring didn't start reads as cancelled (what it did start
+    // has its real result); the rest of the round and everything after it
+    // goes through plain calls
+    auto runStage = [this](IoStage& stage) {
+        if (!stage.run()) {
+            FE_WARN("io_uring failed ({}), file writes fall back to pwrite", strerror(errno));
+            m_ring.reset();
+        }
+    };
+
+    IoStage open(m_ring.get(), round.size());
+    for (size_t i = 0; i < round.size(); i++) {
+        const Request& request = round[i];
+        if (request.op == IoOp::Remove) {
+            continue;
+        }
+        jobs[i].target = request.op == IoOp::Replace ? request.path + ".tmp" : request.path;
+        open.open(i, jobs[i].target.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (request.op == IoOp::Append ? O_APPEND : O_TRUNC));
+    }
+    runStage(open);
+    for (size_t i = 0; i < round.size(); i++) {
+        if (round[i].op == IoOp::Remove) {
+            continue;
+        }
+        int res = open[i];
+        if (res == -ENOENT && makeParents(jobs[i].target)) {
+            int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (round[i].op == IoOp::Append ? O_APPEND : O_TRUNC);
+            res = ::open(jobs[i].target.c_str(), flags, FILE_MODE);
+            res = res < 0 ? -errno : res;
+        }
+        if (res < 0) {
+            jobs[i].error = -res;
+        } else {
+            jobs[i].fd = res;
+        }
+    }
+
+    IoStage write(m_ring.get(), round.size() * 2);
+    for (size_t i = 0; i < round.size(); i++) {
+        if (jobs[i].fd >= 0) {
+            int64_t syncTag = round[i].durable ? static_cast<int64_t>(i * 2 + 1) : -1;
+            write.write(i * 2, jobs[i].fd, round[i].data, round[i].op == IoOp::Append, syncTag);
+        }
+    }
+    runStage(write);
+    for (size_t i = 0; i < round.size(); i++) {
+        Job& job = jobs[i];
+        if (job.fd < 0) {
+            continue;
+        }
+        int written = write[i * 2];
+        if (written < 0) {
+            job.error = -written;
+        } else if (static_cast<size_t>(written) < round[i].data.size()) {
+            // The chained sync ran on the partial write; sync the whole of it
+            job.error = writeRest(job.fd, round[i].data, written, round[i].op == IoOp::Append);
+            if (!job.error && round[i].durable && fdatasync(job.fd) != 0) {
+                job.error = errno;
+            }
+        } else if (round[i].durable && write[i * 2 + 1] < 0) {
+            job.error = -write[i * 2 + 1];
+        }
+    }
+
+    IoStage settle(m_ring.get(), round.size() * 2);
+    for (size_t i = 0; i < round.size(); i++) {
+        const Request& request = round[i];
+        if (jobs[i].fd >= 0) {
+            settle.close(i * 2, jobs[i].fd);
+        }
+        if (request.op == IoOp::Remove) {
+            settle.unlink(i * 2 + 1, request.path.c_str());
+        } else if (request.op == IoOp::Replace && jobs[i].fd >= 0) {
+            if (jobs[i].error) {
+                settle.unlink(i * 2 + 1, jobs[i].target.c_str());
+            } else {
+                settle.rename(i * 2 + 1, jobs[i].target.c_str(), request.path.c_str());
+            }
+        }
+    }
+    runStage(settle);
+    for (size_t i = 0; i < round.size(); i++) {
+        Job& job = jobs[i];
+        if (job.error) {
+            continue;
+        }
+        int closed = job.fd >= 0 ? settle[i * 2] : 0;
+        int settled = round[i].op == IoOp::Append ? 0 : settle[i * 2 + 1];
+        if (round[i].op == IoOp::Remove && settled == -ENOENT) {
+            settled = 0;
+        }
+        job.error = settled < 0 ? -settled : closed < 0 ? -closed : 0;
+    }
+
+    for (size_t i = 0; i < round.size(); i++) {
+        finish(round[i], jobs[i].error);
+    }
+}
+
+void IoService::finish(Request& request, int error) {
+    auto failing = std::ranges::find(m_failing, request.path);
+    if (!error) {
+        if (failing != m_failing.end()) {
+            m_failing.erase(failing);
+        }
+    } else if (request.done.empty() && failing == m_failing.end()) {
+        FE_WARN("Failed to write {}: {}", request.path, strerror(error));
+        m_failing.push_back(request.path);
+    }
+
+    if (request.done.empty()) {
+        return;
+    }
+    // Inline callers (before start, after stop) are already where they want to be
+    if (std::this_thread::get_id() != m_thread.get_id()) {
+        for (auto& done : request.done) {
+            done(error);
+        }
+        return;
+    }
+    runOnMainThread([done = std::move(request.done), error]() {
+        for (const auto& fn : done) {
+            fn(error);
+        }
+    });
+}
+
+// Without the service (before init, after shutdown) writes run inline
+static IoService& ioService() {
+    static IoService inlineOnly;
+    return g_fe_io ? *g_fe_io : inlineOnly;
+}
+
+void ioReplace(std::string path, std::string data, bool durable, IoService::Completion done) {
+    ioService().replace(std::move(path), std::move(data), durable, std::move(done));
+}
+
+void ioAppend(std::string path, std::string data) {
+    ioService().append(std::move(path), std::move(data));
+}
+
+void ioRemove(std::string path, IoService::Completion done) {
+    ioService().remove(std::move(path), std::move(done));
+}
+
+void DebugLog::close() {
+    std::string record = str();
+    if (!record.empty() && !hookShedding()) {
+        ioAppend(PATH, std::move(record));
+        str({});
+    }
+}
@@ -0,0 +1,108 @@
+// IoService - one thread for the plugin's file writes, batched through io_uring
+#pragma once
+
+// Free of Hyprland headers so globals.hpp can include it.
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+class IoRing;
+
+enum class IoOp : uint8_t {
+    Replace,    // write <path>.tmp, rename it over <path>
+    Append,
+    Remove,
+};
+
+// Every file the plugin writes while it runs (state file, checkpoint, debug
+// log) goes through here rather than a blocking open/write/close on whichever
+// thread produced it. Callers hand over a finished buffer and return at once;
+// the I/O thread takes whatever queued up since its last pass as one batch.
+//
+// A batch is coalesced first: a Replace supersedes a queued Replace of the
+// same path (the state file is rewritten every tick, only the newest counts)
+// and consecutive Appends to a path are joined. It then runs as three ring
+// submissions however many files it touches - open, write (+ fsync when
+// durable), close + rename/unlink. Without io_uring (old kernel, seccomp,
+// missing opcodes) the same steps are plain open/pwrite/fsync/rename calls on
+// the I/O thread. Operations on one path always land in the order queued, and
+// missing parent directories are created.
+//
+// Completions get 0 or an errno and run on the compositor thread through
+// runOnMainThread. Failures nobody waits for are logged once per path until
+// it works again.
+//
+// Before start() and after stop() requests run inline on the calling thread,
+// so writes during init and shutdown still land. stop() drains the queue.
+class IoService {
+public:
+    using Completion = std::function<void(int error)>;
+
+    IoService();
+    ~IoService();
+
+    IoService(const IoService&) = delete;
+    IoService& operator=(const IoService&) = delete;
+
+    // Starts the I/O thread; false (and requests stay inline) if it can't
+    bool start();
+    void stop();
+
+    // Thread-safe, never wait on the disk. durable fsyncs before the rename.
+    void replace(std::string path, std::string data, bool durable = false, Completion done = {});
+    void append(std::string path, std::string data);
+    void remove(std::string path, Completion done = {});
+
+    // "io_uring", "pwrite", or "inline" when not started
+    const char* backend() const;
+
+private:
+    struct Request {
+        IoOp op;
+        bool durable{false};
+        std::string path;
+        std::string data;
+        std::vector<Completion> done;
+    };
+
+    void enqueue(Request request);
+    void run();
+    void runBatch(std::vector<Request>& batch);
+    void runRound(std::vector<Request>& round);
+    void finish(Request& request, int error);
+
+    std::thread m_thread;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::vector<Request> m_queue;
+    bool m_running{false};    // queue rather than run inline
+    bool m_stopping{false};   // drain the queue, then exit
+
+    // Held while a batch executes, by the I/O thread or an inline caller
+    std::mutex m_execMutex;
+    std::unique_ptr<IoRing> m_ring;         // null: pwrite fallback
+    std::vector<std::string> m_failing;     // paths whose last write failed
+};
+
+// Queue on g_fe_io, or run inline without one
+void ioReplace(std::string path, std::string data, bool durable = false, IoService::Completion done = {});
+void ioAppend(std::string path, std::string data);
+void ioRemove(std::string path, IoService::Completion done = {});
+
+// One record for /tmp/hyfocus_debug.log, appended by close() or at scope
+// exit; dropped while the hook writing it is over budget
+class DebugLog : public std::ostringstream {
+public:
+    static constexpr const char* PATH = "/tmp/hyfocus_debug.log";
+
+    DebugLog() = default;
+    ~DebugLog() { close(); }
+
+    void close();
+};
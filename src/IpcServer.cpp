@@ -0,0 +1,489 @@
+#include "IpcServer.hpp"
+#include "SessionBatch.hpp"
+#include "dispatchers.hpp"
+#include "WorkspaceCatalogue.hpp"
+#include "FocusStats.hpp"
+#include "MainThreadExecutor.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+// Keep a misbehaving client from growing our buffers without bound
+static constexpr size_t MAX_CLIENTS = 32;
+static constexpr size_t MAX_REQUEST_BYTES = 64 * 1024;
+static constexpr size_t MAX_QUEUED_BYTES = 256 * 1024;  // stop reading requests past this
+static constexpr size_t MAX_QUEUED_LINES = 256;
+static constexpr size_t MAX_QUEUED_EVENTS = 64;
+static constexpr int MAX_LAGS = 3;                       // before the queue drains once
+static constexpr auto STALL_TIMEOUT = std::chrono::seconds(30);
+static constexpr size_t MAX_IOV = 16;
+
+IpcServer::~IpcServer() {
+    stop();
+}
+
+std::string IpcServer::defaultPath() {
+    return runtimePath("ipc.sock");
+}
+
+bool IpcServer::start(const std::string& path) {
+    if (m_source) {
+        return true;
+    }
+
+    if (!g_pCompositor || !g_pCompositor->m_wlEventLoop) {
+        FE_ERR("Compositor event loop unavailable, IPC socket disabled");
+        return false;
+    }
+
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        FE_ERR("IPC socket path too long: {}", path);
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0) {
+        FE_ERR("socket() failed: {}", strerror(errno));
+        return false;
+    }
+
+    // A previous load that crashed leaves its socket behind
+    unlink(path.c_str());
+    if (bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(m_listenFd, 8) != 0) {
+        FE_ERR("Failed to listen on {}: {}", path, strerror(errno));
+        close(m_listenFd);
+        m_listenFd = -1;
+        return false;
+    }
+    chmod(path.c_str(), 0600);
+
+    m_source = wl_event_loop_add_fd(g_pCompositor->m_wlEventLoop, m_listenFd,
+                                    WL_EVENT_READABLE, &IpcServer::onAccept, this);
+    if (!m_source) {
+        FE_ERR("Failed to register IPC socket with event loop");
+        close(m_listenFd);
+        m_listenFd = -1;
+        unlink(path.c_str());
+        return false;
+    }
+
+    m_path = path;
+    FE_INFO("IPC socket listening on {}", m_path);
+    return true;
+}
+
+void IpcServer::stop() {
+    while (!m_clients.empty()) {
+        disconnect(m_clients.begin()->first);
+    }
+
+    if (m_source) {
+        wl_event_source_remove(m_source);
+        m_source = nullptr;
+    }
+    if (m_listenFd >= 0) {
+        close(m_listenFd);
+        m_listenFd = -1;
+    }
+    if (!m_path.empty()) {
+        unlink(m_path.c_str());
+        m_path.clear();
+    }
+}
+
+int IpcServer::onAccept(int fd, uint32_t mask, void* data) {
+    (void)mask;
+    auto* self = static_cast<IpcServer*>(data);
+
+    while (true) {
+        int clientFd = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientFd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                FE_WARN("IPC accept() failed: {}", strerror(errno));
+            }
+            break;
+        }
+
+        if (self->m_clients.size() >= MAX_CLIENTS) {
+            FE_WARN("IPC client limit reached, rejecting connection");
+            close(clientFd);
+            continue;
+        }
+
+        auto client = std::make_unique<Client>();
+        client->server = self;
+        client->fd = clientFd;
+        client->mask = WL_EVENT_READABLE;
+        client->lastProgress = std::chrono::steady_clock::now();
+        client->source = wl_event_loop_add_fd(g_pCompositor->m_wlEventLoop, clientFd, WL_EVENT_READABLE,
+                                              &IpcServer::onClientEvent, client.get());
+        if (!client->source) {
+            close(clientFd);
+            continue;
+        }
+        self->m_clients[clientFd] = std::move(client);
+    }
+
+    metricSetGauge(MetricGauge::IpcClients, static_cast<int64_t>(self->m_clients.size()));
+    return 0;
+}
+
+int IpcServer::onClientEvent(int fd, uint32_t mask, void* data) {
+    auto* client = static_cast<Client*>(data);
+    IpcServer* self = client->server;
+
+    // Broadcasts triggered by this request must not free clients under us
+    self->m_inCallback = true;
+    self->handleClientEvent(*client, fd, mask);
+    self->m_inCallback = false;
+
+    self->reapDeadClients();
+    return 0;
+}
+
+void IpcServer::handleClientEvent(Client& client, int fd, uint32_t mask) {
+    if (mask & WL_EVENT_WRITABLE) {
+        if (!flush(client)) {
+            disconnect(fd);
+            return;
+        }
+        // Requests held back while the queue was full
+        processInput(client);
+    }
+
+    if (mask & WL_EVENT_READABLE) {
+        char buf[4096];
+        ssize_t n = 1;
+        while (client.in.size() <= MAX_REQUEST_BYTES && (n = read(fd, buf, sizeof(buf))) > 0) {
+            client.in.append(buf, n);
+        }
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            client.closing = true;
+        }
+
+        processInput(client);
+
+        if (client.in.size() > MAX_REQUEST_BYTES && client.in.find('\n') == std::string::npos) {
+            FE_WARN("IPC request too long, dropping client");
+            disconnect(fd);
+            return;
+        }
+    }
+
+    // Peer closed its end and has everything it asked for, or went away
+    if ((mask & (WL_EVENT_HANGUP | WL_EVENT_ERROR)) || (client.closing && client.out.empty())) {
+        disconnect(fd);
+        return;
+    }
+
+    updateMask(client);
+}
+
+void IpcServer::processInput(Client& client) {
+    size_t newline;
+    while (!queueFull(client) && (newline = client.in.find('\n')) != std::string::npos) {
+        std::string line = client.in.substr(0, newline);
+        client.in.erase(0, newline + 1);
+        enqueue(client, LineKind::Reply, handleRequest(client, line));
+    }
+
+    // A final request without a newline before the peer shut down its end
+    if (client.closing && !queueFull(client) && !client.in.empty() &&
+        client.in.find('\n') == std::string::npos) {
+        enqueue(client, LineKind::Reply, handleRequest(client, client.in));
+        client.in.clear();
+    }
+}
+
+static std::string okJson(bool ok, const std::string& message) {
+    return std::string("{\"ok\": ") + (ok ? "true" : "false") +
+           ", \"message\": \"" + jsonEscape(message) + "\"}";
+}
+
+std::string IpcServer::handleRequest(Client& client, const std::string& rawLine) {
+    std::string line = rawLine;
+    while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) {
+        line.pop_back();
+    }
+
+    if (line.empty()) {
+        return okJson(false, "empty request");
+    }
+
+    if (line == "status") {
+        return currentStateJson();
+    }
+
+    if (line == "catalogue" || line == "subscribe catalogue") {
+        if (!g_fe_catalogue) {
+            return okJson(false, "catalogue unavailable");
+        }
+        if (line.starts_with("subscribe")) {
+            client.topic = IpcTopic::Catalogue;
+        }
+        return g_fe_catalogue->toJson();
+    }
+
+    if (line == "stats" || line.starts_with("stats ")) {
+        if (!g_fe_stats) {
+            return okJson(false, "stats unavailable");
+        }
+        int days = FocusStats::HEATMAP_DAYS;
+        if (line.size() > 6) {
+            try {
+                days = std::stoi(line.substr(6));
+            } catch (...) {
+                return okJson(false, "expected: stats [days]");
+            }
+        }
+        return g_fe_stats->toJson(days);
+    }
+
+    if (line == "subscribe state") {
+        client.topic = IpcTopic::State;
+        return currentStateJson();
+    }
+
+    if (line.starts_with("subscribe")) {
+        return okJson(false, "unknown topic, expected: subscribe catalogue|state");
+    }
+
+    if (line.starts_with("draft ")) {
+        std::string error;
+        if (!g_fe_catalogue || !g_fe_catalogue->editDraft(line.substr(6), error)) {
+            return okJson(false, g_fe_catalogue ? error : "catalogue unavailable");
+        }
+        publishCatalogue();
+        return okJson(true, line.substr(6));
+    }
+
+    // Everything else is a batch; "batch" itself is optional for one op
+    std::string ops = line.starts_with("batch ") ? line.substr(6) : line;
+    BatchResult result = runSessionBatch(ops);
+    return okJson(result.ok, result.message);
+}
+
+void IpcServer::broadcast(IpcTopic topic, const std::string& line, IpcPush kind) {
+    auto now = std::chrono::steady_clock::now();
+    for (auto& [fd, client] : m_clients) {
+        if (client->topic != topic) {
+            continue;
+        }
+        if (!client->out.empty() && now - client->lastProgress > STALL_TIMEOUT) {
+            FE_WARN("IPC subscriber stalled for {}s, dropping it",
+                    std::chrono::duration_cast<std::chrono::seconds>(STALL_TIMEOUT).count());
+            metricCount(MetricCounter::IpcDisconnects);
+            drop(fd);
+            continue;
+        }
+        enqueue(*client, kind == IpcPush::Snapshot ? LineKind::Snapshot : LineKind::Event, line);
+        updateMask(*client);
+    }
+
+    if (!m_inCallback) {
+        reapDeadClients();
+    }
+}
+
+void publishCatalogue() {
+    if (g_fe_ipc && g_fe_catalogue) {
+        g_fe_ipc->broadcast(IpcTopic::Catalogue, g_fe_catalogue->toJson());
+    }
+}
+
+static std::string snapshotFor(IpcTopic topic) {
+    if (topic == IpcTopic::Catalogue && g_fe_catalogue) {
+        return g_fe_catalogue->toJson();
+    }
+    if (topic == IpcTopic::State) {
+        return currentStateJson();
+    }
+    return "";
+}
+
+void IpcServer::enqueue(Client& client, LineKind kind, const std::string& line) {
+    if (client.out.empty()) {
+        client.lastProgress = std::chrono::steady_clock::now();
+    }
+
+    // Only the latest snapshot matters. The old one is removed rather than
+    // overwritten so the new one still comes after any events queued since.
+    if (kind == LineKind::Snapshot) {
+        auto first = client.out.begin() + (client.outOffset > 0 ? 1 : 0);
+        auto old = std::find_if(first, client.out.end(),
+                                [](const OutLine& queued) { return queued.kind == LineKind::Snapshot; });
+        if (old != client.out.end()) {
+            client.outBytes -= old->text.size();
+            client.out.erase(old);
+        }
+    }
+
+    if (kind == LineKind::Event &&
+        (client.queuedEvents >= MAX_QUEUED_EVENTS || client.outBytes >= MAX_QUEUED_BYTES)) {
+        // The resync snapshot stands in for this event too
+        markLagged(client);
+        return;
+    }
+
+    client.out.push_back({kind, line + '\n'});
+    client.outBytes += client.out.back().text.size();
+    if (kind == LineKind::Event) {
+        client.queuedEvents++;
+    }
+}
+
+void IpcServer::markLagged(Client& client) {
+    if (++client.lagCount > MAX_LAGS) {
+        FE_WARN("IPC subscriber keeps lagging, dropping it");
+        metricCount(MetricCounter::IpcDisconnects);
+        drop(client.fd);
+        return;
+    }
+
+    // Keep the line being written, part of it is on the wire already
+    size_t dropped = 1;
+    auto first = client.out.begin() + (client.outOffset > 0 ? 1 : 0);
+    for (auto it = first; it != client.out.end();) {
+        if (it->kind == LineKind::Event) {
+            client.outBytes -= it->text.size();
+            client.queuedEvents--;
+            dropped++;
+            it = client.out.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    FE_DEBUG("IPC subscriber lagged, dropped {} events", dropped);
+    metricCount(MetricCounter::IpcDroppedEvents, dropped);
+    std::string marker = "{\"lagged\": true, \"dropped\": " + std::to_string(dropped) + "}\n";
+    client.out.push_back({LineKind::Reply, marker});
+    client.outBytes += marker.size();
+
+    std::string snapshot = snapshotFor(client.topic);
+    if (!snapshot.empty()) {
+        enqueue(client, LineKind::Snapshot, snapshot);
+    }
+}
+
+bool IpcServer::queueFull(const Client& client) {
+    return client.outBytes >= MAX_QUEUED_BYTES || client.out.size() >= MAX_QUEUED_LINES;
+}
+
+bool IpcServer::flush(Client& client) {
+    while (!client.out.empty()) {
+        iovec iov[MAX_IOV];
+        size_t count = 0;
+        for (auto it = client.out.begin(); it != client.out.end() && count < MAX_IOV; ++it, ++count) {
+            size_t skip = (count == 0) ? client.outOffset : 0;
+            iov[count].iov_base = const_cast<char*>(it->text.data()) + skip;
+            iov[count].iov_len = it->text.size() - skip;
+        }
+
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t n = sendmsg(client.fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+
+        client.lastProgress = std::chrono::steady_clock::now();
+        size_t sent = n;
+        while (sent > 0) {
+            OutLine& front = client.out.front();
+            size_t rest = front.text.size() - client.outOffset;
+            if (sent < rest) {
+                client.outOffset += sent;
+                break;
+            }
+            sent -= rest;
+            client.outBytes -= front.text.size();
+            if (front.kind == LineKind::Event) {
+                client.queuedEvents--;
+            }
+            client.out.pop_front();
+            client.outOffset = 0;
+        }
+    }
+
+    if (client.out.empty()) {
+        client.lagCount = 0;
+    }
+    return true;
+}
+
+void IpcServer::updateMask(Client& client) {
+    // Writable only while something is queued; readable unless the queue is
+    // full, so a client that doesn't read its replies stops being served
+    uint32_t mask = 0;
+    if (!client.closing && !queueFull(client)) {
+        mask |= WL_EVENT_READABLE;
+    }
+    if (!client.out.empty()) {
+        mask |= WL_EVENT_WRITABLE;
+    }
+
+    if (mask != client.mask) {
+        wl_event_source_fd_update(client.source, mask);
+        client.mask = mask;
+    }
+}
+
+void IpcServer::drop(int fd) {
+    m_deadClients.push_back(fd);
+}
+
+void IpcServer::reapDeadClients() {
+    for (int deadFd : std::exchange(m_deadClients, {})) {
+        disconnect(deadFd);
+    }
+
+    // Runs after every client callback and broadcast, so the gauges stay current
+    size_t queued = 0;
+    for (const auto& [fd, client] : m_clients) {
+        queued += client->outBytes;
+    }
+    metricSetGauge(MetricGauge::IpcClients, static_cast<int64_t>(m_clients.size()));
+    metricSetGauge(MetricGauge::IpcQueuedBytes, static_cast<int64_t>(queued));
+}
+
+void IpcServer::disconnect(int fd) {
+    auto it = m_clients.find(fd);
+    if (it == m_clients.end()) {
+        return;
+    }
+
+    if (it->second->source) {
+        wl_event_source_remove(it->second->source);
+    }
+    close(fd);
+    m_clients.erase(it);
+}
+
+void publishStateChange() {
+    runOnMainThread([]() {
+        if (g_fe_ipc) {
+            g_fe_ipc->broadcast(IpcTopic::State, currentStateJson());
+        }
+    });
+}
+
+void publishBlockedEvent(const std::string& what, const std::string& target, int rule) {
+    if (!g_fe_ipc) {
+        return;
+    }
+    g_fe_ipc->broadcast(IpcTopic::State,
+                        "{\"event\": \"blocked\", \"what\": \"" + what + "\", \"target\": \"" +
+                            jsonEscape(target) + "\", \"rule\": " + std::to_string(rule) + "}",
+                        IpcPush::Event);
+}
@@ -0,0 +1,126 @@
+// IpcServer - Unix socket for scripts and widgets, served on the compositor thread
+#pragma once
+
+#include "globals.hpp"
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Line protocol: one request per line, one JSON line back per request.
+//
+//   status                         -> {"active": ..., "state": ..., ...}
+//   batch start 1,2@50; allow 4    -> {"ok": true, "message": "..."}
+//   allow 4                        -> same as a batch with one op
+//   catalogue                      -> {"workspaces": [...], "draft": [...]}
+//   stats [days]                   -> {"today": ..., "streak": ..., "minutes": [...], ...}
+//   draft toggle 4                 -> {"ok": true, ...}, pushed to subscribers
+//   subscribe catalogue            -> current catalogue, then one line per change
+//   subscribe state                -> current state, then one line per transition
+//                                     plus {"event": "blocked", ...} lines
+//
+// Both the listening socket and client sockets are registered on Hyprland's
+// event loop, so requests run on the compositor thread like dispatchers do.
+//
+// Nothing is written inline: lines go to a per-client queue and are sent
+// when the socket reports writable. The queue stays bounded however slow the
+// reader is:
+//  - snapshots (catalogue, state) replace the one still queued, so only the
+//    latest is ever pending
+//  - discrete events are kept up to a cap; past it the client is marked
+//    lagged, its events are dropped and it gets {"lagged": true, "dropped": N}
+//    followed by a fresh snapshot
+//  - replies are never dropped; instead a client with a full queue isn't
+//    read from until it drains
+//  - a client that lags repeatedly or makes no progress for a while is
+//    disconnected
+enum class IpcTopic : uint8_t {
+    None,
+    Catalogue,
+    State
+};
+
+enum class IpcPush : uint8_t {
+    Snapshot,  // full state, coalesced to the latest
+    Event      // discrete, queued up to a cap
+};
+
+class IpcServer {
+public:
+    IpcServer() = default;
+    ~IpcServer();
+
+    IpcServer(const IpcServer&) = delete;
+    IpcServer& operator=(const IpcServer&) = delete;
+
+    bool start(const std::string& path = defaultPath());
+    void stop();
+
+    static std::string defaultPath();
+
+    // Queue one line for every client subscribed to topic
+    void broadcast(IpcTopic topic, const std::string& line, IpcPush kind = IpcPush::Snapshot);
+
+private:
+    enum class LineKind : uint8_t {
+        Reply,
+        Snapshot,
+        Event
+    };
+
+    struct OutLine {
+        LineKind kind;
+        std::string text;  // including the trailing newline
+    };
+
+    struct Client {
+        IpcServer* server{nullptr};
+        int fd{-1};
+        wl_event_source* source{nullptr};
+        uint32_t mask{0};
+        std::string in;
+        std::deque<OutLine> out;
+        size_t outOffset{0};  // bytes of out.front() already sent
+        size_t outBytes{0};
+        size_t queuedEvents{0};
+        IpcTopic topic{IpcTopic::None};
+        int lagCount{0};      // lags since the queue last drained
+        bool closing{false};  // peer finished sending, go once drained
+        std::chrono::steady_clock::time_point lastProgress;
+    };
+
+    static int onAccept(int fd, uint32_t mask, void* data);
+    static int onClientEvent(int fd, uint32_t mask, void* data);
+    void handleClientEvent(Client& client, int fd, uint32_t mask);
+
+    std::string handleRequest(Client& client, const std::string& line);
+    void processInput(Client& client);
+    void enqueue(Client& client, LineKind kind, const std::string& line);
+    void markLagged(Client& client);
+    static bool queueFull(const Client& client);
+    bool flush(Client& client);  // false = drop the client
+    void updateMask(Client& client);
+    void drop(int fd);           // disconnect once the current callback/broadcast is done
+    void reapDeadClients();
+    void disconnect(int fd);
+
+    int m_listenFd{-1};
+    wl_event_source* m_source{nullptr};
+    std::string m_path;
+    std::unordered_map<int, std::unique_ptr<Client>> m_clients;
+    std::vector<int> m_deadClients;
+    bool m_inCallback{false};
+};
+
+// Send the current workspace catalogue to subscribers (no-op without any)
+void publishCatalogue();
+
+// Send the session state to subscribers. Safe from any thread: the send
+// is posted to the compositor thread.
+void publishStateChange();
+
+// Tell state subscribers a workspace switch, focus or spawn was blocked.
+// Compositor thread only.
+void publishBlockedEvent(const std::string& what, const std::string& target, int rule);
@@ -0,0 +1,99 @@
+#include "MainThreadExecutor.hpp"
+#include <cstring>
+#include <sys/eventfd.h>
+
+MainThreadExecutor::~MainThreadExecutor() {
+    stop();
+}
+
+bool MainThreadExecutor::start() {
+    if (m_source) {
+        return true;
+    }
+
+    if (!g_pCompositor || !g_pCompositor->m_wlEventLoop) {
+        FE_ERR("Compositor event loop unavailable, main-thread executor disabled");
+        return false;
+    }
+
+    m_eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_eventFd < 0) {
+        FE_ERR("eventfd() failed: {}", strerror(errno));
+        return false;
+    }
+
+    m_source = wl_event_loop_add_fd(g_pCompositor->m_wlEventLoop, m_eventFd,
+                                    WL_EVENT_READABLE, &MainThreadExecutor::onReadable, this);
+    if (!m_source) {
+        FE_ERR("Failed to register main-thread executor with event loop");
+        close(m_eventFd);
+        m_eventFd = -1;
+        return false;
+    }
+
+    FE_DEBUG("Main-thread executor started");
+    return true;
+}
+
+void MainThreadExecutor::stop() {
+    if (m_source) {
+        wl_event_source_remove(m_source);
+        m_source = nullptr;
+    }
+    if (m_eventFd >= 0) {
+        close(m_eventFd);
+        m_eventFd = -1;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.clear();
+}
+
+void MainThreadExecutor::post(std::function<void()> fn) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(std::move(fn));
+        metricSetGauge(MetricGauge::MainQueueDepth, static_cast<int64_t>(m_queue.size()));
+    }
+
+    // Wake the compositor thread; EAGAIN just means a wakeup is already pending
+    uint64_t one = 1;
+    if (m_eventFd >= 0) {
+        (void)write(m_eventFd, &one, sizeof(one));
+    }
+}
+
+int MainThreadExecutor::onReadable(int fd, uint32_t mask, void* data) {
+    (void)mask;
+
+    uint64_t count;
+    (void)read(fd, &count, sizeof(count));
+
+    static_cast<MainThreadExecutor*>(data)->drain();
+    return 0;
+}
+
+void MainThreadExecutor::drain() {
+    std::vector<std::function<void()>> work;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        work.swap(m_queue);
+        metricSetGauge(MetricGauge::MainQueueDepth, 0);
+    }
+
+    for (auto& fn : work) {
+        try {
+            fn();
+        } catch (const std::exception& e) {
+            FE_ERR("Main-thread task threw exception: {}", e.what());
+        }
+    }
+}
+
+void runOnMainThread(std::function<void()> fn) {
+    if (g_fe_mainExecutor) {
+        g_fe_mainExecutor->post(std::move(fn));
+    } else {
+        fn();
+    }
+}
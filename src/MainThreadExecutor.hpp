@@ -0,0 +1,39 @@
+// MainThreadExecutor - runs work posted from helper threads on the compositor thread
+#pragma once
+
+#include "globals.hpp"
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Helper threads (timer, shake, ...) must not touch compositor state directly.
+// They post a closure here; an eventfd registered on Hyprland's event loop
+// wakes the compositor thread, which drains the queue in FIFO order.
+class MainThreadExecutor {
+public:
+    MainThreadExecutor() = default;
+    ~MainThreadExecutor();
+
+    MainThreadExecutor(const MainThreadExecutor&) = delete;
+    MainThreadExecutor& operator=(const MainThreadExecutor&) = delete;
+
+    // Register with the compositor event loop, returns false on failure
+    bool start();
+    void stop();
+
+    // Queue fn for the compositor thread (thread-safe, never blocks on I/O)
+    void post(std::function<void()> fn);
+
+private:
+    static int onReadable(int fd, uint32_t mask, void* data);
+    void drain();
+
+    int m_eventFd{-1};
+    wl_event_source* m_source{nullptr};
+    std::mutex m_mutex;
+    std::vector<std::function<void()>> m_queue;
+};
+
+// Run fn on the compositor thread. Falls back to running inline if the
+// executor isn't available (e.g. during init/shutdown).
+void runOnMainThread(std::function<void()> fn);
@@ -0,0 +1,361 @@
+#include "Metrics.hpp"
+#include "globals.hpp"
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static constexpr size_t MAX_SHARDS = 16;
+static constexpr size_t COUNTERS = static_cast<size_t>(MetricCounter::COUNT);
+static constexpr size_t GAUGES = static_cast<size_t>(MetricGauge::COUNT);
+static constexpr size_t HOOKS = static_cast<size_t>(MetricHook::COUNT);
+static constexpr size_t EVENTS = 3;   // RuleEvent
+static constexpr size_t ACTIONS = 5;  // RuleAction
+
+// Upper bounds in nanoseconds, and the same values as OpenMetrics "le" labels
+static constexpr uint64_t BUCKET_NS[] = {2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 5000000};
+static constexpr const char* BUCKET_LE[] = {"2.5e-06", "5.0e-06", "1.0e-05", "2.5e-05", "5.0e-05",
+                                            "0.0001", "0.00025", "0.0005", "0.001", "0.005"};
+static constexpr size_t BUCKETS = std::size(BUCKET_NS);
+
+struct alignas(64) MetricShard {
+    std::atomic<uint64_t> counters[COUNTERS];
+    std::atomic<uint64_t> blocked[EVENTS][ACTIONS];
+    std::atomic<uint64_t> hookBuckets[HOOKS][BUCKETS + 1];  // last = +Inf
+    std::atomic<uint64_t> hookSumNs[HOOKS];
+};
+
+static MetricShard s_shards[MAX_SHARDS];
+static std::atomic<int64_t> s_gauges[GAUGES];
+static std::atomic<size_t> s_nextShard{0};
+
+// Threads beyond MAX_SHARDS share a shard; the adds are atomic either way
+static MetricShard& localShard() {
+    thread_local MetricShard& shard = s_shards[s_nextShard.fetch_add(1, std::memory_order_relaxed) % MAX_SHARDS];
+    return shard;
+}
+
+// Innermost HookTimer on this thread (hooks can nest through reverts)
+static thread_local HookTimer* t_hookTimer = nullptr;
+
+void metricCount(MetricCounter counter, uint64_t n) {
+    localShard().counters[static_cast<size_t>(counter)].fetch_add(n, std::memory_order_relaxed);
+}
+
+void metricBlocked(RuleEvent event, RuleAction action) {
+    size_t e = static_cast<size_t>(event);
+    size_t a = static_cast<size_t>(action);
+    if (e < EVENTS && a < ACTIONS) {
+        localShard().blocked[e][a].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void metricSetGauge(MetricGauge gauge, int64_t value) {
+    s_gauges[static_cast<size_t>(gauge)].store(value, std::memory_order_relaxed);
+}
+
+void metricHookLatency(MetricHook hook, uint64_t nanoseconds) {
+    size_t h = static_cast<size_t>(hook);
+    size_t bucket = 0;
+    while (bucket < BUCKETS && nanoseconds > BUCKET_NS[bucket]) {
+        bucket++;
+    }
+
+    MetricShard& shard = localShard();
+    shard.hookBuckets[h][bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.hookSumNs[h].fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+HookTimer::HookTimer(MetricHook hook)
+    : m_hook(hook), m_start(hookClockTicks()), m_phaseStart(m_start), m_outer(t_hookTimer) {
+    t_hookTimer = this;
+}
+
+HookTimer::~HookTimer() {
+    finish();
+}
+
+void HookTimer::phase(const char* name) {
+    uint64_t now = hookClockTicks();
+    uint64_t charged = now - m_phaseStart - m_phaseExemptTicks;
+    if (charged > m_slowestTicks) {
+        m_slowestTicks = charged;
+        m_slowestPhase = m_phase;
+    }
+    m_phase = name;
+    m_phaseStart = now;
+    m_phaseExemptTicks = 0;
+}
+
+void HookTimer::finish() {
+    if (!m_done) {
+        m_done = true;
+        phase(nullptr);
+        uint64_t ticks = m_phaseStart - m_start;
+        metricHookLatency(m_hook, hookTicksToNs(ticks));
+        hookWatchdogRecord(m_hook, hookTicksToNs(ticks - m_exemptTicks), m_slowestPhase,
+                           hookTicksToNs(m_slowestTicks));
+        t_hookTimer = m_outer;
+    }
+}
+
+HookBudgetExempt::HookBudgetExempt() : m_timer(t_hookTimer) {
+    if (m_timer) {
+        m_start = hookClockTicks();
+    }
+}
+
+HookBudgetExempt::~HookBudgetExempt() {
+    // Nested hook calls have restored t_hookTimer by now
+    if (m_timer && !m_timer->m_done) {
+        uint64_t ticks = hookClockTicks() - m_start;
+        m_timer->m_exemptTicks += ticks;
+        m_timer->m_phaseExemptTicks += ticks;
+    }
+}
+
+bool hookShedding() {
+    return t_hookTimer && t_hookTimer->shedding();
+}
+
+static uint64_t sumShards(auto field) {
+    uint64_t total = 0;
+    for (auto& shard : s_shards) {
+        total += field(shard).load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::string renderMetrics() {
+    static constexpr const char* COUNTER_INFO[COUNTERS][2] = {
+        {"hyfocus_sessions_started", "Focus sessions started"},
+        {"hyfocus_sessions_completed", "Focus sessions that ran to the end"},
+        {"hyfocus_sessions_stopped", "Focus sessions ended early"},
+        {"hyfocus_reverts", "Workspace switches undone"},
+        {"hyfocus_ui_spawns", "Helper processes started for widgets and notifications"},
+        {"hyfocus_ipc_dropped_events", "IPC events discarded for lagging subscribers"},
+        {"hyfocus_ipc_disconnects", "IPC subscribers disconnected for lagging or stalling"},
+        {"hyfocus_cooldowns", "Input cooldowns started by repeated blocked switches"},
+        {"hyfocus_switches_swallowed", "Workspace binds dropped during an input cooldown"},
+        {"hyfocus_switches_redirected", "Relative workspace switches sent to the next allowed workspace"},
+        {"hyfocus_swipes_clamped", "Workspace swipes held back from a restricted workspace"},
+        {"hyfocus_work_extensions", "Work intervals extended because input showed the user in flow"},
+        {"hyfocus_hook_overruns", "Hook calls that took longer than hook_budget_us"},
+    };
+    static constexpr const char* GAUGE_INFO[GAUGES][2] = {
+        {"hyfocus_session_active", "1 while a focus session is running"},
+        {"hyfocus_ipc_clients", "Connected IPC clients"},
+        {"hyfocus_ipc_queued_bytes", "Bytes queued for IPC clients"},
+        {"hyfocus_main_queue_depth", "Closures waiting for the compositor thread"},
+        {"hyfocus_io_queue_depth", "File writes waiting for the I/O thread"},
+    };
+    static constexpr const char* EVENT_NAMES[EVENTS] = {"workspace", "spawn", "focus"};
+    static constexpr const char* HOOK_NAMES[HOOKS] = {"workspace", "activewindow", "spawn"};
+
+    std::ostringstream out;
+
+    for (size_t c = 0; c < COUNTERS; c++) {
+        out << "# TYPE " << COUNTER_INFO[c][0] << " counter\n"
+            << "# HELP " << COUNTER_INFO[c][0] << " " << COUNTER_INFO[c][1] << "\n"
+            << COUNTER_INFO[c][0] << "_total " << sumShards([c](MetricShard& s) -> auto& { return s.counters[c]; })
+            << "\n";
+    }
+
+    out << "# TYPE hyfocus_blocked counter\n"
+        << "# HELP hyfocus_blocked Blocked switches, focus changes and launches by rule action\n";
+    for (size_t e = 0; e < EVENTS; e++) {
+        // Allow never blocks, skip it
+        for (size_t a = 1; a < ACTIONS; a++) {
+            out << "hyfocus_blocked_total{event=\"" << EVENT_NAMES[e] << "\",action=\""
+                << RuleEngine::actionName(static_cast<RuleAction>(a)) << "\"} "
+                << sumShards([e, a](MetricShard& s) -> auto& { return s.blocked[e][a]; }) << "\n";
+        }
+    }
+
+    for (size_t g = 0; g < GAUGES; g++) {
+        out << "# TYPE " << GAUGE_INFO[g][0] << " gauge\n"
+            << "# HELP " << GAUGE_INFO[g][0] << " " << GAUGE_INFO[g][1] << "\n"
+            << GAUGE_INFO[g][0] << " " << s_gauges[g].load(std::memory_order_relaxed) << "\n";
+    }
+
+    out << "# TYPE hyfocus_hook_latency_seconds histogram\n"
+        << "# HELP hyfocus_hook_latency_seconds Time spent inside HyFocus compositor hooks\n";
+    for (size_t h = 0; h < HOOKS; h++) {
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b <= BUCKETS; b++) {
+            cumulative += sumShards([h, b](MetricShard& s) -> auto& { return s.hookBuckets[h][b]; });
+            out << "hyfocus_hook_latency_seconds_bucket{hook=\"" << HOOK_NAMES[h] << "\",le=\""
+                << (b < BUCKETS ? BUCKET_LE[b] : "+Inf") << "\"} " << cumulative << "\n";
+        }
+        uint64_t sumNs = sumShards([h](MetricShard& s) -> auto& { return s.hookSumNs[h]; });
+        out << "hyfocus_hook_latency_seconds_sum{hook=\"" << HOOK_NAMES[h] << "\"} "
+            << std::format("{}.{:09}", sumNs / 1000000000, sumNs % 1000000000) << "\n"
+            << "hyfocus_hook_latency_seconds_count{hook=\"" << HOOK_NAMES[h] << "\"} " << cumulative << "\n";
+    }
+
+    out << "# EOF\n";
+    return out.str();
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+int listenUnixSocket(const std::string& path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        FE_ERR("Socket path too long: {}", path);
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+        FE_ERR("Failed to listen on {}: {}", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    chmod(path.c_str(), 0600);
+    return fd;
+}
+
+int listenLoopbackPort(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+        FE_ERR("Failed to listen on 127.0.0.1:{}: {}", port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool MetricsServer::start(const std::string& socketPath, int port) {
+    if (m_running) {
+        return true;
+    }
+
+    if (!socketPath.empty()) {
+        m_unixFd = listenUnixSocket(socketPath);
+        if (m_unixFd >= 0) m_path = socketPath;
+    }
+    if (port > 0 && port < 65536) {
+        m_tcpFd = listenLoopbackPort(port);
+    }
+    if (m_unixFd < 0 && m_tcpFd < 0) {
+        return false;
+    }
+
+    // Without it stop() could never wake the thread to join it
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0) {
+        FE_ERR("Metrics: cannot create wake fd: {}", strerror(errno));
+        stop();
+        return false;
+    }
+    m_running = true;
+    m_thread = std::thread(&MetricsServer::run, this);
+
+    FE_INFO("Metrics served on {}{}{}", m_path, (m_unixFd >= 0 && m_tcpFd >= 0) ? " and " : "",
+            m_tcpFd >= 0 ? "127.0.0.1:" + std::to_string(port) : "");
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (m_running.exchange(false)) {
+        uint64_t one = 1;
+        (void)write(m_wakeFd, &one, sizeof(one));
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    for (int* fd : {&m_unixFd, &m_tcpFd, &m_wakeFd}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+    if (!m_path.empty()) {
+        unlink(m_path.c_str());
+        m_path.clear();
+    }
+}
+
+void MetricsServer::run() {
+    applyThreadQos(WorkQos::Background);
+
+    pollfd fds[3] = {{m_wakeFd, POLLIN, 0}, {m_unixFd, POLLIN, 0}, {m_tcpFd, POLLIN, 0}};
+
+    while (m_running) {
+        if (poll(fds, 3, -1) < 0) {
+            if (errno == EINTR) continue;
+            FE_ERR("Metrics poll() failed: {}", strerror(errno));
+            return;
+        }
+
+        for (size_t i = 1; i < 3; i++) {
+            if (fds[i].fd < 0 || !(fds[i].revents & POLLIN)) {
+                continue;
+            }
+            int clientFd = accept4(fds[i].fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (clientFd >= 0) {
+                serve(clientFd);
+                close(clientFd);
+            }
+        }
+    }
+}
+
+void MetricsServer::serve(int fd) {
+    // Scrapers send a short request; don't let a silent one hold the thread
+    timeval timeout{1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buf[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        request.append(buf, n);
+    }
+
+    std::string body;
+    std::string status = "200 OK";
+    std::string type = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+    if (request.starts_with("GET ")) {
+        body = renderMetrics();
+    } else {
+        status = "405 Method Not Allowed";
+        type = "text/plain";
+        body = "GET only\n";
+    }
+
+    std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: " + type +
+                           "\r\nContent-Length: " + std::to_string(body.size()) +
+                           "\r\nConnection: close\r\n\r\n" + body;
+    size_t off = 0;
+    while (off < response.size()) {
+        ssize_t n = send(fd, response.data() + off, response.size() - off, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        off += n;
+    }
+}
@@ -0,0 +1,141 @@
+// Metrics - counters, gauges and hook latency histograms in OpenMetrics format
+#pragma once
+
+// Free of Hyprland headers so globals.hpp (and the benchmarks) can include it.
+#include "HookWatchdog.hpp"
+#include "RuleEngine.hpp"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+enum class MetricCounter : uint8_t {
+    SessionsStarted,
+    SessionsCompleted,
+    SessionsStopped,
+    Reverts,            // workspace switches undone
+    UiSpawns,           // eww/script processes started
+    IpcDroppedEvents,   // events discarded for lagging subscribers
+    IpcDisconnects,     // subscribers dropped for lagging/stalling
+    Cooldowns,          // input cooldowns started
+    SwitchesSwallowed,  // workspace binds dropped during a cooldown
+    SwitchesRedirected, // relative switches rewritten to the next allowed workspace
+    SwipesClamped,      // workspace swipes held back from a restricted workspace
+    WorkExtensions,     // work intervals extended because the user was in flow
+    HookOverruns,       // hook calls over hook_budget_us
+    COUNT
+};
+
+enum class MetricGauge : uint8_t {
+    SessionActive,
+    IpcClients,
+    IpcQueuedBytes,
+    MainQueueDepth,     // closures waiting for the compositor thread
+    IoQueueDepth,       // file writes waiting for the I/O thread
+    COUNT
+};
+
+enum class MetricHook : uint8_t {
+    Workspace,
+    ActiveWindow,
+    Spawn,
+    COUNT
+};
+
+// Counters are sharded per thread: each thread bumps its own cache line
+// with a relaxed add, and a scrape sums the shards. Gauges have a single
+// owner each and are plain atomic stores. Neither takes a lock, so the
+// scrape thread never contends with the compositor thread.
+void metricCount(MetricCounter counter, uint64_t n = 1);
+void metricBlocked(RuleEvent event, RuleAction action);
+void metricSetGauge(MetricGauge gauge, int64_t value);
+void metricHookLatency(MetricHook hook, uint64_t nanoseconds);
+
+// Times the enclosing scope on the hook clock, into the hook latency
+// histogram and the hook's budget (HookWatchdog). phase() marks where the
+// time goes, so an overrun can be pinned on a part of the hook. Time spent
+// in a HookBudgetExempt scope goes into the histogram only.
+class HookTimer {
+public:
+    explicit HookTimer(MetricHook hook);
+    ~HookTimer();
+
+    // Time from here on counts toward `name` (a string literal)
+    void phase(const char* name);
+
+    // Record now instead of at scope exit (e.g. before chaining to the original)
+    void finish();
+
+    // This hook is over budget: skip optional work
+    bool shedding() const { return hookDegraded(m_hook); }
+
+    HookTimer(const HookTimer&) = delete;
+    HookTimer& operator=(const HookTimer&) = delete;
+
+private:
+    friend class HookBudgetExempt;
+
+    MetricHook m_hook;
+    uint64_t m_start;
+    uint64_t m_phaseStart;
+    const char* m_phase{"entry"};
+    const char* m_slowestPhase{"entry"};
+    uint64_t m_slowestTicks{0};
+    uint64_t m_exemptTicks{0};        // whole call
+    uint64_t m_phaseExemptTicks{0};   // current phase
+    HookTimer* m_outer;
+    bool m_done{false};
+};
+
+// Required enforcement inside a hook: the revert or refocus dispatch and
+// the nested hook call it triggers. Not charged to the running hook's
+// budget, so blocking a switch can't be what makes it shed its feedback.
+class HookBudgetExempt {
+public:
+    HookBudgetExempt();
+    ~HookBudgetExempt();
+
+    HookBudgetExempt(const HookBudgetExempt&) = delete;
+    HookBudgetExempt& operator=(const HookBudgetExempt&) = delete;
+
+private:
+    HookTimer* m_timer;
+    uint64_t m_start{0};
+};
+
+// Whether the hook running on this thread, if any, is shedding optional work
+bool hookShedding();
+
+// Everything above as one OpenMetrics exposition, terminated by "# EOF"
+std::string renderMetrics();
+
+// Non-blocking listening sockets for the HTTP endpoints (metrics, dashboard);
+// -1 on failure, which is logged. The Unix socket is made owner-only.
+int listenUnixSocket(const std::string& path);
+int listenLoopbackPort(int port);
+
+// Serves renderMetrics() over HTTP on a Unix socket and/or a loopback TCP
+// port from its own thread. Off unless one of them is configured.
+class MetricsServer {
+public:
+    MetricsServer() = default;
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // Empty path / port 0 disables that listener; false if nothing listens
+    bool start(const std::string& socketPath, int port);
+    void stop();
+
+private:
+    void run();
+    void serve(int fd);
+
+    int m_unixFd{-1};
+    int m_tcpFd{-1};
+    int m_wakeFd{-1};
+    std::string m_path;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+};
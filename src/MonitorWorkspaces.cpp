@@ -0,0 +1,183 @@
+#include "MonitorWorkspaces.hpp"
+#include "WorkspaceEnforcer.hpp"
+
+#include <algorithm>
+
+static bool parseNumber(const std::string& str, int& out) {
+    try {
+        size_t idx = 0;
+        out = std::stoi(str, &idx);
+        return idx == str.size() && out >= 1;
+    } catch (...) {
+        return false;
+    }
+}
+
+void MonitorWorkspaces::configure(int perMonitor, std::vector<std::string> order) {
+    bool changed = perMonitor != m_perMonitor || order != m_order;
+    m_perMonitor = std::max(0, perMonitor);
+    m_order = std::move(order);
+    if (changed) {
+        relayout();
+    }
+}
+
+void MonitorWorkspaces::rebuild() {
+    m_monitors.clear();
+    if (g_pCompositor) {
+        for (const auto& pMonitor : g_pCompositor->m_monitors) {
+            if (pMonitor) {
+                m_monitors.push_back({pMonitor->m_name, pMonitor->m_id});
+            }
+        }
+    }
+    relayout();
+    FE_INFO("Monitor workspaces: {} monitors, {} per monitor", m_monitors.size(), m_perMonitor);
+}
+
+void MonitorWorkspaces::onMonitorAdded(PHLMONITOR pMonitor) {
+    if (!pMonitor) {
+        return;
+    }
+    auto it = std::ranges::find(m_monitors, pMonitor->m_name, &MonitorSlot::name);
+    if (it != m_monitors.end()) {
+        it->id = pMonitor->m_id;
+    } else {
+        m_monitors.push_back({pMonitor->m_name, pMonitor->m_id});
+    }
+    relayout();
+}
+
+void MonitorWorkspaces::onMonitorRemoved(PHLMONITOR pMonitor) {
+    if (!pMonitor || std::erase_if(m_monitors, [&](const MonitorSlot& slot) { return slot.name == pMonitor->m_name; }) == 0) {
+        return;
+    }
+    relayout();
+}
+
+void MonitorWorkspaces::relayout() {
+    auto rank = [this](const MonitorSlot& slot) {
+        auto it = std::ranges::find(m_order, slot.name);
+        return std::pair{static_cast<size_t>(it - m_order.begin()), slot.id};
+    };
+    std::ranges::sort(m_monitors, [&](const MonitorSlot& a, const MonitorSlot& b) { return rank(a) < rank(b); });
+
+    // Swap the session's relative entries over to their new IDs
+    if (!m_pinned.empty() && g_fe_enforcer && g_fe_is_session_active.load()) {
+        std::vector<WORKSPACEID> compiled = compilePinned();
+        if (compiled != m_compiled) {
+            for (WORKSPACEID id : m_compiled) {
+                if (!std::ranges::binary_search(compiled, id) && !std::ranges::binary_search(m_absolute, id)) {
+                    g_fe_enforcer->removeAllowedWorkspace(id);
+                }
+            }
+            for (WORKSPACEID id : compiled) {
+                if (!std::ranges::binary_search(m_compiled, id)) {
+                    g_fe_enforcer->addAllowedWorkspace(id);
+                }
+            }
+            FE_INFO("Monitor layout changed, session workspaces now follow {} monitors", m_monitors.size());
+            m_compiled = std::move(compiled);
+        }
+    }
+}
+
+bool MonitorWorkspaces::isRelative(const std::string& token) {
+    return token.find(':') != std::string::npos;
+}
+
+WORKSPACEID MonitorWorkspaces::absoluteId(const std::string& monitor, int number) const {
+    if (!enabled() || number < 1 || number > m_perMonitor) {
+        return 0;
+    }
+    auto it = std::ranges::find(m_monitors, monitor, &MonitorSlot::name);
+    if (it == m_monitors.end()) {
+        return 0;
+    }
+    return static_cast<WORKSPACEID>(it - m_monitors.begin()) * m_perMonitor + number;
+}
+
+bool MonitorWorkspaces::resolve(const std::string& token, std::vector<WORKSPACEID>& out,
+                                std::vector<RelativeWorkspace>* relative, std::string& error) const {
+    size_t colon = token.rfind(':');
+    if (!isRelative(token)) {
+        int id = 0;
+        if (!parseNumber(token, id)) {
+            error = "invalid workspace ID '" + token + "'";
+            return false;
+        }
+        out.push_back(id);
+        return true;
+    }
+
+    RelativeWorkspace entry{token.substr(0, colon), 0};
+    if (!parseNumber(token.substr(colon + 1), entry.number)) {
+        error = "invalid workspace number in '" + token + "'";
+        return false;
+    }
+    if (!enabled()) {
+        error = "'" + token + "' needs workspaces_per_monitor to be set";
+        return false;
+    }
+    if (entry.number > m_perMonitor) {
+        error = "'" + token + "': monitors only have " + std::to_string(m_perMonitor) + " workspaces";
+        return false;
+    }
+
+    if (entry.monitor.empty()) {
+        auto focusState = Desktop::focusState();
+        auto pMonitor = focusState ? focusState->monitor() : nullptr;
+        if (!pMonitor) {
+            error = "no focused monitor for '" + token + "'";
+            return false;
+        }
+        entry.monitor = pMonitor->m_name;
+    }
+
+    if (entry.monitor == "*") {
+        for (size_t i = 0; i < m_monitors.size(); i++) {
+            out.push_back(static_cast<WORKSPACEID>(i) * m_perMonitor + entry.number);
+        }
+    } else if (WORKSPACEID id = absoluteId(entry.monitor, entry.number)) {
+        out.push_back(id);
+    } else {
+        error = "no monitor named '" + entry.monitor + "'";
+        return false;
+    }
+
+    if (relative) {
+        relative->push_back(std::move(entry));
+    }
+    return true;
+}
+
+std::vector<WORKSPACEID> MonitorWorkspaces::compilePinned() const {
+    std::vector<WORKSPACEID> ids;
+    std::string error;
+    for (const auto& entry : m_pinned) {
+        // A pinned monitor that's unplugged contributes nothing until it returns
+        resolve(entry.monitor + ":" + std::to_string(entry.number), ids, nullptr, error);
+    }
+    std::ranges::sort(ids);
+    ids.erase(std::ranges::unique(ids).begin(), ids.end());
+    return ids;
+}
+
+void MonitorWorkspaces::pin(std::vector<RelativeWorkspace> relative, std::vector<WORKSPACEID> absolute) {
+    m_pinned = std::move(relative);
+    m_compiled = compilePinned();
+    m_absolute.clear();
+    keep(absolute);
+}
+
+void MonitorWorkspaces::keep(const std::vector<WORKSPACEID>& ids) {
+    m_absolute.insert(m_absolute.end(), ids.begin(), ids.end());
+    std::ranges::sort(m_absolute);
+    m_absolute.erase(std::ranges::unique(m_absolute).begin(), m_absolute.end());
+}
+
+void MonitorWorkspaces::unpin() {
+    m_pinned.clear();
+    m_compiled.clear();
+    m_absolute.clear();
+}
@@ -0,0 +1,79 @@
+// MonitorWorkspaces - monitor-relative workspace numbers for per-monitor workspace plugins
+#pragma once
+
+#include "globals.hpp"
+#include <string>
+#include <vector>
+
+// Workspace `number` (1-based) of a monitor, as split-monitor-workspaces and
+// hyprsplit count them. monitor "*" means that number on every monitor.
+struct RelativeWorkspace {
+    std::string monitor;
+    int number{0};
+};
+
+// Per-monitor workspace plugins give each monitor its own block of
+// `perMonitor` IDs: the Nth monitor's workspace k is N * perMonitor + k.
+// This keeps that monitor -> offset table, updated from monitor add/remove
+// events, so allowlists can name "DP-1:3" instead of whatever ID that is
+// today. Monitors named in `order` take the first blocks, in that order;
+// the rest follow by monitor ID, which is how the plugins lay them out.
+//
+// Relative entries are compiled to absolute IDs when a list is parsed, so
+// the enforcer's bitmap and the per-switch checks never see them. Those on
+// the running session's allowlist are pinned: when monitors come or go and
+// the offsets shift, the IDs they compiled to are swapped for the new ones.
+// An ID the allowlist also names outright ("3,DP-1:3") is left alone.
+//
+// Compositor thread only (monitor events, dispatchers, IPC, config reload).
+class MonitorWorkspaces {
+public:
+    MonitorWorkspaces() = default;
+    ~MonitorWorkspaces() = default;
+
+    // perMonitor 0 turns translation off
+    void configure(int perMonitor, std::vector<std::string> order);
+    bool enabled() const { return m_perMonitor > 0; }
+
+    // Full scan, used once at startup
+    void rebuild();
+
+    void onMonitorAdded(PHLMONITOR pMonitor);
+    void onMonitorRemoved(PHLMONITOR pMonitor);
+
+    // One allowlist entry: "4" (absolute), "DP-1:3", ":3" (focused monitor)
+    // or "*:3" (every monitor). Appends the absolute IDs to `out`; relative
+    // entries also go to `relative`, if given, for pin().
+    bool resolve(const std::string& token, std::vector<WORKSPACEID>& out,
+                 std::vector<RelativeWorkspace>* relative, std::string& error) const;
+
+    // "DP-1:3", ":3", "*:3" - anything resolve() would pin
+    static bool isRelative(const std::string& token);
+
+    // 0 if the monitor isn't connected or translation is off
+    WORKSPACEID absoluteId(const std::string& monitor, int number) const;
+
+    // Follow these on the session allowlist until unpin(). `absolute` are the
+    // IDs the same list named outright; swapping never removes those.
+    void pin(std::vector<RelativeWorkspace> relative, std::vector<WORKSPACEID> absolute);
+    // Allowed outright later in the session (hyfocus:allow, batch allow)
+    void keep(const std::vector<WORKSPACEID>& ids);
+    void unpin();
+
+private:
+    struct MonitorSlot {
+        std::string name;
+        MONITORID id{0};
+    };
+
+    void relayout();
+    std::vector<WORKSPACEID> compilePinned() const;
+
+    int m_perMonitor{0};
+    std::vector<std::string> m_order;
+    std::vector<MonitorSlot> m_monitors;   // in block order: offset = index * m_perMonitor
+
+    std::vector<RelativeWorkspace> m_pinned;
+    std::vector<WORKSPACEID> m_compiled;   // what m_pinned put on the allowlist
+    std::vector<WORKSPACEID> m_absolute;   // on it regardless of m_pinned; sorted
+};
@@ -0,0 +1,473 @@
+#include "RuleEngine.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <sstream>
+
+static std::string_view trimView(std::string_view s) {
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front()))) s.remove_prefix(1);
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) s.remove_suffix(1);
+    return s;
+}
+
+static bool parseInt(std::string_view s, int64_t& out) {
+    s = trimView(s);
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    return ec == std::errc() && ptr == s.data() + s.size();
+}
+
+// "HH:MM" -> minutes since midnight
+static bool parseClock(std::string_view s, uint32_t& out) {
+    size_t colon = s.find(':');
+    int64_t h, m;
+    if (colon == std::string_view::npos || !parseInt(s.substr(0, colon), h) || !parseInt(s.substr(colon + 1), m) ||
+        h < 0 || h > 23 || m < 0 || m > 59) {
+        return false;
+    }
+    out = static_cast<uint32_t>(h * 60 + m);
+    return true;
+}
+
+// Case-insensitive substring search, pattern already lowercase
+static bool containsNoCase(std::string_view haystack, std::string_view needle) noexcept {
+    if (needle.empty()) return true;
+    if (needle.size() > haystack.size()) return false;
+    for (size_t i = 0; i + needle.size() <= haystack.size(); ++i) {
+        size_t j = 0;
+        while (j < needle.size() &&
+               std::tolower(static_cast<unsigned char>(haystack[i + j])) == needle[j]) {
+            ++j;
+        }
+        if (j == needle.size()) return true;
+    }
+    return false;
+}
+
+static const char* opName(RuleOp op) {
+    switch (op) {
+        case RuleOp::Phase: return "PHASE";
+        case RuleOp::Event: return "EVENT";
+        case RuleOp::WsMask: return "WSMASK";
+        case RuleOp::WsRanges: return "WSRANGE";
+        case RuleOp::Monitor: return "MONITOR";
+        case RuleOp::Class: return "CLASS";
+        case RuleOp::ClassSub: return "CLASS~";
+        case RuleOp::Title: return "TITLE";
+        case RuleOp::TitleSub: return "TITLE~";
+        case RuleOp::Command: return "CMD";
+        case RuleOp::CommandSub: return "CMD~";
+        case RuleOp::Time: return "TIME";
+        case RuleOp::Budget: return "BUDGET";
+        case RuleOp::Flags: return "FLAGS";
+        case RuleOp::Action: return "ACTION";
+    }
+    return "?";
+}
+
+const char* RuleEngine::actionName(RuleAction action) {
+    switch (action) {
+        case RuleAction::Allow: return "allow";
+        case RuleAction::Block: return "block";
+        case RuleAction::Redirect: return "redirect";
+        case RuleAction::Quarantine: return "quarantine";
+        case RuleAction::Freeze: return "freeze";
+    }
+    return "?";
+}
+
+uint32_t RuleEngine::intern(std::string_view str) {
+    for (size_t i = 0; i < m_strings.size(); ++i) {
+        if (m_strings[i] == str) return static_cast<uint32_t>(i);
+    }
+    m_strings.emplace_back(str);
+    return static_cast<uint32_t>(m_strings.size() - 1);
+}
+
+bool RuleEngine::compile(const std::string& source, const RuleDefaults& defaults) {
+    m_code.clear();
+    m_strings.clear();
+    m_ranges.clear();
+    m_sources.clear();
+    m_errors.clear();
+    m_usesTime = m_usesBudget = m_usesWindow = false;
+
+    // User rules, separated by ';' or newlines
+    std::string text;
+    for (char c : source) {
+        if (c == ';' || c == '\n') {
+            if (!trimView(text).empty()) compileRule(std::string(trimView(text)));
+            text.clear();
+        } else {
+            text += c;
+        }
+    }
+    if (!trimView(text).empty()) compileRule(std::string(trimView(text)));
+
+    m_userRules = m_sources.size();
+
+    // Built-in policy, equivalent to the original hand-written checks
+    compileRule("phase:idle -> allow");
+    if (!defaults.enforceDuringBreak) {
+        compileRule("phase:break -> allow");
+    }
+    compileRule("event:focus -> allow");
+    compileRule("event:switch allowed -> allow");
+    if (defaults.hasBudgets) {
+        compileRule("event:switch budget:>0 -> allow");
+    }
+    compileRule("event:spawn whitelisted -> allow");
+    compileRule("-> block");
+
+    return m_errors.empty();
+}
+
+bool RuleEngine::compileRule(const std::string& text) {
+    size_t arrow = text.find("->");
+    if (arrow == std::string::npos) {
+        m_errors.push_back("rule '" + text + "': missing '->'");
+        return false;
+    }
+
+    std::vector<RuleInsn> insns;
+    std::string_view lhs = std::string_view(text).substr(0, arrow);
+    std::string_view rhs = trimView(std::string_view(text).substr(arrow + 2));
+
+    // Conditions
+    size_t pos = 0;
+    while (pos < lhs.size()) {
+        while (pos < lhs.size() && std::isspace(static_cast<unsigned char>(lhs[pos]))) ++pos;
+        size_t end = pos;
+        while (end < lhs.size() && !std::isspace(static_cast<unsigned char>(lhs[end]))) ++end;
+        if (end > pos) {
+            std::string_view token = lhs.substr(pos, end - pos);
+            if (token != "*" && !compileCondition(token, insns)) {
+                m_errors.push_back("rule '" + text + "': bad condition '" + std::string(token) + "'");
+                return false;
+            }
+        }
+        pos = end;
+    }
+
+    // Action
+    RuleInsn action{RuleOp::Action};
+    if (rhs == "allow") {
+        action.a = static_cast<uint32_t>(RuleAction::Allow);
+    } else if (rhs == "block") {
+        action.a = static_cast<uint32_t>(RuleAction::Block);
+    } else if (rhs == "quarantine") {
+        action.a = static_cast<uint32_t>(RuleAction::Quarantine);
+    } else if (rhs == "freeze") {
+        action.a = static_cast<uint32_t>(RuleAction::Freeze);
+    } else if (rhs.starts_with("redirect:")) {
+        int64_t target;
+        if (!parseInt(rhs.substr(9), target) || target < 1) {
+            m_errors.push_back("rule '" + text + "': bad redirect target");
+            return false;
+        }
+        action.a = static_cast<uint32_t>(RuleAction::Redirect);
+        action.b = static_cast<uint64_t>(target);
+    } else {
+        m_errors.push_back("rule '" + text + "': unknown action '" + std::string(rhs) + "'");
+        return false;
+    }
+    action.skip = static_cast<uint16_t>(m_sources.size());
+    insns.push_back(action);
+
+    // A failed test jumps past the rest of this rule (including its action)
+    for (size_t i = 0; i + 1 < insns.size(); ++i) {
+        insns[i].skip = static_cast<uint16_t>(insns.size() - i);
+    }
+
+    m_code.insert(m_code.end(), insns.begin(), insns.end());
+    m_sources.push_back(text);
+    return true;
+}
+
+bool RuleEngine::compileCondition(std::string_view token, std::vector<RuleInsn>& out) {
+    RuleInsn insn{RuleOp::Flags};
+    if (token.starts_with('!')) {
+        insn.negate = true;
+        token.remove_prefix(1);
+    }
+
+    size_t colon = token.find(':');
+    std::string_view key = token.substr(0, colon);
+    std::string_view value = colon == std::string_view::npos ? std::string_view{} : token.substr(colon + 1);
+
+    // Bare flags
+    if (colon == std::string_view::npos) {
+        if (key == "allowed") insn.a = RULE_FLAG_ALLOWED;
+        else if (key == "exempt") insn.a = RULE_FLAG_EXEMPT;
+        else if (key == "whitelisted") insn.a = RULE_FLAG_WHITELISTED;
+        else return false;
+        out.push_back(insn);
+        return true;
+    }
+
+    if (value.empty()) {
+        return false;
+    }
+
+    // Splits "a|b,c" style value lists
+    auto forEachValue = [&value](auto&& fn) {
+        size_t start = 0;
+        while (start <= value.size()) {
+            size_t end = value.find_first_of(",|", start);
+            if (end == std::string_view::npos) end = value.size();
+            if (!fn(value.substr(start, end - start))) return false;
+            start = end + 1;
+        }
+        return true;
+    };
+
+    if (key == "phase") {
+        insn.op = RuleOp::Phase;
+        bool ok = forEachValue([&insn](std::string_view v) {
+            if (v == "idle") insn.a |= 1u << static_cast<int>(RulePhase::Idle);
+            else if (v == "work") insn.a |= 1u << static_cast<int>(RulePhase::Work);
+            else if (v == "break") insn.a |= 1u << static_cast<int>(RulePhase::Break);
+            else if (v == "paused") insn.a |= 1u << static_cast<int>(RulePhase::Paused);
+            else return false;
+            return true;
+        });
+        if (!ok) return false;
+    } else if (key == "event") {
+        insn.op = RuleOp::Event;
+        bool ok = forEachValue([&insn](std::string_view v) {
+            if (v == "switch") insn.a |= 1u << static_cast<int>(RuleEvent::Switch);
+            else if (v == "spawn") insn.a |= 1u << static_cast<int>(RuleEvent::Spawn);
+            else if (v == "focus") insn.a |= 1u << static_cast<int>(RuleEvent::Focus);
+            else return false;
+            return true;
+        });
+        if (!ok) return false;
+    } else if (key == "ws") {
+        std::vector<std::pair<int64_t, int64_t>> ranges;
+        bool ok = forEachValue([&ranges](std::string_view v) {
+            int64_t from, to;
+            size_t dash = v.find('-', 1);
+            if (dash == std::string_view::npos) {
+                if (!parseInt(v, from)) return false;
+                to = from;
+            } else if (!parseInt(v.substr(0, dash), from) || !parseInt(v.substr(dash + 1), to) || to < from) {
+                return false;
+            }
+            ranges.emplace_back(from, to);
+            return true;
+        });
+        if (!ok) return false;
+
+        bool fitsMask = std::all_of(ranges.begin(), ranges.end(),
+                                    [](const auto& r) { return r.first >= 1 && r.second <= 64; });
+        if (fitsMask) {
+            insn.op = RuleOp::WsMask;
+            for (auto [from, to] : ranges) {
+                for (int64_t id = from; id <= to; ++id) insn.b |= 1ull << (id - 1);
+            }
+        } else {
+            insn.op = RuleOp::WsRanges;
+            insn.a = static_cast<uint32_t>(m_ranges.size());
+            insn.b = ranges.size();
+            m_ranges.insert(m_ranges.end(), ranges.begin(), ranges.end());
+        }
+    } else if (key == "monitor" || key == "class" || key == "title" || key == "cmd") {
+        bool sub = value.starts_with('~');
+        if (sub) {
+            std::string lower(value.substr(1));
+            std::transform(lower.begin(), lower.end(), lower.begin(),
+                           [](unsigned char c) { return std::tolower(c); });
+            insn.a = intern(lower);
+        } else {
+            insn.a = intern(value);
+        }
+
+        if (key == "monitor") {
+            if (sub) return false;
+            insn.op = RuleOp::Monitor;
+        } else if (key == "class") {
+            insn.op = sub ? RuleOp::ClassSub : RuleOp::Class;
+        } else if (key == "title") {
+            insn.op = sub ? RuleOp::TitleSub : RuleOp::Title;
+        } else {
+            insn.op = sub ? RuleOp::CommandSub : RuleOp::Command;
+        }
+        if (key != "cmd") m_usesWindow = true;
+    } else if (key == "time") {
+        size_t dash = value.find('-');
+        uint32_t from, to;
+        if (dash == std::string_view::npos || !parseClock(value.substr(0, dash), from) ||
+            !parseClock(value.substr(dash + 1), to)) {
+            return false;
+        }
+        insn.op = RuleOp::Time;
+        insn.a = from;
+        insn.b = to;
+        m_usesTime = true;
+    } else if (key == "budget") {
+        // budget:>N, budget:<N, budget:N (seconds)
+        insn.op = RuleOp::Budget;
+        std::string_view num = value;
+        if (value.starts_with('>')) {
+            insn.a = 1;
+            num.remove_prefix(1);
+        } else if (value.starts_with('<')) {
+            insn.a = 2;
+            num.remove_prefix(1);
+        }
+        int64_t threshold;
+        if (!parseInt(num, threshold) || threshold < 0) return false;
+        insn.b = static_cast<uint64_t>(threshold);
+        m_usesBudget = true;
+    } else {
+        return false;
+    }
+
+    out.push_back(insn);
+    return true;
+}
+
+bool RuleEngine::test(const RuleInsn& insn, const RuleContext& ctx) const noexcept {
+    switch (insn.op) {
+        case RuleOp::Phase:
+            return insn.a & (1u << static_cast<int>(ctx.phase));
+        case RuleOp::Event:
+            return insn.a & (1u << static_cast<int>(ctx.event));
+        case RuleOp::WsMask:
+            return ctx.workspace >= 1 && ctx.workspace <= 64 && (insn.b & (1ull << (ctx.workspace - 1)));
+        case RuleOp::WsRanges:
+            for (size_t i = insn.a; i < insn.a + insn.b; ++i) {
+                if (ctx.workspace >= m_ranges[i].first && ctx.workspace <= m_ranges[i].second) return true;
+            }
+            return false;
+        case RuleOp::Monitor:
+            return ctx.monitor == m_strings[insn.a];
+        case RuleOp::Class:
+            return ctx.windowClass == m_strings[insn.a];
+        case RuleOp::ClassSub:
+            return containsNoCase(ctx.windowClass, m_strings[insn.a]);
+        case RuleOp::Title:
+            return ctx.title == m_strings[insn.a];
+        case RuleOp::TitleSub:
+            return containsNoCase(ctx.title, m_strings[insn.a]);
+        case RuleOp::Command:
+            return ctx.command == m_strings[insn.a];
+        case RuleOp::CommandSub:
+            return containsNoCase(ctx.command, m_strings[insn.a]);
+        case RuleOp::Time:
+            // Windows that wrap midnight (22:00-06:00) have from > to
+            if (insn.a <= insn.b) return ctx.minuteOfDay >= static_cast<int>(insn.a) && ctx.minuteOfDay < static_cast<int>(insn.b);
+            return ctx.minuteOfDay >= static_cast<int>(insn.a) || ctx.minuteOfDay < static_cast<int>(insn.b);
+        case RuleOp::Budget:
+            if (ctx.budgetSeconds < 0) return false;
+            if (insn.a == 1) return static_cast<uint64_t>(ctx.budgetSeconds) > insn.b;
+            if (insn.a == 2) return static_cast<uint64_t>(ctx.budgetSeconds) < insn.b;
+            return static_cast<uint64_t>(ctx.budgetSeconds) == insn.b;
+        case RuleOp::Flags:
+            return (ctx.flags & insn.a) == insn.a;
+        case RuleOp::Action:
+            return true;
+    }
+    return false;
+}
+
+RuleDecision RuleEngine::evaluate(const RuleContext& ctx) const noexcept {
+    const size_t n = m_code.size();
+    size_t pc = 0;
+
+    while (pc < n) {
+        const RuleInsn& insn = m_code[pc];
+        if (insn.op == RuleOp::Action) {
+            return {static_cast<RuleAction>(insn.a), static_cast<int64_t>(insn.b), insn.skip,
+                    insn.skip >= m_userRules};
+        }
+        pc += (test(insn, ctx) != insn.negate) ? 1 : insn.skip;
+    }
+
+    return {};
+}
+
+std::string RuleEngine::dump() const {
+    std::ostringstream out;
+    size_t rule = 0;
+    bool ruleStart = true;
+
+    for (size_t pc = 0; pc < m_code.size(); ++pc) {
+        const RuleInsn& insn = m_code[pc];
+        if (ruleStart && rule < m_sources.size()) {
+            out << "rule " << rule << (rule >= m_userRules ? " (builtin)" : "") << ": " << m_sources[rule] << "\n";
+            ruleStart = false;
+        }
+
+        char line[160];
+        std::string arg;
+        switch (insn.op) {
+            case RuleOp::Phase: {
+                static const char* names[] = {"idle", "work", "break", "paused"};
+                for (int i = 0; i < 4; ++i) {
+                    if (insn.a & (1u << i)) arg += (arg.empty() ? "" : "|") + std::string(names[i]);
+                }
+                break;
+            }
+            case RuleOp::Event: {
+                static const char* names[] = {"switch", "spawn", "focus"};
+                for (int i = 0; i < 3; ++i) {
+                    if (insn.a & (1u << i)) arg += (arg.empty() ? "" : "|") + std::string(names[i]);
+                }
+                break;
+            }
+            case RuleOp::WsMask: {
+                for (int id = 1; id <= 64; ++id) {
+                    if (insn.b & (1ull << (id - 1))) arg += (arg.empty() ? "" : ",") + std::to_string(id);
+                }
+                break;
+            }
+            case RuleOp::WsRanges:
+                for (size_t i = insn.a; i < insn.a + insn.b; ++i) {
+                    if (!arg.empty()) arg += ",";
+                    arg += std::to_string(m_ranges[i].first) + "-" + std::to_string(m_ranges[i].second);
+                }
+                break;
+            case RuleOp::Monitor:
+            case RuleOp::Class:
+            case RuleOp::ClassSub:
+            case RuleOp::Title:
+            case RuleOp::TitleSub:
+            case RuleOp::Command:
+            case RuleOp::CommandSub:
+                arg = "\"" + m_strings[insn.a] + "\"";
+                break;
+            case RuleOp::Time: {
+                char buf[32];
+                snprintf(buf, sizeof(buf), "%02u:%02u-%02u:%02u", insn.a / 60, insn.a % 60,
+                         static_cast<unsigned>(insn.b / 60), static_cast<unsigned>(insn.b % 60));
+                arg = buf;
+                break;
+            }
+            case RuleOp::Budget:
+                arg = std::string(insn.a == 1 ? ">" : insn.a == 2 ? "<" : "==") + std::to_string(insn.b);
+                break;
+            case RuleOp::Action:
+                arg = actionName(static_cast<RuleAction>(insn.a));
+                if (static_cast<RuleAction>(insn.a) == RuleAction::Redirect) arg += " " + std::to_string(insn.b);
+                break;
+            default: {
+                char buf[16];
+                snprintf(buf, sizeof(buf), "0x%x", insn.a);
+                arg = buf;
+            }
+        }
+
+        if (insn.op == RuleOp::Action) {
+            snprintf(line, sizeof(line), "  %04zu   %-8s %s\n", pc, opName(insn.op), arg.c_str());
+            ++rule;
+            ruleStart = true;
+        } else {
+            snprintf(line, sizeof(line), "  %04zu  %s%-8s %-24s else +%u\n", pc, insn.negate ? "!" : " ",
+                     opName(insn.op), arg.c_str(), insn.skip);
+        }
+        out << line;
+    }
+
+    return out.str();
+}
@@ -0,0 +1,143 @@
+// RuleEngine - declarative focus policy compiled to a flat bytecode program
+#pragma once
+
+// Deliberately free of Hyprland headers so the interpreter can be built and
+// benchmarked on its own (see bench/rule_bench.cpp).
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+enum class RuleEvent : uint8_t {
+    Switch,  // workspace change
+    Spawn,   // app launch
+    Focus    // active window change
+};
+
+enum class RulePhase : uint8_t {
+    Idle,
+    Work,
+    Break,
+    Paused
+};
+
+enum class RuleAction : uint8_t {
+    Allow,
+    Block,       // revert with feedback (shake/flash)
+    Redirect,    // go to the rule's target workspace instead
+    Quarantine,  // move the offending window to special:hyfocus-quarantine
+    Freeze       // block silently, no feedback
+};
+
+// Facts the hook computes itself (bitmask in RuleContext::flags)
+enum RuleFlag : uint8_t {
+    RULE_FLAG_ALLOWED = 1 << 0,      // workspace is in the session allowlist
+    RULE_FLAG_EXEMPT = 1 << 1,       // window class is in exception_classes
+    RULE_FLAG_WHITELISTED = 1 << 2,  // spawn command matches spawn_whitelist
+};
+
+// Everything a rule can look at. Views must outlive evaluate().
+struct RuleContext {
+    RuleEvent event{RuleEvent::Switch};
+    RulePhase phase{RulePhase::Idle};
+    int64_t workspace{0};
+    std::string_view monitor;
+    std::string_view windowClass;
+    std::string_view title;
+    std::string_view command;
+    int minuteOfDay{0};      // local time, only filled if usesTimeOfDay()
+    int budgetSeconds{-1};   // -1 = target has no budget, only filled if usesBudget()
+    uint8_t flags{0};
+};
+
+struct RuleDecision {
+    RuleAction action{RuleAction::Allow};
+    int64_t target{0};  // Redirect only
+    int rule{-1};       // index of the matching rule, -1 = fell through
+    bool builtin{false};
+};
+
+// Settings that used to be hard-coded booleans; compiled into trailing rules
+struct RuleDefaults {
+    bool enforceDuringBreak{false};
+    bool hasBudgets{false};
+};
+
+enum class RuleOp : uint8_t {
+    Phase,
+    Event,
+    WsMask,     // workspaces 1..64 as a bitmask
+    WsRanges,   // arbitrary IDs as [from, to] ranges
+    Monitor,
+    Class,
+    ClassSub,
+    Title,
+    TitleSub,
+    Command,
+    CommandSub,
+    Time,
+    Budget,
+    Flags,
+    Action
+};
+
+struct RuleInsn {
+    RuleOp op;
+    bool negate{false};
+    uint16_t skip{0};  // forward jump on failure (Action: rule index)
+    uint32_t a{0};
+    uint64_t b{0};
+};
+
+// Rules are separated by ';' or newlines and evaluated first-match-wins:
+//
+//   phase:work ws:4,5 -> block
+//   class:~discord -> quarantine
+//   time:22:00-06:00 !allowed -> freeze
+//   ws:9 budget:>0 -> allow
+//   ws:8 -> redirect:1
+//
+// Conditions in a rule are ANDed, '!' negates one. User rules run before
+// the built-in rules that encode the classic behaviour.
+class RuleEngine {
+public:
+    RuleEngine() = default;
+    ~RuleEngine() = default;
+
+    // Compile user rules + built-in defaults. Invalid rules are skipped and
+    // reported through errors(); returns false if any rule was rejected.
+    bool compile(const std::string& source, const RuleDefaults& defaults);
+
+    // Allocation-free interpreter
+    RuleDecision evaluate(const RuleContext& ctx) const noexcept;
+
+    size_t userRuleCount() const { return m_userRules; }
+    size_t ruleCount() const { return m_sources.size(); }
+    bool usesTimeOfDay() const { return m_usesTime; }
+    bool usesBudget() const { return m_usesBudget; }
+    bool usesWindow() const { return m_usesWindow; }
+
+    const std::vector<std::string>& errors() const { return m_errors; }
+
+    // Human-readable disassembly, one line per instruction
+    std::string dump() const;
+
+    static const char* actionName(RuleAction action);
+
+private:
+    bool compileRule(const std::string& text);
+    bool compileCondition(std::string_view token, std::vector<RuleInsn>& out);
+    bool test(const RuleInsn& insn, const RuleContext& ctx) const noexcept;
+    uint32_t intern(std::string_view str);
+
+    std::vector<RuleInsn> m_code;
+    std::vector<std::string> m_strings;
+    std::vector<std::pair<int64_t, int64_t>> m_ranges;
+    std::vector<std::string> m_sources;
+    std::vector<std::string> m_errors;
+    size_t m_userRules{0};
+    bool m_usesTime{false};
+    bool m_usesBudget{false};
+    bool m_usesWindow{false};
+};
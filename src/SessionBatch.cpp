@@ -0,0 +1,314 @@
+#include "SessionBatch.hpp"
+#include "dispatchers.hpp"
+#include "FocusTimer.hpp"
+#include "ExitChallenge.hpp"
+#include "WorkspaceCatalogue.hpp"
+#include "FocusHistory.hpp"
+
+static std::string trim(const std::string& s) {
+    size_t start = s.find_first_not_of(" \t\r");
+    size_t end = s.find_last_not_of(" \t\r");
+    if (start == std::string::npos) return "";
+    return s.substr(start, end - start + 1);
+}
+
+static bool isLifecycle(BatchOpType type) {
+    return type == BatchOpType::Start || type == BatchOpType::Stop ||
+           type == BatchOpType::Pause || type == BatchOpType::Resume;
+}
+
+bool SessionBatch::parse(const std::string& text) {
+    static const std::pair<const char*, BatchOpType> verbs[] = {
+        {"start", BatchOpType::Start},
+        {"stop", BatchOpType::Stop},
+        {"pause", BatchOpType::Pause},
+        {"resume", BatchOpType::Resume},
+        {"allow", BatchOpType::Allow},
+        {"disallow", BatchOpType::Disallow},
+        {"except", BatchOpType::Except},
+        {"allowapp", BatchOpType::AllowApp},
+        {"disallowapp", BatchOpType::DisallowApp},
+    };
+
+    m_ops.clear();
+    m_error.clear();
+
+    std::string normalized = text;
+    std::replace(normalized.begin(), normalized.end(), '\n', ';');
+
+    std::stringstream ss(normalized);
+    std::string item;
+    while (std::getline(ss, item, ';')) {
+        item = trim(item);
+        if (item.empty()) continue;
+
+        size_t space = item.find_first_of(" \t");
+        std::string verb = item.substr(0, space);
+        std::string arg = (space == std::string::npos) ? "" : trim(item.substr(space));
+        if (verb.starts_with("hyfocus:")) {
+            verb = verb.substr(8);
+        }
+
+        auto it = std::find_if(std::begin(verbs), std::end(verbs),
+                               [&verb](const auto& entry) { return verb == entry.first; });
+        if (it == std::end(verbs)) {
+            m_error = "unknown operation '" + verb + "'";
+            m_ops.clear();
+            return false;
+        }
+        m_ops.push_back({it->second, arg, item});
+    }
+
+    if (m_ops.empty()) {
+        m_error = "empty batch";
+        return false;
+    }
+    return true;
+}
+
+bool SessionBatch::stage(const BatchOp& op, Draft& draft, std::string& error) const {
+    if (isLifecycle(op.type)) {
+        if (draft.lifecycle) {
+            error = "only one of start/stop/pause/resume per batch";
+            return false;
+        }
+        draft.lifecycle = &op;
+    }
+
+    bool active = g_fe_is_session_active.load();
+    std::vector<WORKSPACEID> ids;
+
+    switch (op.type) {
+        case BatchOpType::Start: {
+            if (active) {
+                error = "session already running";
+                return false;
+            }
+
+            std::string spec = op.arg;
+            draft.tags = takeSessionTags(spec);
+            std::string workspaceStr = spec;
+            draft.duration = g_fe_work_interval;
+            size_t atPos = spec.find('@');
+            if (atPos != std::string::npos) {
+                workspaceStr = spec.substr(0, atPos);
+                try {
+                    draft.duration = std::stoi(spec.substr(atPos + 1));
+                } catch (...) {
+                    error = "invalid duration '" + spec.substr(atPos + 1) + "'";
+                    return false;
+                }
+                if (draft.duration < 1) {
+                    error = "duration must be >= 1 minute";
+                    return false;
+                }
+            }
+
+            // Starting replaces the allowlist; later allow/disallow ops edit it
+            draft.policy.allowedWorkspaces.clear();
+            draft.relative.clear();
+            draft.absolute.clear();
+            if (workspaceStr == "draft") {
+                if (g_fe_catalogue) {
+                    for (auto selected : g_fe_catalogue->draft()) {
+                        draft.policy.allowedWorkspaces.insert(selected);
+                        draft.absolute.push_back(selected);
+                    }
+                }
+                if (draft.policy.allowedWorkspaces.empty()) {
+                    error = "no workspaces selected";
+                    return false;
+                }
+                workspaceStr.clear();
+            }
+
+            std::stringstream ss(workspaceStr);
+            std::string token;
+            while (std::getline(ss, token, ',')) {
+                token = trim(token);
+                if (token.empty()) continue;
+                size_t before = ids.size();
+                if (!g_fe_monitor_workspaces || !g_fe_monitor_workspaces->resolve(token, ids, &draft.relative, error)) {
+                    return false;
+                }
+                if (!MonitorWorkspaces::isRelative(token)) {
+                    draft.absolute.insert(draft.absolute.end(), ids.begin() + before, ids.end());
+                }
+            }
+            draft.policy.allowedWorkspaces.insert(ids.begin(), ids.end());
+
+            if (draft.policy.allowedWorkspaces.empty()) {
+                auto focusState = Desktop::focusState();
+                auto pMonitor = focusState ? focusState->monitor() : nullptr;
+                if (!pMonitor || !pMonitor->m_activeWorkspace) {
+                    error = "no workspaces specified and no current workspace";
+                    return false;
+                }
+                draft.policy.allowedWorkspaces.insert(pMonitor->m_activeWorkspace->m_id);
+                draft.absolute.push_back(pMonitor->m_activeWorkspace->m_id);
+            }
+            return true;
+        }
+
+        case BatchOpType::Stop:
+            if (!active) {
+                error = "no focus session is running";
+                return false;
+            }
+            // Batches can't be used to skip the exit challenge
+            if (op.arg != "force" && g_fe_exitChallenge && g_fe_exitChallenge->isEnabled()) {
+                error = "exit challenge required, use hyfocus:stop";
+                return false;
+            }
+            return true;
+
+        case BatchOpType::Pause:
+            if (!active || g_fe_timer->getState() == TimerState::Paused) {
+                error = "no running session to pause";
+                return false;
+            }
+            return true;
+
+        case BatchOpType::Resume:
+            if (g_fe_timer->getState() != TimerState::Paused) {
+                error = "session is not paused";
+                return false;
+            }
+            return true;
+
+        case BatchOpType::Allow:
+        case BatchOpType::Disallow:
+            // Monitor-relative IDs are translated now and not followed afterwards
+            if (!g_fe_monitor_workspaces || !g_fe_monitor_workspaces->resolve(op.arg, ids, nullptr, error)) {
+                return false;
+            }
+            if (op.type == BatchOpType::Allow) {
+                draft.policy.allowedWorkspaces.insert(ids.begin(), ids.end());
+                draft.absolute.insert(draft.absolute.end(), ids.begin(), ids.end());
+                return true;
+            }
+            for (WORKSPACEID id : ids) {
+                draft.policy.allowedWorkspaces.erase(id);
+            }
+            if (draft.policy.allowedWorkspaces.empty() &&
+                (active || (draft.lifecycle && draft.lifecycle->type == BatchOpType::Start))) {
+                error = "session would have no allowed workspaces";
+                return false;
+            }
+            return true;
+
+        case BatchOpType::Except:
+            if (op.arg.empty()) {
+                error = "missing window class";
+                return false;
+            }
+            draft.policy.exceptionClasses.insert(op.arg);
+            return true;
+
+        case BatchOpType::AllowApp:
+        case BatchOpType::DisallowApp:
+            if (op.arg.empty()) {
+                error = "missing app name";
+                return false;
+            }
+            if (op.type == BatchOpType::AllowApp) {
+                draft.spawnWhitelist.insert(op.arg);
+            } else {
+                draft.spawnWhitelist.erase(op.arg);
+            }
+            return true;
+    }
+
+    return false;
+}
+
+BatchResult SessionBatch::apply() {
+    if (m_ops.empty()) {
+        return {false, m_error.empty() ? "empty batch" : m_error};
+    }
+    if (!g_fe_enforcer || !g_fe_timer) {
+        return {false, "not initialized"};
+    }
+
+    // Stage everything against a copy; nothing live changes until all ops pass
+    PolicySnapshot before = g_fe_enforcer->snapshot();
+    std::set<std::string> whitelistBefore = g_fe_spawn_whitelist;
+
+    Draft draft{before, whitelistBefore};
+    for (size_t i = 0; i < m_ops.size(); i++) {
+        std::string error;
+        if (!stage(m_ops[i], draft, error)) {
+            FE_WARN("Batch rejected at op {} '{}': {}", i + 1, m_ops[i].text, error);
+            return {false, "'" + m_ops[i].text + "': " + error + ". Nothing was changed."};
+        }
+    }
+
+    // Commit the policy in one step
+    g_fe_enforcer->restore(draft.policy);
+    g_fe_spawn_whitelist = draft.spawnWhitelist;
+    if (g_fe_monitor_workspaces) {
+        g_fe_monitor_workspaces->keep(draft.absolute);
+    }
+
+    bool published = false;
+    if (draft.lifecycle) {
+        switch (draft.lifecycle->type) {
+            case BatchOpType::Start: {
+                std::vector<WORKSPACEID> workspaces(draft.policy.allowedWorkspaces.begin(),
+                                                    draft.policy.allowedWorkspaces.end());
+                if (!beginSession(workspaces, draft.duration, draft.tags)) {
+                    g_fe_enforcer->restore(before);
+                    g_fe_spawn_whitelist = whitelistBefore;
+                    return {false, "failed to start focus session. Nothing was changed."};
+                }
+                if (g_fe_monitor_workspaces) {
+                    g_fe_monitor_workspaces->pin(draft.relative, draft.absolute);
+                }
+                published = true;
+                break;
+            }
+            case BatchOpType::Stop:
+                endSession();
+                published = true;
+                break;
+            case BatchOpType::Pause:
+                g_fe_timer->pause();
+                break;
+            case BatchOpType::Resume:
+                g_fe_timer->resume();
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (!published) {
+        publishState();
+    }
+
+    std::string summary;
+    for (const auto& op : m_ops) {
+        if (!summary.empty()) summary += "; ";
+        summary += op.text;
+    }
+    FE_INFO("Batch applied ({} ops): {}", m_ops.size(), summary);
+    return {true, summary};
+}
+
+BatchResult runSessionBatch(const std::string& text) {
+    SessionBatch batch;
+    BatchResult result;
+
+    if (!batch.parse(text)) {
+        result = {false, batch.error()};
+    } else {
+        result = batch.apply();
+    }
+
+    if (result.ok) {
+        showNotification("Applied: " + result.message);
+    } else {
+        showError("Batch failed: " + result.message);
+    }
+    return result;
+}
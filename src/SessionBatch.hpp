@@ -0,0 +1,70 @@
+// SessionBatch - several session edits applied as one transaction
+#pragma once
+
+#include "globals.hpp"
+#include "WorkspaceEnforcer.hpp"
+#include "MonitorWorkspaces.hpp"
+#include <set>
+#include <string>
+#include <vector>
+
+enum class BatchOpType {
+    Start,       // start [workspaces|draft][@duration] [#tag...]
+    Stop,        // stop [force]
+    Pause,
+    Resume,
+    Allow,       // allow <id|monitor:n>
+    Disallow,    // disallow <id>
+    Except,      // except <class>
+    AllowApp,    // allowapp <app>
+    DisallowApp  // disallowapp <app>
+};
+
+struct BatchOp {
+    BatchOpType type;
+    std::string arg;
+    std::string text;  // original spelling, for messages
+};
+
+struct BatchResult {
+    bool ok{false};
+    std::string message;
+};
+
+// Ops are separated by ';' or newlines and use the dispatcher names
+// (an optional "hyfocus:" prefix is accepted):
+//
+//   start 1,2@50; allow 4; allowapp firefox; except kitty
+//
+// Every op is validated and staged against a copy of the policy
+// (allowlist, exception classes, spawn whitelist). Only if all of them are
+// valid is the copy installed, followed by at most one lifecycle op
+// (start/stop/pause/resume). If that op fails the old policy is restored.
+class SessionBatch {
+public:
+    bool parse(const std::string& text);
+    BatchResult apply();
+
+    const std::string& error() const { return m_error; }
+    size_t size() const { return m_ops.size(); }
+
+private:
+    struct Draft {
+        PolicySnapshot policy;
+        std::set<std::string> spawnWhitelist;
+        const BatchOp* lifecycle{nullptr};
+        int duration{0};  // Start only
+        std::vector<std::string> tags{};  // Start only
+        std::vector<RelativeWorkspace> relative{};  // Start only, pinned once it runs
+        std::vector<WORKSPACEID> absolute{};        // allowed outright, kept through relayouts
+    };
+
+    bool stage(const BatchOp& op, Draft& draft, std::string& error) const;
+
+    std::vector<BatchOp> m_ops;
+    std::string m_error;
+};
+
+// Parse and apply, then publish one state update and one notification.
+// Shared by hyfocus:batch and the IPC socket.
+BatchResult runSessionBatch(const std::string& text);
@@ -0,0 +1,339 @@
+#include "TimeBudget.hpp"
+#include "Checkpoint.hpp"
+#include <ctime>
+
+static std::string trim(const std::string& s) {
+    size_t start = s.find_first_not_of(" \t");
+    size_t end = s.find_last_not_of(" \t");
+    if (start == std::string::npos) return "";
+    return s.substr(start, end - start + 1);
+}
+
+// "90s", "5m", "1h", bare numbers are minutes
+static std::chrono::milliseconds parseAmount(const std::string& str) {
+    size_t idx = 0;
+    long value = std::stol(str, &idx);
+    std::string unit = trim(str.substr(idx));
+
+    if (value < 0) {
+        throw std::invalid_argument("negative amount");
+    }
+
+    if (unit.empty() || unit == "m" || unit == "min") return std::chrono::minutes(value);
+    if (unit == "s" || unit == "sec") return std::chrono::seconds(value);
+    if (unit == "h") return std::chrono::hours(value);
+
+    throw std::invalid_argument("unknown unit '" + unit + "'");
+}
+
+static std::string formatMs(std::chrono::milliseconds ms) {
+    auto secs = std::chrono::duration_cast<std::chrono::seconds>(ms).count();
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%ld:%02ld", secs / 60, secs % 60);
+    return buf;
+}
+
+int TimeBudget::currentDayStamp() {
+    std::time_t t = std::time(nullptr);
+    std::tm local{};
+    localtime_r(&t, &local);
+    return (local.tm_year + 1900) * 10000 + (local.tm_mon + 1) * 100 + local.tm_mday;
+}
+
+void TimeBudget::configure(const std::string& spec) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // The charge is settled against the old bucket and re-armed below
+    auto now = Clock::now();
+    bool wasCharging = m_deadlineNs.load(std::memory_order_relaxed) != 0;
+    WORKSPACEID chargedWorkspace = m_chargedWorkspace.load();
+    std::string chargedClass = m_chargedClass;
+    settleLocked(now);
+
+    auto oldWorkspaces = std::move(m_workspaceBuckets);
+    auto oldClasses = std::move(m_classBuckets);
+    m_workspaceBuckets.clear();
+    m_classBuckets.clear();
+
+    std::stringstream ss(spec);
+    std::string token;
+    while (std::getline(ss, token, ',')) {
+        token = trim(token);
+        if (token.empty()) continue;
+
+        size_t eq = token.find('=');
+        if (eq == std::string::npos) {
+            FE_WARN("Invalid budget '{}': expected <target>=<amount>[/session|/day]", token);
+            continue;
+        }
+
+        std::string target = trim(token.substr(0, eq));
+        std::string amount = trim(token.substr(eq + 1));
+        BudgetBucket bucket;
+
+        size_t slash = amount.find('/');
+        if (slash != std::string::npos) {
+            std::string period = trim(amount.substr(slash + 1));
+            amount = trim(amount.substr(0, slash));
+            if (period == "day") {
+                bucket.period = BudgetPeriod::Day;
+            } else if (period != "session") {
+                FE_WARN("Invalid budget period '{}' in '{}'", period, token);
+                continue;
+            }
+        }
+
+        try {
+            bucket.capacity = parseAmount(amount);
+        } catch (const std::exception& e) {
+            FE_WARN("Invalid budget amount '{}': {}", amount, e.what());
+            continue;
+        }
+        bucket.tokens = bucket.capacity;
+        bucket.dayStamp = currentDayStamp();
+
+        // Carry tokens over from the previous config for the same target
+        auto carryOver = [&bucket](const BudgetBucket& old) {
+            if (old.period == bucket.period) {
+                bucket.tokens = std::min(old.tokens, bucket.capacity);
+                bucket.dayStamp = old.dayStamp;
+            }
+        };
+
+        if (target.starts_with("class:")) {
+            std::string cls = target.substr(6);
+            if (auto it = oldClasses.find(cls); it != oldClasses.end()) carryOver(it->second);
+            m_classBuckets[cls] = bucket;
+        } else {
+            WORKSPACEID id;
+            try {
+                id = std::stoi(target);
+            } catch (const std::exception& e) {
+                FE_WARN("Invalid budget target '{}': {}", target, e.what());
+                continue;
+            }
+            if (auto it = oldWorkspaces.find(id); it != oldWorkspaces.end()) carryOver(it->second);
+            m_workspaceBuckets[id] = bucket;
+        }
+    }
+
+    FE_INFO("Time budgets configured: {} workspace, {} class",
+            m_workspaceBuckets.size(), m_classBuckets.size());
+
+    // Still on the budgeted target: keep charging it. If its budget is gone
+    // or empty now, the charge is due at once and the next tick bounces.
+    if (wasCharging) {
+        BudgetBucket* bucket = findBucket(chargedWorkspace, chargedClass);
+        if (bucket) {
+            refill(*bucket, currentDayStamp());
+        }
+        armLocked(bucket, chargedWorkspace, chargedClass, now);
+    }
+}
+
+bool TimeBudget::empty() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_workspaceBuckets.empty() && m_classBuckets.empty();
+}
+
+void TimeBudget::resetSession() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    settleLocked(Clock::now());
+
+    for (auto& [id, bucket] : m_workspaceBuckets) {
+        if (bucket.period == BudgetPeriod::Session) bucket.tokens = bucket.capacity;
+    }
+    for (auto& [cls, bucket] : m_classBuckets) {
+        if (bucket.period == BudgetPeriod::Session) bucket.tokens = bucket.capacity;
+    }
+}
+
+BudgetBucket* TimeBudget::findBucket(WORKSPACEID workspaceId, const std::string& windowClass) {
+    // Workspace budgets take precedence over class budgets
+    if (auto it = m_workspaceBuckets.find(workspaceId); it != m_workspaceBuckets.end()) {
+        return &it->second;
+    }
+    if (!windowClass.empty()) {
+        if (auto it = m_classBuckets.find(windowClass); it != m_classBuckets.end()) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+void TimeBudget::refill(BudgetBucket& bucket, int today) {
+    if (bucket.period == BudgetPeriod::Day && bucket.dayStamp != today) {
+        bucket.tokens = bucket.capacity;
+        bucket.dayStamp = today;
+    }
+}
+
+void TimeBudget::settleLocked(Clock::time_point now) {
+    if (!m_charging && m_deadlineNs.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    if (m_charging) {
+        auto used = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_chargeStart);
+        m_charging->tokens = std::max(std::chrono::milliseconds(0), m_charging->tokens - used);
+        FE_DEBUG("Budget charge settled: used {}ms, {}ms left", used.count(), m_charging->tokens.count());
+    }
+
+    m_charging = nullptr;
+    m_chargedWorkspace = 0;
+    m_chargedClass.clear();
+    m_deadlineNs.store(0, std::memory_order_release);
+}
+
+void TimeBudget::armLocked(BudgetBucket* bucket, WORKSPACEID workspaceId, const std::string& windowClass,
+                           Clock::time_point now) {
+    m_charging = bucket;
+    m_chargeStart = now;
+    m_chargedWorkspace = workspaceId;
+    m_chargedClass = windowClass;
+    auto deadline = now + (bucket ? bucket->tokens : std::chrono::milliseconds(0));
+    m_deadlineNs.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           deadline.time_since_epoch()).count(),
+                       std::memory_order_release);
+}
+
+bool TimeBudget::beginAccess(WORKSPACEID workspaceId, const std::string& windowClass) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto now = Clock::now();
+
+    settleLocked(now);
+
+    BudgetBucket* bucket = findBucket(workspaceId, windowClass);
+    if (!bucket) {
+        return false;
+    }
+
+    refill(*bucket, currentDayStamp());
+    if (bucket->tokens.count() <= 0) {
+        FE_INFO("Budget for workspace {} exhausted", workspaceId);
+        return false;
+    }
+
+    armLocked(bucket, workspaceId, windowClass, now);
+
+    FE_INFO("Budgeted access to workspace {} ({} left)", workspaceId, formatMs(bucket->tokens));
+    return true;
+}
+
+void TimeBudget::endAccess() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    settleLocked(Clock::now());
+}
+
+bool TimeBudget::isExhausted(Clock::time_point now) const {
+    int64_t deadline = m_deadlineNs.load(std::memory_order_acquire);
+    if (deadline == 0) {
+        return false;
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count() >= deadline;
+}
+
+int TimeBudget::remainingSeconds(WORKSPACEID workspaceId, const std::string& windowClass) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    BudgetBucket* bucket = findBucket(workspaceId, windowClass);
+    if (!bucket) {
+        return -1;
+    }
+
+    refill(*bucket, currentDayStamp());
+    auto tokens = bucket->tokens;
+    if (bucket == m_charging) {
+        tokens -= std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - m_chargeStart);
+    }
+    return std::max(0, static_cast<int>(std::chrono::duration_cast<std::chrono::seconds>(tokens).count()));
+}
+
+std::string TimeBudget::describe() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int today = currentDayStamp();
+    auto now = Clock::now();
+
+    auto entry = [&](const std::string& name, BudgetBucket& bucket) {
+        refill(bucket, today);
+        auto tokens = bucket.tokens;
+        if (&bucket == m_charging) {
+            tokens -= std::chrono::duration_cast<std::chrono::milliseconds>(now - m_chargeStart);
+        }
+        tokens = std::max(std::chrono::milliseconds(0), tokens);
+        return name + " " + formatMs(tokens) + "/" + formatMs(bucket.capacity) +
+               (bucket.period == BudgetPeriod::Day ? " per day" : " per session");
+    };
+
+    std::string out;
+    for (auto& [id, bucket] : m_workspaceBuckets) {
+        if (!out.empty()) out += ", ";
+        out += entry("ws " + std::to_string(id), bucket);
+    }
+    for (auto& [cls, bucket] : m_classBuckets) {
+        if (!out.empty()) out += ", ";
+        out += entry(cls, bucket);
+    }
+    return out;
+}
+
+void TimeBudget::saveTo(Checkpoint& checkpoint) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Persist what a settle would leave behind, without ending the charge
+    auto now = Clock::now();
+    auto record = [&](const std::string& key, const BudgetBucket& bucket) {
+        auto tokens = bucket.tokens;
+        if (&bucket == m_charging) {
+            tokens -= std::chrono::duration_cast<std::chrono::milliseconds>(now - m_chargeStart);
+        }
+        tokens = std::max(std::chrono::milliseconds(0), tokens);
+        return key + " " + (bucket.period == BudgetPeriod::Day ? "day" : "session") + " " +
+               std::to_string(tokens.count()) + " " + std::to_string(bucket.dayStamp);
+    };
+
+    std::vector<std::string> records;
+    for (const auto& [id, bucket] : m_workspaceBuckets) {
+        records.push_back(record("ws:" + std::to_string(id), bucket));
+    }
+    for (const auto& [cls, bucket] : m_classBuckets) {
+        records.push_back(record("class:" + cls, bucket));
+    }
+    checkpoint.setSection("budgets", std::move(records));
+}
+
+void TimeBudget::loadFrom(const Checkpoint& checkpoint) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (const auto& line : checkpoint.section("budgets")) {
+        std::istringstream in(line);
+        std::string key, period;
+        long long tokensMs = 0;
+        int dayStamp = 0;
+        if (!(in >> key >> period >> tokensMs >> dayStamp)) {
+            FE_WARN("Ignoring malformed budget checkpoint record '{}'", line);
+            continue;
+        }
+
+        BudgetBucket* bucket = nullptr;
+        if (key.starts_with("class:")) {
+            auto it = m_classBuckets.find(key.substr(6));
+            if (it != m_classBuckets.end()) bucket = &it->second;
+        } else if (key.starts_with("ws:")) {
+            try {
+                auto it = m_workspaceBuckets.find(std::stoi(key.substr(3)));
+                if (it != m_workspaceBuckets.end()) bucket = &it->second;
+            } catch (...) {}
+        }
+
+        // Targets removed from the config, or whose period changed, start fresh
+        BudgetPeriod recorded = (period == "day") ? BudgetPeriod::Day : BudgetPeriod::Session;
+        if (!bucket || bucket->period != recorded) {
+            continue;
+        }
+
+        bucket->tokens = std::clamp(std::chrono::milliseconds(tokensMs),
+                                    std::chrono::milliseconds(0), bucket->capacity);
+        bucket->dayStamp = dayStamp;
+    }
+}
@@ -0,0 +1,87 @@
+// TimeBudget - limited access to disallowed workspaces/apps during focus
+#pragma once
+
+#include "globals.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class Checkpoint;
+
+enum class BudgetPeriod {
+    Session,  // refilled when a session starts
+    Day       // refilled on the first access of a new (local) day
+};
+
+// Token bucket measured in milliseconds of access time
+struct BudgetBucket {
+    std::chrono::milliseconds capacity{0};
+    std::chrono::milliseconds tokens{0};
+    BudgetPeriod period{BudgetPeriod::Session};
+    int dayStamp{0};  // YYYYMMDD the tokens belong to
+};
+
+// Accounting only happens on focus transitions: entering a budgeted target
+// starts a charge, leaving it debits the elapsed time. While a charge runs,
+// its exhaustion deadline is a single atomic the timer thread can compare
+// against without taking locks.
+class TimeBudget {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TimeBudget() = default;
+    ~TimeBudget() = default;
+
+    // Spec: "4=5m/session, 7=15m/day, class:discord=10m/day"
+    // Existing buckets keep their tokens so a config reload can't refill them,
+    // and a running charge carries on against the new bucket.
+    void configure(const std::string& spec);
+    bool empty() const;
+
+    // Refill every per-session bucket (called on session start)
+    void resetSession();
+
+    // Focus landed on a disallowed workspace. Settles any running charge and,
+    // if the workspace (or the focused window's class) has tokens left,
+    // starts charging it. Returns true if access is granted.
+    bool beginAccess(WORKSPACEID workspaceId, const std::string& windowClass);
+
+    // Focus left the budgeted target: debit the elapsed time
+    void endAccess();
+
+    bool isCharging() const { return m_deadlineNs.load(std::memory_order_acquire) != 0; }
+    WORKSPACEID chargedWorkspace() const { return m_chargedWorkspace.load(); }
+
+    // True once the running charge has drained its bucket
+    bool isExhausted(Clock::time_point now = Clock::now()) const;
+
+    // Seconds left for this target, -1 if it has no budget
+    int remainingSeconds(WORKSPACEID workspaceId, const std::string& windowClass);
+
+    std::string describe();
+
+    void saveTo(Checkpoint& checkpoint);
+    void loadFrom(const Checkpoint& checkpoint);
+
+private:
+    BudgetBucket* findBucket(WORKSPACEID workspaceId, const std::string& windowClass);
+    void refill(BudgetBucket& bucket, int today);
+    void settleLocked(Clock::time_point now);
+    // Start charging `bucket` (nullptr: a charge that is already due)
+    void armLocked(BudgetBucket* bucket, WORKSPACEID workspaceId, const std::string& windowClass,
+                   Clock::time_point now);
+    static int currentDayStamp();
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<WORKSPACEID, BudgetBucket> m_workspaceBuckets;
+    std::unordered_map<std::string, BudgetBucket> m_classBuckets;
+
+    // Running charge (node-based maps keep the pointer stable)
+    BudgetBucket* m_charging{nullptr};
+    Clock::time_point m_chargeStart;
+    std::atomic<WORKSPACEID> m_chargedWorkspace{0};
+    std::string m_chargedClass;            // to find the bucket again after a reload
+    std::atomic<int64_t> m_deadlineNs{0};  // steady_clock ns, 0 = no charge
+};
@@ -0,0 +1,121 @@
+#include "WindowLock.hpp"
+
+#include <algorithm>
+
+void WindowLock::add(PHLWINDOW pWindow, bool byClass) {
+    if (!pWindow || allows(pWindow.get())) {
+        return;
+    }
+    m_windows.push_back(pWindow.get());
+    m_members.push_back({pWindow, pWindow->m_initialClass, byClass});
+}
+
+void WindowLock::lockWindow(PHLWINDOW pWindow) {
+    if (!pWindow) {
+        return;
+    }
+    add(pWindow, false);
+    m_last = pWindow;
+    FE_INFO("Window lock: added {} ({})", pWindow->m_initialClass, pWindow->m_title);
+}
+
+int WindowLock::lockClass(const std::string& windowClass) {
+    if (std::find(m_classes.begin(), m_classes.end(), windowClass) == m_classes.end()) {
+        m_classes.push_back(windowClass);
+    }
+
+    int matched = 0;
+    for (const auto& pWindow : g_pCompositor->m_windows) {
+        if (pWindow && pWindow->m_isMapped && pWindow->m_initialClass == windowClass) {
+            add(pWindow, true);
+            matched++;
+        }
+    }
+    FE_INFO("Window lock: class {} ({} open)", windowClass, matched);
+    return matched;
+}
+
+void WindowLock::clear() {
+    m_windows.clear();
+    m_members.clear();
+    m_classes.clear();
+    m_orphans.clear();
+    m_last.reset();
+}
+
+bool WindowLock::allows(const CWindow* pWindow) const {
+    for (const CWindow* locked : m_windows) {
+        if (locked == pWindow) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WindowLock::onWindowOpened(PHLWINDOW pWindow) {
+    if (!pWindow || !isActive()) {
+        return;
+    }
+
+    const std::string& windowClass = pWindow->m_initialClass;
+    if (std::find(m_classes.begin(), m_classes.end(), windowClass) != m_classes.end()) {
+        add(pWindow, true);
+        FE_DEBUG("Window lock: new {} window joins by class", windowClass);
+        return;
+    }
+
+    auto orphan = std::find(m_orphans.begin(), m_orphans.end(), windowClass);
+    if (orphan != m_orphans.end()) {
+        m_orphans.erase(orphan);
+        add(pWindow, false);
+        FE_INFO("Window lock: reopened {} window rebound", windowClass);
+    }
+}
+
+void WindowLock::onWindowClosed(PHLWINDOW pWindow) {
+    if (!pWindow) {
+        return;
+    }
+
+    auto it = std::find(m_windows.begin(), m_windows.end(), pWindow.get());
+    if (it == m_windows.end()) {
+        return;
+    }
+
+    // Erase by position so the address can't linger for a future window
+    size_t index = it - m_windows.begin();
+    if (!m_members[index].byClass) {
+        m_orphans.push_back(m_members[index].windowClass);
+    }
+    m_windows.erase(it);
+    m_members.erase(m_members.begin() + index);
+}
+
+void WindowLock::onFocused(PHLWINDOW pWindow) {
+    if (pWindow && allows(pWindow.get())) {
+        m_last = pWindow;
+    }
+}
+
+PHLWINDOW WindowLock::bounceTarget() const {
+    if (auto last = m_last.lock(); last && allows(last.get())) {
+        return last;
+    }
+    for (const auto& member : m_members) {
+        if (auto pWindow = member.window.lock()) {
+            return pWindow;
+        }
+    }
+    return nullptr;
+}
+
+std::string WindowLock::describe() const {
+    std::string text = std::to_string(m_windows.size()) + (m_windows.size() == 1 ? " window" : " windows");
+    for (const auto& windowClass : m_classes) {
+        text += ", class " + windowClass;
+    }
+    if (!m_orphans.empty()) {
+        text += ", " + std::to_string(m_orphans.size()) + " waiting to reopen";
+    }
+    return text;
+}
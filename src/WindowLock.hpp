@@ -0,0 +1,59 @@
+// WindowLock - restricts focus to a chosen set of windows
+#pragma once
+
+#include "globals.hpp"
+#include <string>
+#include <vector>
+
+// Deep-work mode below the workspace level: while a session runs, focus may
+// only rest on the locked windows, either picked one by one ("current") or
+// every window of a class. Focus moving anywhere else is bounced back to the
+// last locked window that had it.
+//
+// Membership is a pointer-identity scan over a flat vector - a lock holds a
+// handful of windows, so this beats hashing on every focus change. Windows
+// leave the set when they close. A window locked by class brings every new
+// window of that class in; one locked on its own leaves its class behind,
+// and the next window of that class to open takes its place (an editor or
+// terminal restarted mid-session stays locked).
+//
+// Compositor thread only.
+class WindowLock {
+public:
+    WindowLock() = default;
+    ~WindowLock() = default;
+
+    void lockWindow(PHLWINDOW pWindow);
+    // Returns how many open windows the class matched
+    int lockClass(const std::string& windowClass);
+    void clear();
+
+    bool isActive() const { return !m_windows.empty() || !m_classes.empty() || !m_orphans.empty(); }
+    bool allows(const CWindow* pWindow) const;
+    size_t windowCount() const { return m_windows.size(); }
+
+    void onWindowOpened(PHLWINDOW pWindow);
+    void onWindowClosed(PHLWINDOW pWindow);
+    void onFocused(PHLWINDOW pWindow);
+
+    // Where to send focus back to: the last locked window focused, else any
+    PHLWINDOW bounceTarget() const;
+
+    // "2 windows, class kitty" for the status line
+    std::string describe() const;
+
+private:
+    void add(PHLWINDOW pWindow, bool byClass);
+
+    struct Member {
+        PHLWINDOWREF window;
+        std::string windowClass;
+        bool byClass{false};
+    };
+
+    std::vector<const CWindow*> m_windows;  // membership test, parallel to m_members
+    std::vector<Member> m_members;
+    std::vector<std::string> m_classes;     // locked as a whole
+    std::vector<std::string> m_orphans;     // classes of single windows that closed, one entry each
+    PHLWINDOWREF m_last;
+};
@@ -0,0 +1,208 @@
+#include "WorkerRuntime.hpp"
+#include "globals.hpp"
+#include <iterator>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+
+static constexpr int BACKGROUND_NICE = 10;
+
+static const char* QOS_NAMES[] = {"interactive", "background", "idle"};
+static const char* THREAD_TAGS[] = {"ui", "bg", "idle"};   // thread names are 15 chars at most
+
+// Which class and deque the current thread works, for submissions from tasks
+static thread_local const void* t_class = nullptr;
+static thread_local size_t t_index = 0;
+
+void applyThreadQos(WorkQos qos) {
+    int policy = qos == WorkQos::Idle ? SCHED_IDLE : qos == WorkQos::Background ? SCHED_BATCH : SCHED_OTHER;
+    sched_param param{};
+    if (pthread_setschedparam(pthread_self(), policy, &param) != 0) {
+        FE_DEBUG("Thread keeps its scheduling policy ({} refused)", QOS_NAMES[static_cast<size_t>(qos)]);
+    }
+
+    // nice is per thread on Linux; SCHED_IDLE ignores it
+    if (qos != WorkQos::Idle) {
+        (void)setpriority(PRIO_PROCESS, static_cast<id_t>(gettid()), qos == WorkQos::Background ? BACKGROUND_NICE : 0);
+    }
+
+    if (qos != WorkQos::Interactive && !g_fe_worker_cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : g_fe_worker_cpus) {
+            CPU_SET(cpu, &set);
+        }
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+            FE_WARN("Cannot pin {} thread to worker_cpus", QOS_NAMES[static_cast<size_t>(qos)]);
+        }
+    }
+}
+
+bool parseCpuList(const std::string& spec, std::vector<int>& out, std::string& error) {
+    out.clear();
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        int first = 0, last = 0;
+        char dash = 0;
+        std::istringstream in(item);
+        if (!(in >> first)) {
+            error = "bad CPU '" + item + "'";
+            return false;
+        }
+        last = first;
+        if (in >> dash && (dash != '-' || !(in >> last))) {
+            error = "bad CPU range '" + item + "'";
+            return false;
+        }
+        if (first < 0 || last < first || last >= CPU_SETSIZE) {
+            error = "CPU range '" + item + "' out of bounds";
+            return false;
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            out.push_back(cpu);
+        }
+    }
+    if (out.empty()) {
+        error = "no CPUs in '" + spec + "'";
+        return false;
+    }
+    return true;
+}
+
+WorkerRuntime::~WorkerRuntime() {
+    stop();
+}
+
+bool WorkerRuntime::start() {
+    if (m_running) {
+        return true;
+    }
+    m_stopping = false;
+
+    for (size_t c = 0; c < std::size(m_classes); c++) {
+        Class& cls = m_classes[c];
+        while (cls.workers.size() < THREADS[c]) {
+            cls.workers.push_back(std::make_unique<Worker>());
+        }
+        for (size_t i = 0; i < THREADS[c]; i++) {
+            try {
+                cls.threads.emplace_back(&WorkerRuntime::run, this, static_cast<WorkQos>(c), i);
+            } catch (const std::system_error& e) {
+                FE_ERR("Failed to start {} worker: {}", QOS_NAMES[c], e.what());
+                stop();
+                return false;
+            }
+        }
+    }
+
+    m_running = true;
+    FE_DEBUG("Worker runtime started ({} interactive, {} background, {} idle threads)", THREADS[0], THREADS[1],
+             THREADS[2]);
+    return true;
+}
+
+void WorkerRuntime::stop() {
+    for (Class& cls : m_classes) {
+        {
+            // A submit holding the lock gets its task counted before workers
+            // can see us stopping; one after it sees m_running false
+            std::lock_guard<std::mutex> lock(cls.mutex);
+            m_running = false;
+            m_stopping = true;
+        }
+        cls.wake.notify_all();
+    }
+    for (Class& cls : m_classes) {
+        for (auto& thread : cls.threads) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+        cls.threads.clear();
+    }
+}
+
+bool WorkerRuntime::submit(WorkQos qos, std::function<void()> task) {
+    Class& cls = m_classes[static_cast<size_t>(qos)];
+    {
+        // Checked and counted under the lock workers decide to exit under, so
+        // a task is never queued after they have gone. It also orders us
+        // against a worker between its check and its wait.
+        std::lock_guard<std::mutex> lock(cls.mutex);
+        if (!m_running) {
+            return false;
+        }
+
+        cls.pending.fetch_add(1);
+        bool own = t_class == &cls;
+        size_t index = own ? t_index : cls.next.fetch_add(1, std::memory_order_relaxed) % cls.workers.size();
+        Worker& worker = *cls.workers[index];
+        std::lock_guard<std::mutex> workerLock(worker.mutex);
+        if (own) {
+            worker.tasks.push_back(std::move(task));
+        } else {
+            worker.tasks.push_front(std::move(task));
+        }
+    }
+    cls.wake.notify_one();
+    return true;
+}
+
+bool WorkerRuntime::take(Class& cls, size_t index, std::function<void()>& task) {
+    // Own deque from the back, then siblings' from the front
+    for (size_t n = 0; n < cls.workers.size(); n++) {
+        Worker& worker = *cls.workers[(index + n) % cls.workers.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty()) {
+            continue;
+        }
+        if (n == 0) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+        } else {
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+        }
+        cls.pending.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void WorkerRuntime::run(WorkQos qos, size_t index) {
+    Class& cls = m_classes[static_cast<size_t>(qos)];
+    t_class = &cls;
+    t_index = index;
+
+    char name[16];
+    snprintf(name, sizeof(name), "hyfocus-%s%zu", THREAD_TAGS[static_cast<size_t>(qos)], index);
+    pthread_setname_np(pthread_self(), name);
+    applyThreadQos(qos);
+
+    std::function<void()> task;
+    while (true) {
+        if (take(cls, index, task)) {
+            try {
+                task();
+            } catch (const std::exception& e) {
+                FE_ERR("{} task threw exception: {}", QOS_NAMES[static_cast<size_t>(qos)], e.what());
+            }
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(cls.mutex);
+        cls.wake.wait(lock, [&] { return cls.pending.load() > 0 || m_stopping; });
+        if (m_stopping && cls.pending.load() == 0) {
+            return;
+        }
+    }
+}
+
+void runInBackground(WorkQos qos, std::function<void()> task) {
+    if (g_fe_workers && g_fe_workers->submit(qos, task)) {
+        return;
+    }
+    std::thread(std::move(task)).detach();
+}
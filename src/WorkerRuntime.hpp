@@ -0,0 +1,84 @@
+// WorkerRuntime - background work on a few threads per QoS class
+#pragma once
+
+// Free of Hyprland headers so globals.hpp can include it.
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class WorkQos : uint8_t {
+    Interactive,    // someone is waiting on it: widget and UI commands
+    Background,     // history appends, file I/O, calendar parsing, metrics
+    Idle,           // only when nothing else wants the CPU: dashboard, exports
+    COUNT
+};
+
+// Scheduling for the calling thread. Interactive is plain SCHED_OTHER at
+// nice 0 (not whatever the compositor thread was started with), Background
+// SCHED_BATCH at nice 10, Idle SCHED_IDLE; the last two are also pinned to
+// worker_cpus when it is set. Loops that block on their own fds (I/O service,
+// calendar watcher, metrics and dashboard listeners) keep their thread and
+// call this when it starts.
+void applyThreadQos(WorkQos qos);
+
+// "2,3" or "4-7" -> CPU numbers; false (with error) on a malformed list
+bool parseCpuList(const std::string& spec, std::vector<int>& out, std::string& error);
+
+// Short tasks that used to get a thread each. Every class has its own
+// threads (Interactive 2, Background 2, Idle 1), so a slow export never
+// delays a widget command and none of them run at the compositor's priority.
+//
+// Within a class each worker has a deque. A task submitted from one of the
+// class's workers goes to the back of its own deque and is popped from there
+// (LIFO: the data it touches is still warm); others are spread round-robin.
+// A worker whose deque is empty steals from the front of a sibling's before
+// going to sleep.
+class WorkerRuntime {
+public:
+    static constexpr size_t THREADS[] = {2, 2, 1};
+
+    WorkerRuntime() = default;
+    ~WorkerRuntime();
+
+    WorkerRuntime(const WorkerRuntime&) = delete;
+    WorkerRuntime& operator=(const WorkerRuntime&) = delete;
+
+    bool start();
+
+    // Runs everything already queued, then joins
+    void stop();
+
+    // Thread-safe; false when not running
+    bool submit(WorkQos qos, std::function<void()> task);
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+    struct Class {
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::vector<std::thread> threads;
+        std::atomic<size_t> pending{0};
+        std::atomic<size_t> next{0};
+        std::mutex mutex;               // only for sleeping on wake
+        std::condition_variable wake;
+    };
+
+    void run(WorkQos qos, size_t index);
+    bool take(Class& cls, size_t index, std::function<void()>& task);
+
+    Class m_classes[static_cast<size_t>(WorkQos::COUNT)];
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_stopping{false};
+};
+
+// Submit to g_fe_workers, or a detached thread without it (before init, after shutdown)
+void runInBackground(WorkQos qos, std::function<void()> task);
@@ -0,0 +1,262 @@
+#include "WorkspaceCatalogue.hpp"
+
+static bool parseWorkspaceId(const std::string& str, WORKSPACEID& out) {
+    try {
+        size_t idx = 0;
+        out = std::stoi(str, &idx);
+        return idx == str.size() && out >= 1;
+    } catch (...) {
+        return false;
+    }
+}
+
+std::string WorkspaceCatalogue::classOf(const PHLWINDOW& pWindow) {
+    // Some clients only set their class after mapping
+    return pWindow->m_class.empty() ? pWindow->m_initialClass : pWindow->m_class;
+}
+
+void WorkspaceCatalogue::rebuild() {
+    m_entries.clear();
+    m_windows.clear();
+
+    if (!g_pCompositor) {
+        return;
+    }
+
+    for (const auto& pWorkspace : g_pCompositor->m_workspaces) {
+        if (pWorkspace) {
+            onWorkspaceCreated(pWorkspace.get());
+        }
+    }
+    for (const auto& pWindow : g_pCompositor->m_windows) {
+        if (pWindow && pWindow->m_isMapped) {
+            onWindowOpened(pWindow);
+        }
+    }
+
+    m_dirty = true;
+    FE_INFO("Workspace catalogue: {} workspaces, {} windows", m_entries.size(), m_windows.size());
+}
+
+CatalogueEntry& WorkspaceCatalogue::entryFor(const CWorkspace* pWorkspace) {
+    CatalogueEntry& entry = m_entries[pWorkspace->m_id];
+    entry.id = pWorkspace->m_id;
+    entry.name = pWorkspace->m_name;
+    if (auto pMonitor = pWorkspace->m_monitor.lock()) {
+        entry.monitor = pMonitor->m_name;
+    }
+    return entry;
+}
+
+bool WorkspaceCatalogue::onWorkspaceCreated(const CWorkspace* pWorkspace) {
+    // Special workspaces can't be part of a session
+    if (!pWorkspace || pWorkspace->m_isSpecialWorkspace || pWorkspace->m_id < 1) {
+        return false;
+    }
+
+    entryFor(pWorkspace);
+    m_dirty = true;
+    return true;
+}
+
+bool WorkspaceCatalogue::onWorkspaceDestroyed(const CWorkspace* pWorkspace) {
+    if (!pWorkspace || !m_entries.erase(pWorkspace->m_id)) {
+        return false;
+    }
+
+    std::erase_if(m_windows, [id = pWorkspace->m_id](const auto& item) {
+        return item.second.workspace == id;
+    });
+    m_dirty = true;
+    return true;
+}
+
+bool WorkspaceCatalogue::onWorkspaceMoved(PHLWORKSPACE pWorkspace, PHLMONITOR pMonitor) {
+    if (!pWorkspace || !pMonitor) {
+        return false;
+    }
+
+    auto it = m_entries.find(pWorkspace->m_id);
+    if (it == m_entries.end() || it->second.monitor == pMonitor->m_name) {
+        return false;
+    }
+
+    it->second.monitor = pMonitor->m_name;
+    m_dirty = true;
+    return true;
+}
+
+void WorkspaceCatalogue::countWindow(WORKSPACEID workspace, const std::string& windowClass, int delta) {
+    auto it = m_entries.find(workspace);
+    if (it == m_entries.end()) {
+        return;
+    }
+
+    CatalogueEntry& entry = it->second;
+    entry.windows = std::max(0, entry.windows + delta);
+
+    int& count = entry.classCounts[windowClass];
+    count += delta;
+    if (count <= 0) {
+        entry.classCounts.erase(windowClass);
+    }
+
+    refreshDominant(entry);
+    m_dirty = true;
+}
+
+void WorkspaceCatalogue::refreshDominant(CatalogueEntry& entry) {
+    // A handful of classes per workspace, a linear scan is fine
+    int best = 0;
+    entry.dominantClass.clear();
+    for (const auto& [cls, count] : entry.classCounts) {
+        if (count > best || (count == best && cls < entry.dominantClass)) {
+            best = count;
+            entry.dominantClass = cls;
+        }
+    }
+}
+
+bool WorkspaceCatalogue::onWindowOpened(PHLWINDOW pWindow) {
+    if (!pWindow || !pWindow->m_workspace || m_windows.contains(pWindow.get())) {
+        return false;
+    }
+
+    TrackedWindow tracked{pWindow->m_workspace->m_id, classOf(pWindow)};
+    m_windows[pWindow.get()] = tracked;
+    countWindow(tracked.workspace, tracked.windowClass, +1);
+    return m_entries.contains(tracked.workspace);
+}
+
+bool WorkspaceCatalogue::onWindowClosed(PHLWINDOW pWindow) {
+    if (!pWindow) {
+        return false;
+    }
+
+    auto it = m_windows.find(pWindow.get());
+    if (it == m_windows.end()) {
+        return false;
+    }
+
+    TrackedWindow tracked = it->second;
+    m_windows.erase(it);
+    countWindow(tracked.workspace, tracked.windowClass, -1);
+    return m_entries.contains(tracked.workspace);
+}
+
+bool WorkspaceCatalogue::onWindowMoved(PHLWINDOW pWindow, PHLWORKSPACE pWorkspace) {
+    if (!pWindow || !pWorkspace) {
+        return false;
+    }
+
+    auto it = m_windows.find(pWindow.get());
+    if (it == m_windows.end()) {
+        return onWindowOpened(pWindow);
+    }
+    if (it->second.workspace == pWorkspace->m_id) {
+        return false;
+    }
+
+    countWindow(it->second.workspace, it->second.windowClass, -1);
+    it->second.workspace = pWorkspace->m_id;
+    it->second.windowClass = classOf(pWindow);
+    countWindow(it->second.workspace, it->second.windowClass, +1);
+    return true;
+}
+
+bool WorkspaceCatalogue::editDraft(const std::string& command, std::string& error) {
+    std::istringstream in(command);
+    std::string verb, arg;
+    in >> verb >> arg;
+
+    if (verb == "clear") {
+        m_draft.clear();
+        m_dirty = true;
+        return true;
+    }
+
+    if (verb == "set") {
+        std::set<WORKSPACEID> ids;
+        std::stringstream ss(arg);
+        std::string token;
+        while (std::getline(ss, token, ',')) {
+            WORKSPACEID id;
+            if (!parseWorkspaceId(token, id)) {
+                error = "invalid workspace ID '" + token + "'";
+                return false;
+            }
+            ids.insert(id);
+        }
+        m_draft = std::move(ids);
+        m_dirty = true;
+        return true;
+    }
+
+    WORKSPACEID id;
+    if (!parseWorkspaceId(arg, id)) {
+        error = "invalid workspace ID '" + arg + "'";
+        return false;
+    }
+
+    if (verb == "toggle") {
+        if (!m_draft.erase(id)) m_draft.insert(id);
+    } else if (verb == "add") {
+        m_draft.insert(id);
+    } else if (verb == "remove") {
+        m_draft.erase(id);
+    } else {
+        error = "unknown draft command '" + verb + "' (toggle|add|remove|set|clear)";
+        return false;
+    }
+
+    m_dirty = true;
+    return true;
+}
+
+std::vector<WORKSPACEID> WorkspaceCatalogue::draft() const {
+    return std::vector<WORKSPACEID>(m_draft.begin(), m_draft.end());
+}
+
+void WorkspaceCatalogue::clearDraft() {
+    if (!m_draft.empty()) {
+        m_draft.clear();
+        m_dirty = true;
+    }
+}
+
+const std::string& WorkspaceCatalogue::toJson() {
+    if (!m_dirty) {
+        return m_json;
+    }
+
+    std::ostringstream json;
+    json << "{\"workspaces\": [";
+    bool first = true;
+    for (const auto& [id, entry] : m_entries) {
+        json << (first ? "" : ", ")
+             << "{\"id\": " << id
+             << ", \"name\": \"" << jsonEscape(entry.name) << "\""
+             << ", \"monitor\": \"" << jsonEscape(entry.monitor) << "\""
+             << ", \"windows\": " << entry.windows
+             << ", \"class\": \"" << jsonEscape(entry.dominantClass) << "\""
+             << ", \"selected\": " << (m_draft.contains(id) ? "true" : "false") << "}";
+        first = false;
+    }
+    json << "], \"draft\": [";
+    first = true;
+    for (auto id : m_draft) {
+        json << (first ? "" : ",") << id;
+        first = false;
+    }
+
+    // Lets the panel offer an empty workspace, which Hyprland hasn't created yet
+    WORKSPACEID nextFree = 1;
+    while (m_entries.contains(nextFree)) {
+        nextFree++;
+    }
+    json << "], \"next_free\": " << nextFree << "}";
+
+    m_json = json.str();
+    m_dirty = false;
+    return m_json;
+}
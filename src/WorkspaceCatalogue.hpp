@@ -0,0 +1,72 @@
+// WorkspaceCatalogue - live list of workspaces for the start panel
+#pragma once
+
+#include "globals.hpp"
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct CatalogueEntry {
+    WORKSPACEID id{0};
+    std::string name;
+    std::string monitor;
+    int windows{0};
+    std::string dominantClass;
+    std::unordered_map<std::string, int> classCounts;
+};
+
+// Kept up to date from compositor events instead of rescanning: each
+// create/destroy/move touches one entry. Windows are remembered by pointer
+// so a close or move can be debited from the workspace they were counted on.
+//
+// Also holds the draft workspace selection for the next session, which the
+// start panel edits one click at a time.
+//
+// Compositor thread only (event callbacks, dispatchers and IPC all run there).
+class WorkspaceCatalogue {
+public:
+    WorkspaceCatalogue() = default;
+    ~WorkspaceCatalogue() = default;
+
+    // Full scan, used once at startup
+    void rebuild();
+
+    // Each returns true if the catalogue changed
+    bool onWorkspaceCreated(const CWorkspace* pWorkspace);
+    bool onWorkspaceDestroyed(const CWorkspace* pWorkspace);
+    bool onWorkspaceMoved(PHLWORKSPACE pWorkspace, PHLMONITOR pMonitor);
+    bool onWindowOpened(PHLWINDOW pWindow);
+    bool onWindowClosed(PHLWINDOW pWindow);
+    bool onWindowMoved(PHLWINDOW pWindow, PHLWORKSPACE pWorkspace);
+
+    // Draft selection ("toggle 4", "add 4", "remove 4", "set 1,2", "clear")
+    bool editDraft(const std::string& command, std::string& error);
+    std::vector<WORKSPACEID> draft() const;
+    void clearDraft();
+
+    size_t size() const { return m_entries.size(); }
+
+    // {"workspaces": [{"id": 1, "name": "1", "monitor": "DP-1", "windows": 2,
+    //   "class": "kitty", "selected": true}, ...], "draft": [1], "next_free": 3}
+    const std::string& toJson();
+
+private:
+    struct TrackedWindow {
+        WORKSPACEID workspace;
+        std::string windowClass;
+    };
+
+    static std::string classOf(const PHLWINDOW& pWindow);
+    CatalogueEntry& entryFor(const CWorkspace* pWorkspace);
+    void countWindow(WORKSPACEID workspace, const std::string& windowClass, int delta);
+    void refreshDominant(CatalogueEntry& entry);
+
+    std::map<WORKSPACEID, CatalogueEntry> m_entries;  // ordered for display
+    std::unordered_map<const CWindow*, TrackedWindow> m_windows;
+    std::set<WORKSPACEID> m_draft;
+
+    std::string m_json;
+    bool m_dirty{true};
+};
@@ -1,9 +1,13 @@
 #include "WorkspaceEnforcer.hpp"
+#include "FocusTimer.hpp"
+
+#include <bit>
 
 void WorkspaceEnforcer::setAllowedWorkspaces(const std::vector<WORKSPACEID>& workspaceIds) {
     std::lock_guard<std::mutex> lock(m_mutex);
     m_allowedWorkspaces.clear();
     m_allowedWorkspaces.insert(workspaceIds.begin(), workspaceIds.end());
+    rebuildBitmap();
     
     std::string ids;
     for (auto id : workspaceIds) {
@@ -16,18 +20,21 @@ void WorkspaceEnforcer::setAllowedWorkspaces(const std::vector<WORKSPACEID>& wor
 void WorkspaceEnforcer::addAllowedWorkspace(WORKSPACEID workspaceId) {
     std::lock_guard<std::mutex> lock(m_mutex);
     m_allowedWorkspaces.insert(workspaceId);
+    rebuildBitmap();
     FE_DEBUG("Added workspace {} to allowed list", workspaceId);
 }
 
 void WorkspaceEnforcer::removeAllowedWorkspace(WORKSPACEID workspaceId) {
     std::lock_guard<std::mutex> lock(m_mutex);
     m_allowedWorkspaces.erase(workspaceId);
+    rebuildBitmap();
     FE_DEBUG("Removed workspace {} from allowed list", workspaceId);
 }
 
 void WorkspaceEnforcer::clearAllowedWorkspaces() {
     std::lock_guard<std::mutex> lock(m_mutex);
     m_allowedWorkspaces.clear();
+    rebuildBitmap();
     FE_DEBUG("Cleared all allowed workspaces");
 }
 
@@ -44,9 +51,77 @@ bool WorkspaceEnforcer::isWorkspaceAllowed(WORKSPACEID workspaceId) const {
         return true;
     }
     
+    // Every switch asks; the bitmap answers without walking the set
+    if (workspaceId <= MAX_BITMAP_WORKSPACE) {
+        return (m_allowedBits[workspaceId / 64] >> (workspaceId % 64)) & 1;
+    }
     return m_allowedWorkspaces.contains(workspaceId);
 }
 
+void WorkspaceEnforcer::rebuildBitmap() {
+    m_allowedBits.fill(0);
+    for (WORKSPACEID id : m_allowedWorkspaces) {
+        if (id > MAX_BITMAP_WORKSPACE) {
+            break;  // set is ordered
+        }
+        if (id > 0) {
+            m_allowedBits[id / 64] |= uint64_t{1} << (id % 64);
+        }
+    }
+}
+
+WORKSPACEID WorkspaceEnforcer::nextSetBit(WORKSPACEID from, bool up) const {
+    if (up) {
+        WORKSPACEID bit = from + 1;
+        if (bit < 1) {
+            bit = 1;
+        }
+        for (size_t word = bit / 64; word < m_allowedBits.size(); word++) {
+            uint64_t bits = m_allowedBits[word];
+            if (word == static_cast<size_t>(bit / 64)) {
+                bits &= ~uint64_t{0} << (bit % 64);
+            }
+            if (bits) {
+                return static_cast<WORKSPACEID>(word * 64 + std::countr_zero(bits));
+            }
+        }
+        return 0;
+    }
+    
+    WORKSPACEID bit = std::min(from - 1, MAX_BITMAP_WORKSPACE);
+    if (bit < 1) {
+        return 0;
+    }
+    for (size_t word = bit / 64 + 1; word-- > 0;) {
+        uint64_t bits = m_allowedBits[word];
+        if (word == static_cast<size_t>(bit / 64) && bit % 64 != 63) {
+            bits &= (uint64_t{1} << (bit % 64 + 1)) - 1;
+        }
+        if (bits) {
+            return static_cast<WORKSPACEID>(word * 64 + 63 - std::countl_zero(bits));
+        }
+    }
+    return 0;
+}
+
+WORKSPACEID WorkspaceEnforcer::nextAllowed(WORKSPACEID from, int steps, bool wrap) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    bool up = steps > 0;
+    WORKSPACEID at = from;
+    for (int i = 0; i < std::abs(steps); i++) {
+        WORKSPACEID next = nextSetBit(at, up);
+        if (!next && wrap) {
+            next = nextSetBit(up ? 0 : MAX_BITMAP_WORKSPACE + 1, up);
+        }
+        if (!next) {
+            return i > 0 ? at : 0;  // ran off the end: stop at the last one
+        }
+        at = next;
+    }
+    return at;
+}
+
 void WorkspaceEnforcer::addExceptionClass(const std::string& windowClass) {
     std::lock_guard<std::mutex> lock(m_mutex);
     m_exceptionClasses.insert(windowClass);
@@ -98,12 +173,61 @@ bool WorkspaceEnforcer::isWindowExempt(PHLWINDOW pWindow) const {
     return false;
 }
 
+PolicySnapshot WorkspaceEnforcer::snapshot() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return {m_allowedWorkspaces, m_exceptionClasses};
+}
+
+void WorkspaceEnforcer::restore(const PolicySnapshot& snapshot) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_allowedWorkspaces = snapshot.allowedWorkspaces;
+    m_exceptionClasses = snapshot.exceptionClasses;
+    rebuildBitmap();
+    FE_DEBUG("Policy replaced: {} allowed workspaces, {} exception classes",
+             m_allowedWorkspaces.size(), m_exceptionClasses.size());
+}
+
+RulePhase WorkspaceEnforcer::currentPhase() {
+    if (!g_fe_is_session_active.load()) {
+        return RulePhase::Idle;
+    }
+    // A paused break is still a break, so "phase:break -> allow" keeps it open
+    if (g_fe_is_break_time.load()) {
+        return RulePhase::Break;
+    }
+    if (g_fe_timer && g_fe_timer->getState() == TimerState::Paused) {
+        return RulePhase::Paused;
+    }
+    return RulePhase::Work;
+}
+
 bool WorkspaceEnforcer::shouldBlockSwitch(WORKSPACEID targetWorkspaceId) const {
     // Not blocking if no session is active
     if (!g_fe_is_session_active.load()) {
         return false;
     }
     
+    // Policy is compiled from the rules config (the break/allowlist checks
+    // are built-in rules); without it, fall back to the plain checks
+    if (g_fe_rules) {
+        RuleContext ctx;
+        ctx.event = RuleEvent::Switch;
+        ctx.phase = currentPhase();
+        ctx.workspace = targetWorkspaceId;
+        if (isWorkspaceAllowed(targetWorkspaceId)) {
+            ctx.flags |= RULE_FLAG_ALLOWED;
+        }
+        
+        RuleDecision decision = g_fe_rules->evaluate(ctx);
+        if (decision.action == RuleAction::Allow) {
+            return false;
+        }
+        
+        FE_INFO("Blocked switch to workspace {} (rule {}: {})", targetWorkspaceId, decision.rule,
+                RuleEngine::actionName(decision.action));
+        return true;
+    }
+    
     // During breaks, check if enforcement is enabled
     if (g_fe_is_break_time.load() && !m_enforceDuringBreak) {
         return false;  // Allow switches during breaks
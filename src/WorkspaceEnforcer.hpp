@@ -2,11 +2,19 @@
 #pragma once
 
 #include "globals.hpp"
+#include "RuleEngine.hpp"
 #include <algorithm>
+#include <array>
 #include <mutex>
 #include <set>
 #include <vector>
 
+// Copy of the editable policy, taken before a batch so it can be rolled back
+struct PolicySnapshot {
+    std::set<WORKSPACEID> allowedWorkspaces;
+    std::set<std::string> exceptionClasses;
+};
+
 class WorkspaceEnforcer {
 public:
     WorkspaceEnforcer() = default;
@@ -18,6 +26,12 @@ public:
     void clearAllowedWorkspaces();
     std::vector<WORKSPACEID> getAllowedWorkspaces() const;
     bool isWorkspaceAllowed(WORKSPACEID workspaceId) const;
+    
+    // Allowed workspace `steps` positions away from `from` (negative = down),
+    // skipping everything not on the allowlist. With `wrap`, runs past the
+    // last allowed workspace back to the first (and vice versa). Returns 0
+    // when there is none, e.g. an empty allowlist.
+    WORKSPACEID nextAllowed(WORKSPACEID from, int steps, bool wrap) const;
 
     void addExceptionClass(const std::string& windowClass);
     void removeExceptionClass(const std::string& windowClass);
@@ -25,17 +39,33 @@ public:
     bool isWindowClassExempt(const std::string& windowClass) const;
     bool isWindowExempt(PHLWINDOW pWindow) const;
 
+    // Read and replace the allowlist + exceptions under a single lock
+    PolicySnapshot snapshot() const;
+    void restore(const PolicySnapshot& snapshot);
+
     // Returns true if the switch should be BLOCKED
     bool shouldBlockSwitch(WORKSPACEID targetWorkspaceId) const;
 
+    // Session phase as seen by the rule engine; Paused only for paused work
+    static RulePhase currentPhase();
+
     WORKSPACEID getLastValidWorkspace() const { return m_lastValidWorkspace; }
     void setLastValidWorkspace(WORKSPACEID workspaceId) { m_lastValidWorkspace = workspaceId; }
     void setFloatingExempt(bool exempt) { m_floatingExempt = exempt; }
     void setEnforceDuringBreak(bool enforce) { m_enforceDuringBreak = enforce; }
 
 private:
+    // IDs 1..MAX_BITMAP_WORKSPACE mirrored as bits, so an allowlist check is
+    // one bit test and stepping to the next allowed one is a find-first-set
+    // per 64 workspaces
+    static constexpr WORKSPACEID MAX_BITMAP_WORKSPACE = 255;
+    
+    void rebuildBitmap();
+    WORKSPACEID nextSetBit(WORKSPACEID from, bool up) const;
+    
     mutable std::mutex m_mutex;
     std::set<WORKSPACEID> m_allowedWorkspaces;
+    std::array<uint64_t, (MAX_BITMAP_WORKSPACE + 1) / 64> m_allowedBits{};
     std::set<std::string> m_exceptionClasses;
     WORKSPACEID m_lastValidWorkspace{1};
     bool m_floatingExempt{true};
@@ -1,9 +1,28 @@
 #include "dispatchers.hpp"
 #include "eventhooks.hpp"
 #include "FocusTimer.hpp"
+#include "TimeBudget.hpp"
+#include "MainThreadExecutor.hpp"
+#include "RuleEngine.hpp"
+#include "SessionBatch.hpp"
+#include "WorkspaceCatalogue.hpp"
+#include "IpcServer.hpp"
+#include "FocusRoom.hpp"
+#include "CalendarSchedule.hpp"
+#include "InputCooldown.hpp"
+#include "WindowLock.hpp"
+#include "ActivityEstimator.hpp"
+#include "FocusStats.hpp"
+#include "FocusHistory.hpp"
+#include "MonitorWorkspaces.hpp"
 #include <sstream>
 
-static std::vector<WORKSPACEID> parseWorkspaceList(const std::string& input) {
+// Comma-separated allowlist; monitor-relative entries ("DP-1:3") are
+// translated here and, if `relative` is given, collected for pinning along
+// with the IDs named outright (`absolute`)
+static std::vector<WORKSPACEID> parseWorkspaceList(const std::string& input,
+                                                   std::vector<RelativeWorkspace>* relative = nullptr,
+                                                   std::vector<WORKSPACEID>* absolute = nullptr) {
     std::vector<WORKSPACEID> result;
     std::stringstream ss(input);
     std::string token;
@@ -16,15 +35,12 @@ static std::vector<WORKSPACEID> parseWorkspaceList(const std::string& input) {
         if (start != std::string::npos && end != std::string::npos) {
             token = token.substr(start, end - start + 1);
             
-            try {
-                WORKSPACEID id = std::stoi(token);
-                if (id < 1) {
-                    FE_WARN("Invalid workspace ID '{}': must be >= 1", token);
-                    continue;
-                }
-                result.push_back(id);
-            } catch (const std::exception& e) {
-                FE_WARN("Failed to parse workspace ID '{}': {}", token, e.what());
+            std::string error;
+            size_t before = result.size();
+            if (!g_fe_monitor_workspaces || !g_fe_monitor_workspaces->resolve(token, result, relative, error)) {
+                FE_WARN("Skipping workspace '{}': {}", token, error);
+            } else if (absolute && !MonitorWorkspaces::isRelative(token)) {
+                absolute->insert(absolute->end(), result.begin() + before, result.end());
             }
         }
     }
@@ -45,61 +61,84 @@ static std::string formatTime(int seconds) {
     return oss.str();
 }
 
-void dispatch_startSession(std::string args) {
-    FE_INFO("Starting focus session with args: '{}'", args);
-    
-    // Check if already running
-    if (g_fe_is_session_active.load()) {
-        showWarning("Focus session already running! Stop it first.");
-        return;
+static std::string timerStateName(TimerState state) {
+    switch (state) {
+        case TimerState::Working: return "working";
+        case TimerState::Break:   return "break";
+        case TimerState::Paused:  return "paused";
+        default:                  return "inactive";
     }
-    
-    // Parse args: "workspaces@duration" or just "workspaces"
-    std::string workspaceStr = args;
-    int sessionDuration = g_fe_work_interval; // Default from config
-    
-    size_t atPos = args.find('@');
-    if (atPos != std::string::npos) {
-        workspaceStr = args.substr(0, atPos);
-        std::string durationStr = args.substr(atPos + 1);
-        try {
-            sessionDuration = std::stoi(durationStr);
-            FE_INFO("Using duration from args: {} minutes", sessionDuration);
-        } catch (...) {
-            FE_WARN("Failed to parse duration '{}', using default", durationStr);
-        }
+}
+
+std::string currentStateJson() {
+    if (!g_fe_is_session_active.load() || !g_fe_timer) {
+        return makeStateJson(false, "inactive", 0);
     }
-    
-    // Parse allowed workspaces
-    std::vector<WORKSPACEID> allowedWorkspaces;
-    
-    if (workspaceStr.empty()) {
-        // Default to current workspace only
-        auto focusState = Desktop::focusState();
-        if (!focusState) {
-            FE_WARN("focusState is null, cannot determine current workspace");
-        } else {
-            auto pMonitor = focusState->monitor();
-            if (pMonitor && pMonitor->m_activeWorkspace) {
-                allowedWorkspaces.push_back(pMonitor->m_activeWorkspace->m_id);
-                FE_INFO("No workspaces specified, using current: {}", 
-                        pMonitor->m_activeWorkspace->m_id);
-            }
-        }
-    } else {
-        allowedWorkspaces = parseWorkspaceList(workspaceStr);
+    return makeStateJson(true, timerStateName(g_fe_timer->getState()), g_fe_timer->getRemainingSeconds(),
+                         g_fe_enforcer ? g_fe_enforcer->getAllowedWorkspaces() : std::vector<WORKSPACEID>{},
+                         g_fe_timer->getIntervalSeconds(), g_fe_cooldown ? g_fe_cooldown->remainingSeconds() : 0);
+}
+
+// State file + pipe for the eww widgets, rewritten every tick
+static void writeCurrentState() {
+    if (!g_fe_is_session_active.load() || !g_fe_timer) {
+        removeStateFile();
+        return;
     }
+    writeStateFile(true, timerStateName(g_fe_timer->getState()), g_fe_timer->getRemainingSeconds(),
+                   g_fe_enforcer ? g_fe_enforcer->getAllowedWorkspaces() : std::vector<WORKSPACEID>{},
+                   g_fe_timer->getIntervalSeconds(), g_fe_cooldown ? g_fe_cooldown->remainingSeconds() : 0);
+}
+
+void publishState() {
+    writeCurrentState();
     
-    if (allowedWorkspaces.empty()) {
-        showError("No valid workspaces specified!");
+    // Subscribers count down locally, so they only hear about transitions
+    publishStateChange();
+}
+
+// The running session, appended to the history log when it ends
+static std::string g_sessionUuid;
+static std::vector<std::string> g_sessionTags;
+static int64_t g_sessionStart = 0;
+static std::atomic<int64_t> g_sessionWorkSecs{0};
+
+static void closeSession(bool completed);
+
+static void logSessionHistory(bool completed) {
+    if (g_sessionUuid.empty()) {
         return;
     }
     
-    // Configure the enforcer
+    SessionRecord record;
+    record.start = g_sessionStart;
+    record.end = time(nullptr);
+    record.workSecs = g_sessionWorkSecs.load();
+    record.completed = completed;
+    record.uuid = std::move(g_sessionUuid);
+    record.tags = std::move(g_sessionTags);
+    g_sessionUuid.clear();
+    g_sessionTags.clear();
+    
+    // Scans and appends to the history directory, so off the compositor thread;
+    // one append at a time, they share the current segment
+    std::string root = g_fe_history_dir.empty() ? HistoryLog::defaultRoot() : g_fe_history_dir;
+    runInBackground(WorkQos::Background, [root = std::move(root), record = std::move(record)]() {
+        static std::mutex appendMutex;
+        std::lock_guard<std::mutex> lock(appendMutex);
+        HistoryLog log(root, HistoryLog::localHost());
+        std::string error;
+        if (!log.append(record, error)) {
+            FE_WARN("Failed to log session to history: {}", error);
+        }
+    });
+}
+
+bool beginSession(const std::vector<WORKSPACEID>& allowedWorkspaces, int sessionDuration,
+                  std::vector<std::string> tags) {
     if (!g_fe_enforcer) {
         FE_ERR("g_fe_enforcer is null, cannot start session");
-        showError("Internal error: enforcer not initialized");
-        return;
+        return false;
     }
     g_fe_enforcer->setAllowedWorkspaces(allowedWorkspaces);
     
@@ -124,57 +163,257 @@ void dispatch_startSession(std::string args) {
     FE_INFO("Pomodoro: {} min work, {} min break, {} min total", 
             sessionDuration, breakDuration, totalDuration);
     
-    // Store allowed workspaces for state file (need a copy for lambda)
-    static std::vector<WORKSPACEID> s_allowedWorkspaces;
-    s_allowedWorkspaces = allowedWorkspaces;
-    
-    // Set up callbacks
+    // Set up callbacks. State published from here reads the enforcer, so
+    // allow/disallow during a session shows up on the next tick.
     g_fe_timer->setOnWorkStart([]() {
         g_fe_is_break_time = false;
-        writeStateFile(true, "working", g_fe_timer->getRemainingSeconds(), s_allowedWorkspaces);
+        if (g_fe_activity) {
+            g_fe_activity->onWorkStart();
+        }
+        publishState();
         // Only show flash if this is resuming from break (not initial start)
         if (g_fe_timer->getElapsedSeconds() > 5) {
             showFlash("Back to work!", 2000);
         }
         showNotification("Focus time! Stay on task.", {0.2, 0.6, 1.0, 1.0});
+        runOnMainThread([]() {
+            if (g_fe_room) g_fe_room->onLocalPhase();
+        });
     });
     
     g_fe_timer->setOnBreakStart([]() {
         g_fe_is_break_time = true;
-        writeStateFile(true, "break", g_fe_timer->getRemainingSeconds(), s_allowedWorkspaces);
+        // Breaks are free: stop charging any budgeted workspace
+        if (g_fe_budget && g_fe_budget->isCharging()) {
+            runOnMainThread([]() {
+                g_fe_budget->endAccess();
+                persistBudgets();
+            });
+        }
+        publishState();
         showFlash("Take a break!", 2500);
         showNotification("Break time! Relax for a moment.", {0.2, 0.8, 0.2, 1.0});
+        runOnMainThread([]() {
+            if (g_fe_room) g_fe_room->onLocalPhase();
+        });
+    });
+    
+    // Decided once per work interval, from rates sampled on the tick below
+    g_fe_timer->setExtendCheck([]() {
+        return g_fe_activity ? g_fe_activity->decideExtension() : 0;
+    });
+    
+    g_fe_timer->setOnWorkExtended([](int extraSeconds) {
+        metricCount(MetricCounter::WorkExtensions);
+        publishState();
+        showNotification("In the flow - break in " + std::to_string(extraSeconds / 60) + " min",
+                         {0.2, 0.6, 1.0, 1.0});
     });
     
     g_fe_timer->setOnSessionComplete([]() {
-        g_fe_is_session_active = false;
-        g_fe_is_break_time = false;
-        disableEnforcementHooks();
-        removeStateFile();
-        showNotification("Focus session complete! Great work!", {1.0, 0.8, 0.0, 1.0}, 10000);
-        
-        // Close status widgets on all monitors if using EWW
-        if (g_fe_use_eww_notifications && !g_fe_eww_config_path.empty()) {
-            execAsync("eww -c " + g_fe_eww_config_path + " close hyfocus-status");
-            execAsync("eww -c " + g_fe_eww_config_path + " close hyfocus-status-2");
-        }
+        runOnMainThread([]() {
+            // hyfocus:stop or a new session got here first
+            if (!g_fe_timer || g_fe_timer->getState() != TimerState::Completed || !g_fe_is_session_active.load()) {
+                return;
+            }
+            completeSession();
+        });
     });
     
     // Set tick callback to update state file every second
     g_fe_timer->setOnTick([](int remainingMins, TimerState state) {
-        std::string stateStr = (state == TimerState::Working) ? "working" :
-                               (state == TimerState::Break) ? "break" :
-                               (state == TimerState::Paused) ? "paused" : "inactive";
-        int remainingSecs = g_fe_timer->getRemainingSeconds();
-        writeStateFile(true, stateStr, remainingSecs, s_allowedWorkspaces);
+        (void)remainingMins; (void)state;
+        writeCurrentState();
+        
+        // Folds input counters into rates every ActivityEstimator::SAMPLE_PERIOD
+        if (g_fe_activity && state == TimerState::Working) {
+            g_fe_activity->sample();
+        }
+        
+        if (state == TimerState::Working) {
+            g_sessionWorkSecs++;
+        }
+        
+        // Focus minutes for the heatmap; written back every few minutes so
+        // a crash loses little
+        if (g_fe_stats && state == TimerState::Working && g_fe_stats->addFocusSeconds(1)) {
+            static int unsaved = 0;
+            if (++unsaved >= 5) {
+                unsaved = 0;
+                runOnMainThread(persistStats);
+            }
+        }
+        
+        // Budget deadline is a single atomic compare; the revert itself
+        // must happen on the compositor thread
+        if (g_fe_budget && g_fe_budget->isExhausted()) {
+            runOnMainThread(onBudgetExhausted);
+        }
     });
     
+    // Per-session budgets start full; daily ones carry over
+    if (g_fe_budget) {
+        g_fe_budget->resetSession();
+    }
+    
     // Start!
-    if (g_fe_timer->start()) {
-        g_fe_is_session_active = true;
-        
-        // Enable enforcement hooks now that session is active
-        enableEnforcementHooks();
+    if (!g_fe_timer->start()) {
+        return false;
+    }
+    
+    g_fe_is_session_active = true;
+    g_sessionUuid = newSessionUuid();
+    g_sessionTags = std::move(tags);
+    g_sessionStart = time(nullptr);
+    g_sessionWorkSecs = 0;
+    metricCount(MetricCounter::SessionsStarted);
+    metricSetGauge(MetricGauge::SessionActive, 1);
+    
+    // The draft selection has been used up
+    if (g_fe_catalogue) {
+        g_fe_catalogue->clearDraft();
+        publishCatalogue();
+    }
+    
+    // Enable enforcement hooks now that session is active
+    enableEnforcementHooks();
+    
+    // Write initial state file
+    writeStateFile(true, "working", sessionDuration * 60, allowedWorkspaces, sessionDuration * 60);
+    publishStateChange();
+    
+    // Open status widgets on ALL monitors if using EWW (each window separately)
+    if (g_fe_use_eww_notifications && !g_fe_eww_config_path.empty()) {
+        execAsync("eww -c " + g_fe_eww_config_path + " open hyfocus-status");
+        execAsync("eww -c " + g_fe_eww_config_path + " open hyfocus-status-2");
+    }
+    return true;
+}
+
+// Everything after the timer stops, whether the session was stopped or ran out
+static void closeSession(bool completed) {
+    // A member stops following the room; the host ends it for everyone
+    if (g_fe_room && g_fe_room->joined()) {
+        g_fe_room->finish();
+    }
+    if (g_fe_calendar) {
+        g_fe_calendar->onSessionEnded();
+    }
+    if (g_fe_cooldown) {
+        g_fe_cooldown->reset();
+    }
+    if (g_fe_window_lock) {
+        g_fe_window_lock->clear();
+    }
+    if (g_fe_monitor_workspaces) {
+        g_fe_monitor_workspaces->unpin();
+    }
+    
+    g_fe_is_session_active = false;
+    g_fe_is_break_time = false;
+    metricCount(completed ? MetricCounter::SessionsCompleted : MetricCounter::SessionsStopped);
+    metricSetGauge(MetricGauge::SessionActive, 0);
+    
+    if (g_fe_budget) {
+        g_fe_budget->endAccess();
+        persistBudgets();
+    }
+    persistStats();
+    logSessionHistory(completed);
+    
+    // Disable enforcement hooks
+    disableEnforcementHooks();
+    
+    // Remove state file and close status widgets
+    removeStateFile();
+    publishStateChange();
+    if (g_fe_use_eww_notifications && !g_fe_eww_config_path.empty()) {
+        execAsync("eww -c " + g_fe_eww_config_path + " close hyfocus-status");
+        execAsync("eww -c " + g_fe_eww_config_path + " close hyfocus-status-2");
+    }
+}
+
+void endSession() {
+    g_fe_timer->stop();
+    closeSession(false);
+}
+
+void completeSession() {
+    g_fe_timer->stop();
+    closeSession(true);
+    showNotification("Focus session complete! Great work!", {1.0, 0.8, 0.0, 1.0}, 10000);
+}
+
+void dispatch_startSession(std::string args) {
+    FE_INFO("Starting focus session with args: '{}'", args);
+    
+    // Check if already running
+    if (g_fe_is_session_active.load()) {
+        showWarning("Focus session already running! Stop it first.");
+        return;
+    }
+    
+    // Parse args: "workspaces@duration" or just "workspaces", plus any "#tag" words
+    std::vector<std::string> tags = takeSessionTags(args);
+    std::string workspaceStr = args;
+    int sessionDuration = g_fe_work_interval; // Default from config
+    
+    size_t atPos = args.find('@');
+    if (atPos != std::string::npos) {
+        workspaceStr = args.substr(0, atPos);
+        std::string durationStr = args.substr(atPos + 1);
+        try {
+            sessionDuration = std::stoi(durationStr);
+            FE_INFO("Using duration from args: {} minutes", sessionDuration);
+        } catch (...) {
+            FE_WARN("Failed to parse duration '{}', using default", durationStr);
+        }
+    }
+    
+    // Parse allowed workspaces
+    std::vector<WORKSPACEID> allowedWorkspaces;
+    std::vector<RelativeWorkspace> relativeWorkspaces;
+    std::vector<WORKSPACEID> absoluteWorkspaces;
+    
+    if (workspaceStr.empty()) {
+        // Default to current workspace only
+        auto focusState = Desktop::focusState();
+        if (!focusState) {
+            FE_WARN("focusState is null, cannot determine current workspace");
+        } else {
+            auto pMonitor = focusState->monitor();
+            if (pMonitor && pMonitor->m_activeWorkspace) {
+                allowedWorkspaces.push_back(pMonitor->m_activeWorkspace->m_id);
+                absoluteWorkspaces.push_back(pMonitor->m_activeWorkspace->m_id);
+                FE_INFO("No workspaces specified, using current: {}", 
+                        pMonitor->m_activeWorkspace->m_id);
+            }
+        }
+    } else if (workspaceStr == "draft") {
+        // Selection made in the start panel
+        if (g_fe_catalogue) {
+            allowedWorkspaces = g_fe_catalogue->draft();
+            absoluteWorkspaces = allowedWorkspaces;
+        }
+    } else {
+        allowedWorkspaces = parseWorkspaceList(workspaceStr, &relativeWorkspaces, &absoluteWorkspaces);
+    }
+    
+    if (allowedWorkspaces.empty()) {
+        showError("No valid workspaces specified!");
+        return;
+    }
+    
+    if (!g_fe_enforcer) {
+        showError("Internal error: enforcer not initialized");
+        return;
+    }
+    
+    if (beginSession(allowedWorkspaces, sessionDuration, tags)) {
+        // "DP-1:3" entries follow their monitor's offset from here on
+        if (g_fe_monitor_workspaces) {
+            g_fe_monitor_workspaces->pin(std::move(relativeWorkspaces), std::move(absoluteWorkspaces));
+        }
         
         // Build workspace list for notification
         std::string wsStr;
@@ -182,17 +421,10 @@ void dispatch_startSession(std::string args) {
             if (!wsStr.empty()) wsStr += ", ";
             wsStr += std::to_string(id);
         }
-        
-        // Write initial state file
-        writeStateFile(true, "working", sessionDuration * 60, allowedWorkspaces);
-        
-        showNotification("Focus session started! Allowed workspaces: " + wsStr);
-        
-        // Open status widgets on ALL monitors if using EWW (each window separately)
-        if (g_fe_use_eww_notifications && !g_fe_eww_config_path.empty()) {
-            execAsync("eww -c " + g_fe_eww_config_path + " open hyfocus-status");
-            execAsync("eww -c " + g_fe_eww_config_path + " open hyfocus-status-2");
+        for (const auto& tag : tags) {
+            wsStr += " #" + tag;
         }
+        showNotification("Focus session started! Allowed workspaces: " + wsStr);
     } else {
         showError("Failed to start focus session!");
     }
@@ -244,19 +476,7 @@ void dispatch_stopSession(std::string args) {
     }
     
     // No challenge, challenge disabled, or force stop - stop immediately
-    g_fe_timer->stop();
-    g_fe_is_session_active = false;
-    g_fe_is_break_time = false;
-    
-    // Disable enforcement hooks
-    disableEnforcementHooks();
-    
-    // Remove state file and close status widgets
-    removeStateFile();
-    if (g_fe_use_eww_notifications && !g_fe_eww_config_path.empty()) {
-        execAsync("eww -c " + g_fe_eww_config_path + " close hyfocus-status");
-        execAsync("eww -c " + g_fe_eww_config_path + " close hyfocus-status-2");
-    }
+    endSession();
     
     int elapsed = g_fe_timer->getElapsedSeconds();
     showNotification("Focus session stopped. Total time: " + formatTime(elapsed));
@@ -271,6 +491,7 @@ void dispatch_pauseSession(std::string args) {
     }
     
     g_fe_timer->pause();
+    publishState();
     showNotification("Focus session paused.", {1.0, 0.7, 0.0, 1.0});
 }
 
@@ -283,6 +504,7 @@ void dispatch_resumeSession(std::string args) {
     }
     
     g_fe_timer->resume();
+    publishState();
     showNotification("Focus session resumed!");
 }
 
@@ -308,6 +530,10 @@ void dispatch_allowWorkspace(std::string args) {
             return;
         }
         g_fe_enforcer->addAllowedWorkspace(id);
+        if (g_fe_monitor_workspaces) {
+            g_fe_monitor_workspaces->keep({id});
+        }
+        publishState();
         showNotification("Workspace " + std::to_string(id) + " added to allowed list.");
     } catch (const std::exception& e) {
         showError("Invalid workspace ID: " + args);
@@ -329,6 +555,7 @@ void dispatch_disallowWorkspace(std::string args) {
             return;
         }
         g_fe_enforcer->removeAllowedWorkspace(id);
+        publishState();
         showNotification("Workspace " + std::to_string(id) + " removed from allowed list.");
     } catch (const std::exception& e) {
         showError("Invalid workspace ID: " + args);
@@ -353,6 +580,14 @@ void dispatch_showStatus(std::string args) {
     
     if (!g_fe_is_session_active.load()) {
         status << "No active focus session.";
+        
+        const FocusBlock* next = g_fe_calendar ? g_fe_calendar->next() : nullptr;
+        if (next) {
+            char when[32];
+            time_t start = next->start;
+            strftime(when, sizeof(when), "%a %H:%M", localtime(&start));
+            status << " Next calendar block: " << when << " " << next->title;
+        }
     } else {
         auto state = g_fe_timer->getState();
         int remaining = g_fe_timer->getRemainingSeconds();
@@ -384,6 +619,21 @@ void dispatch_showStatus(std::string args) {
             if (i > 0) status << ", ";
             status << allowed[i];
         }
+        
+        if (g_fe_budget && !g_fe_budget->empty()) {
+            status << " | Budgets: " << g_fe_budget->describe();
+        }
+        
+        if (g_fe_window_lock && g_fe_window_lock->isActive()) {
+            status << " | Locked: " << g_fe_window_lock->describe();
+        }
+        
+        if (g_fe_room && g_fe_room->joined()) {
+            status << " | Room: " << g_fe_room->name();
+            if (g_fe_room->isHost()) {
+                status << " (host, " << g_fe_room->participants() << " in room)";
+            }
+        }
     }
     
     showNotification(status.str(), {0.5, 0.7, 1.0, 1.0}, 5000);
@@ -410,12 +660,7 @@ void dispatch_confirmStop(std::string args) {
     
     if (passed) {
         // Challenge passed! Actually stop the session now
-        g_fe_timer->stop();
-        g_fe_is_session_active = false;
-        g_fe_is_break_time = false;
-        
-        // Disable enforcement hooks
-        disableEnforcementHooks();
+        endSession();
         
         int elapsed = g_fe_timer->getElapsedSeconds();
         showNotification("Challenge passed! Session stopped. Total time: " + formatTime(elapsed));
@@ -456,6 +701,140 @@ void dispatch_disallowApp(std::string args) {
     FE_INFO("Removed app from spawn whitelist: {}", args);
 }
 
+void dispatch_dumpRules(std::string args) {
+    (void)args;
+    
+    if (!g_fe_rules) {
+        showError("Rule engine not initialized.");
+        return;
+    }
+    
+    // One log line per instruction so it reads well in `hyprctl log`
+    std::istringstream program(g_fe_rules->dump());
+    std::string line;
+    FE_INFO("Compiled focus rules:");
+    while (std::getline(program, line)) {
+        FE_INFO("{}", line);
+    }
+    
+    showNotification(std::to_string(g_fe_rules->ruleCount()) + " rules compiled (" +
+                     std::to_string(g_fe_rules->userRuleCount()) + " user). Program dumped to log.",
+                     {0.5, 0.7, 1.0, 1.0}, 5000);
+}
+
+void dispatch_batch(std::string args) {
+    // Notification and state update happen once, inside the batch
+    runSessionBatch(args);
+}
+
+void dispatch_draft(std::string args) {
+    if (!g_fe_catalogue) {
+        showError("Workspace catalogue not initialized.");
+        return;
+    }
+    
+    // Clicked once per workspace in the start panel: no notification,
+    // the panel redraws from the catalogue push
+    std::string error;
+    if (!g_fe_catalogue->editDraft(args, error)) {
+        showError("Draft: " + error);
+        return;
+    }
+    publishCatalogue();
+}
+
+void dispatch_room(std::string args) {
+    if (!g_fe_room) {
+        showError("Focus rooms not initialized.");
+        return;
+    }
+    
+    std::istringstream in(args);
+    std::string verb, name, workspaceStr;
+    in >> verb >> name >> workspaceStr;
+    
+    if (verb == "leave") {
+        if (!g_fe_room->joined()) {
+            showWarning("Not in a focus room.");
+            return;
+        }
+        std::string left = g_fe_room->name();
+        g_fe_room->leave();
+        showNotification("Left focus room " + left, {0.5, 0.7, 1.0, 1.0});
+        return;
+    }
+    
+    if (verb != "join" || name.empty()) {
+        showError("Usage: hyfocus:room join <name> [workspaces] | leave");
+        return;
+    }
+    
+    std::vector<WORKSPACEID> workspaces;
+    if (!workspaceStr.empty()) {
+        workspaces = parseWorkspaceList(workspaceStr);
+        if (workspaces.empty()) {
+            showError("No valid workspaces in '" + workspaceStr + "'");
+            return;
+        }
+    }
+    
+    std::string error;
+    if (!g_fe_room->join(name, workspaces, error)) {
+        showError("Focus room: " + error);
+        return;
+    }
+    
+    // Already focusing: put the room on our schedule (or follow it, if it has one)
+    if (g_fe_is_session_active.load()) {
+        g_fe_room->onLocalPhase();
+    }
+    
+    showNotification("Joined focus room " + name + (g_fe_room->isHost() ? " (host)" : ""),
+                     {0.2, 0.6, 1.0, 1.0});
+}
+
+void dispatch_lock(std::string args) {
+    if (!g_fe_window_lock) {
+        showError("Window lock not initialized.");
+        return;
+    }
+    if (!g_fe_is_session_active.load()) {
+        showWarning("Start a focus session before locking windows.");
+        return;
+    }
+    
+    std::istringstream in(args);
+    std::string verb, windowClass;
+    in >> verb >> windowClass;
+    
+    if (verb == "clear") {
+        g_fe_window_lock->clear();
+        showNotification("Window lock cleared", {0.5, 0.7, 1.0, 1.0});
+        return;
+    }
+    
+    if (verb == "current") {
+        auto focusState = Desktop::focusState();
+        auto pWindow = focusState ? focusState->window() : nullptr;
+        if (!pWindow) {
+            showError("No focused window to lock.");
+            return;
+        }
+        g_fe_window_lock->lockWindow(pWindow);
+        showNotification("Focus locked to " + g_fe_window_lock->describe(), {0.2, 0.6, 1.0, 1.0});
+        return;
+    }
+    
+    if (verb == "class" && !windowClass.empty()) {
+        int matched = g_fe_window_lock->lockClass(windowClass);
+        showNotification("Focus locked to class " + windowClass + " (" + std::to_string(matched) + " open)",
+                         {0.2, 0.6, 1.0, 1.0});
+        return;
+    }
+    
+    showError("Usage: hyfocus:lock current | class <class> | clear");
+}
+
 void registerDispatchers() {
     FE_INFO("Registering dispatchers...");
     
@@ -471,6 +850,11 @@ void registerDispatchers() {
     HyprlandAPI::addDispatcher(PHANDLE, "hyfocus:confirm", dispatch_confirmStop);
     HyprlandAPI::addDispatcher(PHANDLE, "hyfocus:allowapp", dispatch_allowApp);
     HyprlandAPI::addDispatcher(PHANDLE, "hyfocus:disallowapp", dispatch_disallowApp);
+    HyprlandAPI::addDispatcher(PHANDLE, "hyfocus:rules", dispatch_dumpRules);
+    HyprlandAPI::addDispatcher(PHANDLE, "hyfocus:batch", dispatch_batch);
+    HyprlandAPI::addDispatcher(PHANDLE, "hyfocus:draft", dispatch_draft);
+    HyprlandAPI::addDispatcher(PHANDLE, "hyfocus:room", dispatch_room);
+    HyprlandAPI::addDispatcher(PHANDLE, "hyfocus:lock", dispatch_lock);
     
     FE_INFO("Dispatchers registered successfully");
 }
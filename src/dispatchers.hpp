@@ -7,7 +7,7 @@
 #include "WindowShake.hpp"
 #include "ExitChallenge.hpp"
 
-void dispatch_startSession(std::string args);    // hyfocus:start [workspaces@duration]
+void dispatch_startSession(std::string args);    // hyfocus:start [workspaces@duration] [#tag...]
 void dispatch_stopSession(std::string args);     // hyfocus:stop
 void dispatch_pauseSession(std::string args);    // hyfocus:pause
 void dispatch_resumeSession(std::string args);   // hyfocus:resume
@@ -19,5 +19,22 @@ void dispatch_showStatus(std::string args);      // hyfocus:status
 void dispatch_confirmStop(std::string args);     // hyfocus:confirm <answer>
 void dispatch_allowApp(std::string args);        // hyfocus:allowapp <app>
 void dispatch_disallowApp(std::string args);     // hyfocus:disallowapp <app>
+void dispatch_dumpRules(std::string args);       // hyfocus:rules
+void dispatch_batch(std::string args);           // hyfocus:batch <op>; <op>; ...
+void dispatch_draft(std::string args);           // hyfocus:draft toggle|add|remove <id> / set <ids> / clear
+void dispatch_room(std::string args);            // hyfocus:room join <name> [workspaces] / leave
+void dispatch_lock(std::string args);            // hyfocus:lock current / class <class> / clear
+
+// Session lifecycle without user feedback (shared with hyfocus:batch)
+bool beginSession(const std::vector<WORKSPACEID>& allowedWorkspaces, int sessionDuration,
+                  std::vector<std::string> tags = {});
+void endSession();
+void completeSession();  // ran its course: logged as completed
+
+// Current state as the JSON line the status widgets consume
+std::string currentStateJson();
+
+// Rewrite the state file and push a transition to IPC state subscribers
+void publishState();
 
 void registerDispatchers();
@@ -3,17 +3,478 @@
 #include "FocusTimer.hpp"
 #include "WorkspaceEnforcer.hpp"
 #include "WindowShake.hpp"
+#include "TimeBudget.hpp"
+#include "Checkpoint.hpp"
+#include "RuleEngine.hpp"
+#include "WorkspaceCatalogue.hpp"
+#include "MonitorWorkspaces.hpp"
+#include "IpcServer.hpp"
+#include "InputCooldown.hpp"
+#include "WindowLock.hpp"
+#include "ActivityEstimator.hpp"
+#include "FocusStats.hpp"
 
+#include <ctime>
 #include <stdexcept>
 
 static std::atomic<bool> g_isReverting{false};
 
+static void revertToWorkspace(WORKSPACEID workspaceId) {
+    HookBudgetExempt exempt;
+    
+    // Set revert guard to prevent infinite loop
+    g_isReverting.store(true);
+    
+    // Revert by dispatching a workspace change back to the allowed workspace
+    metricCount(MetricCounter::Reverts);
+    HyprlandAPI::invokeHyprctlCommand("dispatch", "workspace " + std::to_string(workspaceId));
+    
+    // Clear revert guard
+    g_isReverting.store(false);
+}
+
+// Focus dispatch of our own; the focus change it causes is ignored
+static void refocus(const std::string& args) {
+    HookBudgetExempt exempt;
+    g_isReverting.store(true);
+    HyprlandAPI::invokeHyprctlCommand("dispatch", args);
+    g_isReverting.store(false);
+}
+
+static int localMinuteOfDay() {
+    std::time_t t = std::time(nullptr);
+    std::tm local{};
+    localtime_r(&t, &local);
+    return local.tm_hour * 60 + local.tm_min;
+}
+
+/**
+ * @brief Collect the facts the compiled rules look at.
+ * 
+ * Only fields the program actually uses are computed, so the common case
+ * (built-in rules only) costs an allowlist lookup. The string views point
+ * into the window and monitor, which outlive the evaluation.
+ */
+static RuleContext makeRuleContext(RuleEvent event, WORKSPACEID workspace, PHLMONITOR pMonitor,
+                                   PHLWINDOW pWindow, std::string_view command = {}) {
+    RuleContext ctx;
+    ctx.event = event;
+    ctx.phase = WorkspaceEnforcer::currentPhase();
+    ctx.workspace = workspace;
+    ctx.command = command;
+    
+    if (g_fe_enforcer && g_fe_enforcer->isWorkspaceAllowed(ctx.workspace)) {
+        ctx.flags |= RULE_FLAG_ALLOWED;
+    }
+    
+    if (!g_fe_rules) {
+        return ctx;
+    }
+    
+    if (pWindow && g_fe_rules->usesWindow()) {
+        ctx.windowClass = pWindow->m_initialClass;
+        ctx.title = pWindow->m_title;
+        if (g_fe_enforcer && g_fe_enforcer->isWindowClassExempt(pWindow->m_initialClass)) {
+            ctx.flags |= RULE_FLAG_EXEMPT;
+        }
+    }
+    if (pMonitor && g_fe_rules->usesWindow()) {
+        ctx.monitor = pMonitor->m_name;
+    }
+    if (g_fe_rules->usesTimeOfDay()) {
+        ctx.minuteOfDay = localMinuteOfDay();
+    }
+    if (g_fe_budget && g_fe_rules->usesBudget()) {
+        ctx.budgetSeconds = g_fe_budget->remainingSeconds(ctx.workspace, pWindow ? pWindow->m_initialClass : "");
+    }
+    
+    return ctx;
+}
+
+static RuleContext makeRuleContext(RuleEvent event, PHLWORKSPACE pWorkspace, PHLWINDOW pWindow,
+                                   std::string_view command = {}) {
+    return makeRuleContext(event, pWorkspace ? pWorkspace->m_id : 0,
+                           pWorkspace ? pWorkspace->m_monitor.lock() : nullptr, pWindow, command);
+}
+
+/**
+ * @brief Whether a switch to `id` would stand, as onWorkspaceChange decides it.
+ * 
+ * Workspaces reached through a budget count as not allowed: redirects only
+ * land where nothing gets charged. One that isn't open yet is judged on
+ * the focused monitor, where the switch would create it.
+ */
+static bool switchTargetAllowed(WORKSPACEID id) {
+    if (!g_fe_rules || g_fe_rules->userRuleCount() == 0) {
+        return g_fe_enforcer && g_fe_enforcer->isWorkspaceAllowed(id);  // built-in rules: the allowlist decides
+    }
+    
+    auto pWorkspace = g_pCompositor->getWorkspaceByID(id);
+    auto pWindow = pWorkspace ? pWorkspace->getLastFocusedWindow() : nullptr;
+    PHLMONITOR pMonitor = pWorkspace ? pWorkspace->m_monitor.lock() : nullptr;
+    if (!pWorkspace) {
+        auto focusState = Desktop::focusState();
+        pMonitor = focusState ? focusState->monitor() : nullptr;
+    }
+    
+    RuleContext ctx = makeRuleContext(RuleEvent::Switch, id, pMonitor, pWindow);
+    if (g_fe_rules->evaluate(ctx).action != RuleAction::Allow) {
+        return false;
+    }
+    return (ctx.flags & RULE_FLAG_ALLOWED) || !g_fe_budget ||
+           g_fe_budget->remainingSeconds(id, pWindow ? pWindow->m_initialClass : "") < 0;
+}
+
+// Highest ID a relative switch or swipe is redirected to when rules decide
+static constexpr WORKSPACEID MAX_REDIRECT_WORKSPACE = 255;
+
+/**
+ * @brief Workspace `steps` positions away from `from` that a switch may land on.
+ * 
+ * Same walk as WorkspaceEnforcer::nextAllowed, but with user rules each
+ * candidate goes through switchTargetAllowed, since a rule may grant a
+ * workspace off the allowlist or deny one on it. Returns 0 when there is
+ * none.
+ */
+static WORKSPACEID nextSwitchTarget(WORKSPACEID from, int steps, bool wrap) {
+    if (!g_fe_rules || g_fe_rules->userRuleCount() == 0) {
+        return g_fe_enforcer->nextAllowed(from, steps, wrap);
+    }
+    
+    int dir = steps > 0 ? 1 : -1;
+    WORKSPACEID at = from;
+    for (int i = 0; i < std::abs(steps); i++) {
+        WORKSPACEID next = 0;
+        WORKSPACEID id = at;
+        for (WORKSPACEID scanned = 0; scanned < MAX_REDIRECT_WORKSPACE; scanned++) {
+            id += dir;
+            if (id < 1 || id > MAX_REDIRECT_WORKSPACE) {
+                if (!wrap) {
+                    break;
+                }
+                id = dir > 0 ? 1 : MAX_REDIRECT_WORKSPACE;
+            }
+            if (switchTargetAllowed(id)) {
+                next = id;
+                break;
+            }
+        }
+        if (!next) {
+            return i > 0 ? at : 0;  // ran off the end: stop at the last one
+        }
+        at = next;
+    }
+    return at;
+}
+
+// Workspace dispatchers as Hyprland registered them, for the prefilter
+static std::unordered_map<std::string, std::function<SDispatchResult(std::string)>> g_originalDispatchers;
+
+/**
+ * @brief Parse a relative workspace argument ("+1", "-2", "e+1", "m-1", "r+1").
+ * 
+ * `wrap` follows Hyprland: the e/m forms cycle through open workspaces and
+ * wrap around, the plain and r forms stop at the ends.
+ */
+static bool parseRelativeWorkspace(std::string_view args, int& steps, bool& wrap) {
+    wrap = false;
+    if (!args.empty() && (args[0] == 'e' || args[0] == 'm' || args[0] == 'r')) {
+        wrap = args[0] != 'r';
+        args.remove_prefix(1);
+    }
+    if (args.size() < 2 || (args[0] != '+' && args[0] != '-')) {
+        return false;
+    }
+    
+    int n = 0;
+    for (char c : args.substr(1)) {
+        if (c < '0' || c > '9' || n > 1000) {
+            return false;
+        }
+        n = n * 10 + (c - '0');
+    }
+    steps = args[0] == '-' ? -n : n;
+    return n > 0;
+}
+
+/**
+ * @brief Runs ahead of the workspace dispatchers while a session is active.
+ * 
+ * During an input cooldown, binds that would switch away are dropped here,
+ * before the compositor moves, so none of the revert/shake/flash work in
+ * onWorkspaceChange happens. A plain numeric target on the allowlist still
+ * goes through. Our own reverts pass untouched.
+ * 
+ * Relative switches (e+1, mouse-wheel scrolling) are rewritten to the next
+ * workspace in that direction the focus rules allow, so cycling skips
+ * restricted ones in one step instead of landing on them and being reverted.
+ */
+static SDispatchResult workspacePrefilter(const std::string& dispatcher, std::string args) {
+    bool filtering = g_fe_is_session_active.load() && !g_isReverting.load();
+    
+    if (filtering && g_fe_cooldown && g_fe_cooldown->isActive()) {
+        bool allowed = false;
+        try {
+            size_t used = 0;
+            WORKSPACEID target = std::stoll(args, &used);
+            allowed = used == args.size() && g_fe_enforcer && g_fe_enforcer->isWorkspaceAllowed(target);
+        } catch (const std::exception&) {
+            // Relative or named target: can't tell where it leads, drop it
+        }
+        
+        if (!allowed) {
+            metricCount(MetricCounter::SwitchesSwallowed);
+            return {.success = false, .error = "hyfocus: input cooldown"};
+        }
+    }
+    
+    int steps = 0;
+    bool wrap = false;
+    if (filtering && g_fe_redirect_relative && g_fe_enforcer && parseRelativeWorkspace(args, steps, wrap)) {
+        RulePhase phase = WorkspaceEnforcer::currentPhase();
+        auto focusState = Desktop::focusState();
+        auto pMonitor = focusState ? focusState->monitor() : nullptr;
+        WORKSPACEID current = pMonitor && pMonitor->m_activeWorkspace ? pMonitor->m_activeWorkspace->m_id : 0;
+        
+        if (current > 0 && (phase != RulePhase::Break || g_fe_enforce_during_break)) {
+            WORKSPACEID target = nextSwitchTarget(current, steps, wrap);
+            if (!target || target == current) {
+                return {};  // nothing allowed that way: stay put rather than bounce
+            }
+            FE_DEBUG("Relative switch {} from {} -> workspace {}", args, current, target);
+            metricCount(MetricCounter::SwitchesRedirected);
+            args = std::to_string(target);
+        }
+    }
+    
+    auto it = g_originalDispatchers.find(dispatcher);
+    return it != g_originalDispatchers.end() ? it->second(std::move(args)) : SDispatchResult{};
+}
+
+static void installWorkspacePrefilter() {
+    if (!g_pKeybindManager) {
+        return;
+    }
+    for (const char* name : {"workspace", "focusworkspaceoncurrentmonitor"}) {
+        auto it = g_pKeybindManager->m_dispatchers.find(name);
+        if (it == g_pKeybindManager->m_dispatchers.end()) {
+            FE_WARN("No '{}' dispatcher, cooldowns and redirects won't cover it", name);
+            continue;
+        }
+        g_originalDispatchers[name] = it->second;
+        it->second = [dispatcher = std::string(name)](std::string args) {
+            return workspacePrefilter(dispatcher, std::move(args));
+        };
+    }
+}
+
+static void removeWorkspacePrefilter() {
+    if (g_pKeybindManager) {
+        for (auto& [name, original] : g_originalDispatchers) {
+            auto it = g_pKeybindManager->m_dispatchers.find(name);
+            if (it != g_pKeybindManager->m_dispatchers.end()) {
+                it->second = original;
+            }
+        }
+    }
+    g_originalDispatchers.clear();
+}
+
+/**
+ * @brief Workspace swipe gestures toward restricted workspaces.
+ * 
+ * A swipe draws the neighbouring workspace for its whole length and only
+ * switches when it ends, so the workspace callback would revert it after
+ * it had been on screen all along. Instead, the gesture's update is held
+ * at zero offset on a side whose neighbour is restricted: nothing of it is
+ * drawn. When a held-back swipe ends having gone far enough to commit,
+ * swipe_policy 2 switches straight to the next allowed workspace that way
+ * and 1 just gives the blocked-switch feedback.
+ * 
+ * Hyprland passes update() the running total (m_delta plus this event's
+ * motion), so the motion the user made is tracked here separately from
+ * the offset that was let through.
+ */
+struct SwipeGuard {
+    WORKSPACEID from{0};   // workspace the swipe started on
+    uint8_t checked{0};    // bit 0 = left neighbour looked up, bit 1 = right
+    uint8_t blocked{0};    // same bits, neighbour is restricted
+    double raw{0};         // finger travel, unclamped
+    double held{0};        // furthest travel into a blocked side
+};
+static SwipeGuard g_swipe;
+
+static bool swipeGuardActive() {
+    if (!g_fe_is_session_active.load() || g_fe_swipe_policy == 0 || !g_fe_enforcer) {
+        return false;
+    }
+    RulePhase phase = WorkspaceEnforcer::currentPhase();
+    return phase != RulePhase::Break || g_fe_enforce_during_break;
+}
+
+static bool swipeUsesR() {
+    static auto* const* pUseR = (Hyprlang::INT* const*)HyprlandAPI::getConfigValue(PHANDLE, "gestures:workspace_swipe_use_r")->getDataStaticPtr();
+    return **pUseR != 0;
+}
+
+// The workspace update() would reveal on that side, as Hyprland picks it
+static WORKSPACEID swipeNeighbour(WORKSPACEID from, bool right) {
+    bool useR = swipeUsesR();
+    WORKSPACEID id = getWorkspaceIDNameFromString(std::string(useR ? "r" : "m") + (right ? "+1" : "-1")).id;
+    if (id == WORKSPACE_INVALID || (right ? id <= from : id >= from)) {
+        id = from + (right ? 1 : -1);  // end of the list: workspace_swipe_create_new
+    }
+    return id;
+}
+
+static void hkSwipeUpdate(void* thisptr, double delta) {
+    auto original = (void (*)(void*, double))g_fe_pSwipeUpdateHook->m_original;
+    auto* swipe = static_cast<CUnifiedWorkspaceSwipeGesture*>(thisptr);
+    
+    if (!swipeGuardActive() || !swipe->m_workspaceBegin) {
+        original(thisptr, delta);
+        return;
+    }
+    
+    WORKSPACEID from = swipe->m_workspaceBegin->m_id;
+    if (from != g_swipe.from) {
+        g_swipe = SwipeGuard{.from = from};  // new swipe, or workspace_swipe_forever moved on
+    }
+    g_swipe.raw += delta - swipe->m_delta;
+    
+    bool right = g_swipe.raw > 0;
+    uint8_t side = right ? 2 : 1;
+    if (g_swipe.raw != 0 && !(g_swipe.checked & side)) {
+        g_swipe.checked |= side;
+        WORKSPACEID neighbour = swipeNeighbour(from, right);
+        if (neighbour > 0 && !switchTargetAllowed(neighbour)) {
+            g_swipe.blocked |= side;
+        }
+    }
+    
+    if (g_swipe.blocked & side) {
+        g_swipe.held = std::max(g_swipe.held, std::abs(g_swipe.raw));
+        original(thisptr, 0.0);
+        return;
+    }
+    original(thisptr, g_swipe.raw);
+}
+
+static void hkSwipeEnd(void* thisptr) {
+    auto original = (void (*)(void*))g_fe_pSwipeEndHook->m_original;
+    SwipeGuard swipe = g_swipe;
+    g_swipe = {};
+    
+    // Held at zero offset, so this animates back to where the swipe began
+    original(thisptr);
+    
+    if (!swipeGuardActive() || swipe.held <= 0 || swipe.raw == 0 || !(swipe.blocked & (swipe.raw > 0 ? 2 : 1))) {
+        return;
+    }
+    
+    // Same threshold Hyprland uses to cancel a swipe
+    static auto* const* pDistance = (Hyprlang::INT* const*)HyprlandAPI::getConfigValue(PHANDLE, "gestures:workspace_swipe_distance")->getDataStaticPtr();
+    static auto* const* pCancelRatio = (Hyprlang::FLOAT* const*)HyprlandAPI::getConfigValue(PHANDLE, "gestures:workspace_swipe_cancel_ratio")->getDataStaticPtr();
+    if (std::abs(swipe.raw) < **pDistance * **pCancelRatio) {
+        return;  // let go before it would have switched
+    }
+    
+    metricCount(MetricCounter::SwipesClamped);
+    
+    if (g_fe_swipe_policy == 2) {
+        WORKSPACEID target = nextSwitchTarget(swipe.from, swipe.raw > 0 ? 1 : -1, !swipeUsesR());
+        if (target && target != swipe.from) {
+            FE_DEBUG("Swipe from {} skipped to workspace {}", swipe.from, target);
+            metricCount(MetricCounter::SwitchesRedirected);
+            HyprlandAPI::invokeHyprctlCommand("dispatch", "workspace " + std::to_string(target));
+            return;
+        }
+    }
+    
+    if (g_fe_shaker) {
+        g_fe_shaker->shake();
+    }
+    if (g_fe_use_eww_notifications && !g_fe_eww_config_path.empty()) {
+        showFlash("Stay focused");
+    }
+}
+
+/**
+ * @brief Move a window out of sight into the quarantine special workspace.
+ */
+static void quarantineWindow(PHLWINDOW pWindow) {
+    if (!pWindow) {
+        return;
+    }
+    
+    FE_INFO("Quarantining window {} ({})", pWindow->m_initialClass, pWindow->m_title);
+    
+    char address[32];
+    snprintf(address, sizeof(address), "0x%lx", reinterpret_cast<uintptr_t>(pWindow.get()));
+    
+    HookBudgetExempt exempt;
+    g_isReverting.store(true);
+    HyprlandAPI::invokeHyprctlCommand("dispatch",
+        std::string("movetoworkspacesilent special:hyfocus-quarantine,address:") + address);
+    g_isReverting.store(false);
+}
+
+void persistBudgets() {
+    if (!g_fe_budget || !g_fe_checkpoint) {
+        return;
+    }
+    g_fe_budget->saveTo(*g_fe_checkpoint);
+    g_fe_checkpoint->save();
+}
+
+void persistStats() {
+    if (!g_fe_stats || !g_fe_checkpoint) {
+        return;
+    }
+    g_fe_stats->saveTo(*g_fe_checkpoint);
+    g_fe_checkpoint->save();
+}
+
+void onBudgetExhausted() {
+    if (!g_fe_budget || !g_fe_budget->isCharging()) {
+        return;  // Already settled by a focus transition
+    }
+    
+    WORKSPACEID budgeted = g_fe_budget->chargedWorkspace();
+    g_fe_budget->endAccess();
+    persistBudgets();
+    
+    if (!g_fe_is_session_active.load()) {
+        return;
+    }
+    
+    // Only bounce if the user is still looking at the budgeted workspace
+    auto focusState = Desktop::focusState();
+    auto pMonitor = focusState ? focusState->monitor() : nullptr;
+    if (!pMonitor || !pMonitor->m_activeWorkspace || pMonitor->m_activeWorkspace->m_id != budgeted) {
+        return;
+    }
+    
+    WORKSPACEID lastValid = g_fe_enforcer ? g_fe_enforcer->getLastValidWorkspace() : 1;
+    FE_INFO("Time budget for workspace {} used up, returning to {}", budgeted, lastValid);
+    
+    if (g_fe_use_eww_notifications && !g_fe_eww_config_path.empty()) {
+        showFlash("Time's up");
+    } else {
+        showWarning("Focus mode: time budget for workspace " + std::to_string(budgeted) + " used up!");
+    }
+    
+    revertToWorkspace(lastValid);
+}
+
 static void onWorkspaceChange(void* self, SCallbackInfo& info, std::any data) {
     (void)self;
     (void)info;
+    HookTimer timer(MetricHook::Workspace);
     
     // Debug log
-    std::ofstream dbg("/tmp/hyfocus_debug.log", std::ios::app);
+    timer.phase("debug-log");
+    DebugLog dbg;
     dbg << "onWorkspaceChange called, session_active=" << g_fe_is_session_active.load() << std::endl;
     
     try {
@@ -48,53 +509,105 @@ static void onWorkspaceChange(void* self, SCallbackInfo& info, std::any data) {
         }
         dbg.close();
         
-        // During breaks, check if enforcement is active
-        if (g_fe_is_break_time.load() && !g_fe_enforce_during_break) {
-            if (g_fe_enforcer) {
-                g_fe_enforcer->setLastValidWorkspace(newWsId);
-            }
+        // Focus moved away from a budgeted workspace: debit the time spent there
+        timer.phase("budgets");
+        if (g_fe_budget && g_fe_budget->isCharging() && g_fe_budget->chargedWorkspace() != newWsId) {
+            g_fe_budget->endAccess();
+            persistBudgets();
+        }
+        
+        // Already being charged against a time budget (e.g. re-emitted event)
+        if (g_fe_budget && g_fe_budget->isCharging() && g_fe_budget->chargedWorkspace() == newWsId) {
             return;
         }
         
-        // Check if this workspace is allowed
-        std::ofstream dbg2("/tmp/hyfocus_debug.log", std::ios::app);
-        dbg2 << "checking isAllowed, enforcer=" << (g_fe_enforcer != nullptr) << std::endl;
+        // Evaluate the compiled focus policy
+        timer.phase("rules");
+        auto pWindow = pWorkspace->getLastFocusedWindow();
+        std::string windowClass = pWindow ? pWindow->m_initialClass : "";
+        RuleContext ctx = makeRuleContext(RuleEvent::Switch, pWorkspace, pWindow);
+        RuleDecision decision = g_fe_rules ? g_fe_rules->evaluate(ctx) : RuleDecision{};
+        
+        DebugLog dbg2;
+        dbg2 << "rule " << decision.rule << (decision.builtin ? " (builtin)" : "")
+             << " -> " << RuleEngine::actionName(decision.action) << std::endl;
         
-        if (g_fe_enforcer && g_fe_enforcer->isWorkspaceAllowed(newWsId)) {
-            g_fe_enforcer->setLastValidWorkspace(newWsId);
+        if (decision.action == RuleAction::Allow) {
+            // Granted without being on the allowlist while enforcing: charge its budget
+            bool enforcing = ctx.phase != RulePhase::Break || g_fe_enforce_during_break;
+            if (enforcing && !(ctx.flags & RULE_FLAG_ALLOWED) && g_fe_budget &&
+                g_fe_budget->beginAccess(newWsId, windowClass)) {
+                dbg2 << "budgeted access, charging" << std::endl;
+                dbg2.close();
+                if (timer.shedding()) {
+                    return;
+                }
+                timer.phase("feedback");
+                int left = g_fe_budget->remainingSeconds(newWsId, windowClass);
+                char msg[32];
+                snprintf(msg, sizeof(msg), "%d:%02d left", left / 60, left % 60);
+                if (g_fe_use_eww_notifications && !g_fe_eww_config_path.empty()) {
+                    showFlash(msg);
+                } else {
+                    showNotification("Workspace " + std::to_string(newWsId) + ": " + msg, {1.0, 0.7, 0.0, 1.0});
+                }
+                return;
+            }
+            
+            if (g_fe_enforcer) {
+                g_fe_enforcer->setLastValidWorkspace(newWsId);
+            }
             dbg2 << "allowed, returning" << std::endl;
             dbg2.close();
             FE_DEBUG("Allowed switch to workspace {}", newWsId);
             return;
         }
         
+        if (decision.action == RuleAction::Redirect) {
+            dbg2 << "redirecting to " << decision.target << std::endl;
+            dbg2.close();
+            FE_INFO("Redirecting switch to workspace {} -> {} (rule {})", newWsId, decision.target, decision.rule);
+            revertToWorkspace(decision.target);
+            return;
+        }
+        
         // BLOCKED! Revert to last valid workspace
         WORKSPACEID lastValid = g_fe_enforcer ? g_fe_enforcer->getLastValidWorkspace() : 1;
         dbg2 << "BLOCKED! reverting to " << lastValid << std::endl;
         dbg2 << "use_eww=" << g_fe_use_eww_notifications << " path=" << g_fe_eww_config_path << std::endl;
         dbg2.close();
-        FE_INFO("Blocked switch to workspace {}, reverting to {}", newWsId, lastValid);
+        FE_INFO("Blocked switch to workspace {}, reverting to {} (rule {}: {})", newWsId, lastValid,
+                decision.rule, RuleEngine::actionName(decision.action));
         
-        // Trigger shake animation
-        if (g_fe_shaker) {
-            g_fe_shaker->shake();
+        timer.phase("feedback");
+        if (decision.action == RuleAction::Quarantine) {
+            quarantineWindow(pWindow);
         }
+        publishBlockedEvent("workspace", std::to_string(newWsId), decision.rule);
+        metricBlocked(RuleEvent::Switch, decision.action);
         
-        // Show flash warning (EWW) or notification (fallback)
-        if (g_fe_use_eww_notifications && !g_fe_eww_config_path.empty()) {
-            showFlash("Stay focused");
-        } else {
-            showWarning("Focus mode: Workspace " + std::to_string(newWsId) + " is restricted!");
+        // A storm of these: stop further binds at the prefilter for a while
+        if (g_fe_cooldown && g_fe_cooldown->onBlocked()) {
+            metricCount(MetricCounter::Cooldowns);
+            publishState();
         }
         
-        // Set revert guard to prevent infinite loop
-        g_isReverting.store(true);
-        
-        // Revert by dispatching a workspace change back to the allowed workspace
-        HyprlandAPI::invokeHyprctlCommand("dispatch", "workspace " + std::to_string(lastValid));
+        if (decision.action != RuleAction::Freeze && !timer.shedding()) {
+            // Trigger shake animation
+            if (g_fe_shaker) {
+                g_fe_shaker->shake();
+            }
+            
+            // Show flash warning (EWW) or notification (fallback)
+            if (g_fe_use_eww_notifications && !g_fe_eww_config_path.empty()) {
+                showFlash("Stay focused");
+            } else {
+                showWarning("Focus mode: Workspace " + std::to_string(newWsId) + " is restricted!");
+            }
+        }
         
-        // Clear revert guard
-        g_isReverting.store(false);
+        timer.phase("revert");
+        revertToWorkspace(lastValid);
         
     } catch (const std::bad_any_cast& e) {
         FE_WARN("Failed to cast workspace data: {}", e.what());
@@ -105,6 +618,108 @@ static void onWorkspaceChange(void* self, SCallbackInfo& info, std::any data) {
     }
 }
 
+/**
+ * @brief Focus changes: keeps class budgets in sync and applies user rules.
+ * 
+ * Class budgets follow the focused window, so moving focus to a window of
+ * another class re-keys the running charge. If the new window has no budget
+ * (and the workspace itself has none), access ends immediately.
+ * 
+ * Built-in rules always allow focus changes, so the rule program is only
+ * consulted when the user configured rules of their own.
+ */
+static void onActiveWindowChange(void* self, SCallbackInfo& info, std::any data) {
+    (void)self;
+    (void)info;
+    
+    if (!g_fe_is_session_active.load() || g_isReverting.load()) {
+        return;
+    }
+    HookTimer timer(MetricHook::ActiveWindow);
+    
+    // Flow accounting is the first thing to go when the hook runs slow
+    if (g_fe_activity && !timer.shedding()) {
+        g_fe_activity->noteFocusSwitch();
+    }
+    
+    try {
+        auto pWindow = std::any_cast<PHLWINDOW>(data);
+        if (!pWindow || !pWindow->m_workspace) {
+            return;
+        }
+        
+        WORKSPACEID wsId = pWindow->m_workspace->m_id;
+        
+        // Window lock: anything outside the locked set is bounced back
+        timer.phase("window-lock");
+        if (g_fe_window_lock && g_fe_window_lock->isActive()) {
+            RulePhase phase = WorkspaceEnforcer::currentPhase();
+            bool enforcing = phase != RulePhase::Break || g_fe_enforce_during_break;
+            if (g_fe_window_lock->allows(pWindow.get()) || !enforcing ||
+                (g_fe_enforcer && g_fe_enforcer->isWindowClassExempt(pWindow->m_initialClass))) {
+                g_fe_window_lock->onFocused(pWindow);
+            } else if (auto target = g_fe_window_lock->bounceTarget()) {
+                FE_INFO("Focus on {} outside the window lock, back to {}", pWindow->m_initialClass, target->m_initialClass);
+                publishBlockedEvent("focus", pWindow->m_initialClass, -1);
+                metricBlocked(RuleEvent::Focus, RuleAction::Block);
+                
+                char address[32];
+                snprintf(address, sizeof(address), "0x%lx", reinterpret_cast<uintptr_t>(target.get()));
+                refocus(std::string("focuswindow address:") + address);
+                if (g_fe_shaker && !timer.shedding()) {
+                    g_fe_shaker->shake();
+                }
+                return;
+            }
+        }
+        
+        // Workspace transitions are settled by onWorkspaceChange
+        timer.phase("budgets");
+        if (g_fe_budget && g_fe_budget->isCharging() && wsId == g_fe_budget->chargedWorkspace()) {
+            if (!g_fe_budget->beginAccess(wsId, pWindow->m_initialClass)) {
+                WORKSPACEID lastValid = g_fe_enforcer ? g_fe_enforcer->getLastValidWorkspace() : 1;
+                FE_INFO("No budget for {} on workspace {}, returning to {}", pWindow->m_initialClass, wsId, lastValid);
+                persistBudgets();
+                revertToWorkspace(lastValid);
+            }
+            return;
+        }
+        
+        if (!g_fe_rules || g_fe_rules->userRuleCount() == 0) {
+            return;
+        }
+        
+        timer.phase("rules");
+        RuleContext ctx = makeRuleContext(RuleEvent::Focus, pWindow->m_workspace, pWindow);
+        RuleDecision decision = g_fe_rules->evaluate(ctx);
+        timer.phase("enforce");
+        
+        switch (decision.action) {
+            case RuleAction::Allow:
+                return;
+            case RuleAction::Quarantine:
+                quarantineWindow(pWindow);
+                return;
+            case RuleAction::Redirect:
+                FE_INFO("Focus on {} redirected to workspace {} (rule {})", pWindow->m_initialClass, decision.target, decision.rule);
+                revertToWorkspace(decision.target);
+                return;
+            case RuleAction::Block:
+            case RuleAction::Freeze:
+                FE_INFO("Blocked focus on {} (rule {})", pWindow->m_initialClass, decision.rule);
+                publishBlockedEvent("focus", pWindow->m_initialClass, decision.rule);
+                metricBlocked(RuleEvent::Focus, decision.action);
+                if (decision.action == RuleAction::Block && g_fe_shaker && !timer.shedding()) {
+                    g_fe_shaker->shake();
+                }
+                refocus("focuscurrentorlast");
+                return;
+        }
+    } catch (const std::bad_any_cast& e) {
+        FE_WARN("Failed to cast window data: {}", e.what());
+    }
+}
+
 /**
  * @brief Hook function that intercepts spawn (app launch) requests.
  * 
@@ -115,9 +730,10 @@ static void onWorkspaceChange(void* self, SCallbackInfo& info, std::any data) {
  * 
  * 1. If no session is active, allow all spawns
  * 2. If blocking is disabled (g_fe_block_spawn = false), allow all spawns
- * 3. If during break and enforcement during break is disabled, allow spawns
- * 4. Check if the command is in the spawn whitelist (e.g., "firefox", "kitty")
- * 5. If not whitelisted, block the spawn and show visual feedback
+ * 3. Check if the command is in the spawn whitelist (e.g., "firefox", "kitty")
+ * 4. Evaluate the compiled rules (breaks and the whitelist are built-in
+ *    rules, user rules can match on cmd:/class:/time: etc.)
+ * 5. If not allowed, block the spawn and show visual feedback
  * 
  * The whitelist checks if any whitelisted app name is contained in the
  * spawn command, allowing for flexibility (e.g., "firefox" matches
@@ -142,61 +758,136 @@ static void hkSpawn(std::string args) {
         return;
     }
     
-    // During breaks, check if enforcement is active
-    if (g_fe_is_break_time.load() && !g_fe_enforce_during_break) {
-        if (g_fe_pSpawnHook && g_fe_pSpawnHook->m_original) {
-            ((void(*)(std::string))g_fe_pSpawnHook->m_original)(args);
-        }
-        return;
-    }
+    // Measured up to the decision; the original spawn isn't ours to time
+    HookTimer timer(MetricHook::Spawn);
     
     // Check whitelist - see if any whitelisted app is in the command
+    timer.phase("whitelist");
     std::string argsLower = args;
     std::transform(argsLower.begin(), argsLower.end(), argsLower.begin(),
                    [](unsigned char c) { return std::tolower(c); });
     
     // Debug whitelist check
-    std::ofstream dbg("/tmp/hyfocus_debug.log", std::ios::app);
+    DebugLog dbg;
     dbg << "hkSpawn: args='" << args << "' whitelist_size=" << g_fe_spawn_whitelist.size() << std::endl;
-    for (const auto& item : g_fe_spawn_whitelist) {
-        dbg << "  whitelist item: '" << item << "'" << std::endl;
-    }
     
+    bool whitelisted = false;
     for (const auto& allowed : g_fe_spawn_whitelist) {
         std::string allowedLower = allowed;
         std::transform(allowedLower.begin(), allowedLower.end(), allowedLower.begin(),
                        [](unsigned char c) { return std::tolower(c); });
         
         if (argsLower.find(allowedLower) != std::string::npos) {
-            // Whitelisted app found, allow spawn
-            dbg << "  ALLOWED: '" << allowed << "' found in args" << std::endl;
-            dbg.close();
-            FE_DEBUG("Spawn allowed (whitelisted): {}", args);
-            if (g_fe_pSpawnHook && g_fe_pSpawnHook->m_original) {
-                ((void(*)(std::string))g_fe_pSpawnHook->m_original)(args);
-            }
-            return;
+            dbg << "  whitelist match: '" << allowed << "'" << std::endl;
+            whitelisted = true;
+            break;
+        }
+    }
+    
+    // Evaluate the compiled focus policy against the current workspace
+    timer.phase("rules");
+    PHLWORKSPACE pWorkspace;
+    PHLWINDOW pWindow;
+    if (auto focusState = Desktop::focusState()) {
+        auto pMonitor = focusState->monitor();
+        pWorkspace = pMonitor ? pMonitor->m_activeWorkspace : nullptr;
+        pWindow = focusState->window();
+    }
+    RuleContext ctx = makeRuleContext(RuleEvent::Spawn, pWorkspace, pWindow, args);
+    if (whitelisted) {
+        ctx.flags |= RULE_FLAG_WHITELISTED;
+    }
+    RuleDecision decision = g_fe_rules ? g_fe_rules->evaluate(ctx) : RuleDecision{};
+    
+    if (decision.action == RuleAction::Allow) {
+        dbg << "  ALLOWED by rule " << decision.rule << std::endl;
+        dbg.close();
+        FE_DEBUG("Spawn allowed (rule {}): {}", decision.rule, args);
+        timer.finish();
+        if (g_fe_pSpawnHook && g_fe_pSpawnHook->m_original) {
+            ((void(*)(std::string))g_fe_pSpawnHook->m_original)(args);
         }
+        return;
     }
-    dbg << "  BLOCKED - no whitelist match" << std::endl;
+    dbg << "  BLOCKED by rule " << decision.rule << std::endl;
     dbg.close();
     
     // BLOCKED! Trigger visual feedback
-    FE_INFO("Blocked spawn: {}", args);
+    timer.phase("feedback");
+    FE_INFO("Blocked spawn: {} (rule {}: {})", args, decision.rule, RuleEngine::actionName(decision.action));
+    publishBlockedEvent("spawn", args, decision.rule);
+    metricBlocked(RuleEvent::Spawn, decision.action);
     
-    // Trigger shake animation
-    if (g_fe_shaker) {
-        g_fe_shaker->shake();
+    if (decision.action != RuleAction::Freeze && !timer.shedding()) {
+        // Trigger shake animation
+        if (g_fe_shaker) {
+            g_fe_shaker->shake();
+        }
+        
+        // Show flash warning (EWW) or notification (fallback)
+        if (g_fe_use_eww_notifications && !g_fe_eww_config_path.empty()) {
+            showFlash("Stay focused");
+        } else {
+            showWarning("Focus mode: App launching is blocked!");
+        }
     }
     
-    // Show flash warning (EWW) or notification (fallback)
-    if (g_fe_use_eww_notifications && !g_fe_eww_config_path.empty()) {
-        showFlash("Stay focused");
-    } else {
-        showWarning("Focus mode: App launching is blocked!");
+    // Do NOT call the original function - spawn is prevented
+}
+
+/**
+ * @brief Keep the workspace catalogue current and push changes to subscribers.
+ *
+ * Each event touches one catalogue entry; nothing here rescans the compositor.
+ * These run whether or not a session is active, since the start panel is
+ * used before one begins.
+ */
+static void onCatalogueEvent(const std::string& event, std::any data) {
+    if (!g_fe_catalogue) {
+        return;
     }
     
-    // Do NOT call the original function - spawn is prevented
+    bool changed = false;
+    try {
+        if (event == "createWorkspace") {
+            changed = g_fe_catalogue->onWorkspaceCreated(std::any_cast<CWorkspace*>(data));
+        } else if (event == "destroyWorkspace") {
+            changed = g_fe_catalogue->onWorkspaceDestroyed(std::any_cast<CWorkspace*>(data));
+        } else if (event == "moveWorkspace") {
+            auto args = std::any_cast<std::vector<std::any>>(data);
+            changed = g_fe_catalogue->onWorkspaceMoved(std::any_cast<PHLWORKSPACE>(args.at(0)),
+                                                       std::any_cast<PHLMONITOR>(args.at(1)));
+        } else if (event == "openWindow") {
+            changed = g_fe_catalogue->onWindowOpened(std::any_cast<PHLWINDOW>(data));
+        } else if (event == "closeWindow") {
+            changed = g_fe_catalogue->onWindowClosed(std::any_cast<PHLWINDOW>(data));
+        } else if (event == "moveWindow") {
+            auto args = std::any_cast<std::vector<std::any>>(data);
+            changed = g_fe_catalogue->onWindowMoved(std::any_cast<PHLWINDOW>(args.at(0)),
+                                                    std::any_cast<PHLWORKSPACE>(args.at(1)));
+        }
+    } catch (const std::exception& e) {
+        FE_WARN("Catalogue: unexpected data for {}: {}", event, e.what());
+        return;
+    }
+    
+    if (changed) {
+        publishCatalogue();
+    }
+}
+
+// keyPress carries {"keyboard", "event"}; the event says press or release
+static bool isKeyPress(const std::any& data) {
+    auto* args = std::any_cast<std::unordered_map<std::string, std::any>>(&data);
+    if (!args) {
+        return false;
+    }
+    auto it = args->find("event");
+    if (it == args->end()) {
+        return false;
+    }
+    auto* event = std::any_cast<IKeyboard::SKeyEvent>(&it->second);
+    return event && event->state == WL_KEYBOARD_KEY_STATE_PRESSED;
 }
 
 /**
@@ -252,6 +943,25 @@ void registerEventHooks(std::vector<std::string>& errors) {
         FE_WARN("Could not find spawn function - spawn blocking disabled");
     }
     
+    // Swipe gesture hooks, enabled with the session like the spawn hook
+    for (const auto& match : HyprlandAPI::findFunctionsByName(PHANDLE, "update")) {
+        if (match.demangled.find("CUnifiedWorkspaceSwipeGesture::update") != std::string::npos) {
+            g_fe_pSwipeUpdateHook = HyprlandAPI::createFunctionHook(PHANDLE, match.address, (void*)&hkSwipeUpdate);
+            break;
+        }
+    }
+    for (const auto& match : HyprlandAPI::findFunctionsByName(PHANDLE, "end")) {
+        if (match.demangled.find("CUnifiedWorkspaceSwipeGesture::end") != std::string::npos) {
+            g_fe_pSwipeEndHook = HyprlandAPI::createFunctionHook(PHANDLE, match.address, (void*)&hkSwipeEnd);
+            break;
+        }
+    }
+    if (!g_fe_pSwipeUpdateHook || !g_fe_pSwipeEndHook) {
+        FE_WARN("Could not hook workspace swipes - swipes are reverted after the fact");
+        g_fe_pSwipeUpdateHook = nullptr;
+        g_fe_pSwipeEndHook = nullptr;
+    }
+    
     // Register callback for post-workspace-change events
     // This is our main enforcement mechanism - revert unauthorized switches
     static auto workspaceCallback = HyprlandAPI::registerCallbackDynamic(
@@ -261,7 +971,7 @@ void registerEventHooks(std::vector<std::string>& errors) {
     );
     
     // Debug to file
-    std::ofstream dbg("/tmp/hyfocus_debug.log", std::ios::app);
+    DebugLog dbg;
     dbg << "registerEventHooks: workspaceCallback=" << (workspaceCallback ? "OK" : "NULL") << std::endl;
     dbg.close();
     
@@ -271,17 +981,128 @@ void registerEventHooks(std::vector<std::string>& errors) {
         FE_INFO("Registered workspace callback for enforcement");
     }
     
+    // Drops workspace binds during input cooldowns, redirects relative ones
+    installWorkspacePrefilter();
+    
+    // Focus changes inside a budgeted workspace re-key class budgets
+    static auto activeWindowCallback = HyprlandAPI::registerCallbackDynamic(
+        PHANDLE,
+        "activeWindow",
+        onActiveWindowChange
+    );
+    
+    if (!activeWindowCallback) {
+        errors.push_back("Failed to register activeWindow callback - class budgets disabled");
+    }
+    
+    // Workspace catalogue for the start panel
+    static std::vector<SP<HOOK_CALLBACK_FN>> catalogueCallbacks;
+    for (const char* event : {"createWorkspace", "destroyWorkspace", "moveWorkspace",
+                              "openWindow", "closeWindow", "moveWindow"}) {
+        auto callback = HyprlandAPI::registerCallbackDynamic(
+            PHANDLE, event, [name = std::string(event)](void* self, SCallbackInfo& info, std::any data) {
+                (void)self; (void)info;
+                onCatalogueEvent(name, data);
+            });
+        if (!callback) {
+            errors.push_back(std::string("Failed to register ") + event + " callback - workspace catalogue may go stale");
+            continue;
+        }
+        catalogueCallbacks.push_back(callback);
+    }
+    
+    // Monitor -> workspace offset table for monitor-relative allowlists
+    static std::vector<SP<HOOK_CALLBACK_FN>> monitorCallbacks;
+    for (const char* event : {"monitorAdded", "monitorRemoved"}) {
+        auto callback = HyprlandAPI::registerCallbackDynamic(
+            PHANDLE, event, [added = std::string(event) == "monitorAdded"](void* self, SCallbackInfo& info, std::any data) {
+                (void)self; (void)info;
+                if (!g_fe_monitor_workspaces) {
+                    return;
+                }
+                try {
+                    auto pMonitor = std::any_cast<PHLMONITOR>(data);
+                    if (added) {
+                        g_fe_monitor_workspaces->onMonitorAdded(pMonitor);
+                    } else {
+                        g_fe_monitor_workspaces->onMonitorRemoved(pMonitor);
+                    }
+                } catch (const std::bad_any_cast& e) {
+                    FE_WARN("Monitor workspaces: unexpected monitor data: {}", e.what());
+                }
+            });
+        if (!callback) {
+            errors.push_back(std::string("Failed to register ") + event + " callback - monitor-relative workspaces may go stale");
+            continue;
+        }
+        monitorCallbacks.push_back(callback);
+    }
+    
+    // Flow detection only counts input; rates are worked out on the timer thread
+    static std::vector<SP<HOOK_CALLBACK_FN>> activityCallbacks;
+    for (const char* event : {"keyPress", "mouseButton", "mouseAxis"}) {
+        auto callback = HyprlandAPI::registerCallbackDynamic(
+            PHANDLE, event, [name = std::string_view(event)](void* self, SCallbackInfo& info, std::any data) {
+                (void)self; (void)info;
+                if (!g_fe_activity) {
+                    return;
+                }
+                // Keys and buttons fire again on release; count each press once
+                if (name == "keyPress") {
+                    if (isKeyPress(data)) {
+                        g_fe_activity->noteKey();
+                    }
+                } else if (name == "mouseButton") {
+                    auto* button = std::any_cast<IPointer::SButtonEvent>(&data);
+                    if (button && button->state == WL_POINTER_BUTTON_STATE_PRESSED) {
+                        g_fe_activity->notePointer();
+                    }
+                } else {
+                    g_fe_activity->notePointer();  // one scroll notch
+                }
+            });
+        if (!callback) {
+            errors.push_back(std::string("Failed to register ") + event + " callback - flow detection may undercount");
+            continue;
+        }
+        activityCallbacks.push_back(callback);
+    }
+    
+    // Window lock membership follows windows closing and reopening
+    static std::vector<SP<HOOK_CALLBACK_FN>> lockCallbacks;
+    for (const char* event : {"openWindow", "closeWindow"}) {
+        auto callback = HyprlandAPI::registerCallbackDynamic(
+            PHANDLE, event, [opened = std::string(event) == "openWindow"](void* self, SCallbackInfo& info, std::any data) {
+                (void)self; (void)info;
+                if (!g_fe_window_lock) {
+                    return;
+                }
+                try {
+                    auto pWindow = std::any_cast<PHLWINDOW>(data);
+                    opened ? g_fe_window_lock->onWindowOpened(pWindow) : g_fe_window_lock->onWindowClosed(pWindow);
+                } catch (const std::bad_any_cast& e) {
+                    FE_WARN("Window lock: unexpected window data: {}", e.what());
+                }
+            });
+        if (!callback) {
+            errors.push_back(std::string("Failed to register ") + event + " callback - window lock won't follow reopened windows");
+            continue;
+        }
+        lockCallbacks.push_back(callback);
+    }
+    
     FE_INFO("Event hook registration complete ({} errors)", errors.size());
 }
 
 // Track hook state ourselves since CFunctionHook doesn't have isHooked()
 static bool g_spawnHooked = false;
+static bool g_swipeHooked = false;
 
 void enableEnforcementHooks() {
     FE_INFO("Enabling enforcement hooks...");
     
     // Debug
-    std::ofstream dbg("/tmp/hyfocus_debug.log", std::ios::app);
+    DebugLog dbg;
     dbg << "enableEnforcementHooks: block_spawn=" << g_fe_block_spawn 
         << " pSpawnHook=" << (g_fe_pSpawnHook != nullptr)
         << " already_hooked=" << g_spawnHooked << std::endl;
@@ -301,6 +1122,18 @@ void enableEnforcementHooks() {
         dbg << "Spawn hook NOT enabled (conditions not met)" << std::endl;
     }
     dbg.close();
+    
+    // Both or neither: update's clamping relies on end resetting it
+    if (g_fe_pSwipeUpdateHook && g_fe_pSwipeEndHook && !g_swipeHooked) {
+        if (g_fe_pSwipeUpdateHook->hook() && g_fe_pSwipeEndHook->hook()) {
+            g_swipeHooked = true;
+            FE_INFO("Enabled swipe hooks");
+        } else {
+            g_fe_pSwipeUpdateHook->unhook();
+            g_fe_pSwipeEndHook->unhook();
+            FE_ERR("Failed to enable swipe hooks");
+        }
+    }
 }
 
 void disableEnforcementHooks() {
@@ -313,6 +1146,14 @@ void disableEnforcementHooks() {
         g_spawnHooked = false;
         FE_INFO("Disabled spawn hook");
     }
+    
+    if (g_swipeHooked) {
+        g_fe_pSwipeUpdateHook->unhook();
+        g_fe_pSwipeEndHook->unhook();
+        g_swipeHooked = false;
+        g_swipe = {};
+        FE_INFO("Disabled swipe hooks");
+    }
 }
 
 void unregisterEventHooks() {
@@ -323,6 +1164,11 @@ void unregisterEventHooks() {
     
     // Then destroy the spawn hook object (no changeworkspace hook anymore)
     g_fe_pSpawnHook = nullptr;
+    g_fe_pSwipeUpdateHook = nullptr;
+    g_fe_pSwipeEndHook = nullptr;
+    
+    // Hand the workspace dispatchers back before our code is unloaded
+    removeWorkspacePrefilter();
     
     FE_INFO("Event hooks unregistered");
 }
@@ -9,3 +9,11 @@ void registerEventHooks(std::vector<std::string>& errors);
 void enableEnforcementHooks();
 void disableEnforcementHooks();
 void unregisterEventHooks();
+
+// Time budgets: return to the last valid workspace once the running charge
+// is used up (compositor thread), and persist bucket levels to the checkpoint
+void onBudgetExhausted();
+void persistBudgets();
+
+// Write focus stats to the checkpoint (compositor thread)
+void persistStats();
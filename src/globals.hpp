@@ -7,17 +7,22 @@
 // std headers before private->public hack
 #include <atomic>
 #include <chrono>
+#include <cerrno>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fcntl.h>
 #include <fstream>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <signal.h>
+#include <spawn.h>
 #include <sstream>
 #include <string>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <thread>
 #include <unistd.h>
 #include <vector>
@@ -34,15 +39,34 @@
 #include <hyprland/src/devices/IPointer.hpp>
 #include <hyprland/src/desktop/state/FocusState.hpp>
 #include <hyprland/src/helpers/Monitor.hpp>
+#include <hyprland/src/helpers/MiscFunctions.hpp>
+#include <hyprland/src/managers/input/UnifiedWorkspaceSwipeGesture.hpp>
 #include <hyprutils/string/String.hpp>
 #undef private
 
 #include "log.hpp"
+#include "Metrics.hpp"
+#include "IoService.hpp"
+#include "WorkerRuntime.hpp"
 
 class FocusTimer;
 class WorkspaceEnforcer;
 class WindowShake;
 class ExitChallenge;
+class TimeBudget;
+class Checkpoint;
+class MainThreadExecutor;
+class RuleEngine;
+class IpcServer;
+class WorkspaceCatalogue;
+class FocusRoom;
+class CalendarSchedule;
+class InputCooldown;
+class WindowLock;
+class ActivityEstimator;
+class FocusStats;
+class DashboardServer;
+class MonitorWorkspaces;
 
 inline HANDLE PHANDLE = nullptr;
 
@@ -55,15 +79,62 @@ inline int g_fe_break_interval = 5;
 inline std::vector<WORKSPACEID> g_fe_allowed_workspaces;
 inline std::set<std::string> g_fe_exception_classes;
 inline bool g_fe_enforce_during_break = false;
+inline bool g_fe_redirect_relative = true;  // e+1/scroll skip to the next allowed workspace
+inline int g_fe_swipe_policy = 2;           // toward a restricted workspace: 0 = off, 1 = clamp, 2 = skip to next allowed
+
+// Per-monitor workspace plugins: IDs per monitor (0 = off) and which monitors come first
+inline int g_fe_workspaces_per_monitor = 0;
+inline std::string g_fe_monitor_order = "";
 
 // App spawn blocking (experimental - whitelist doesn't work yet)
 inline bool g_fe_block_spawn = true;
 inline std::set<std::string> g_fe_spawn_whitelist;
 
+// Time budgets for disallowed workspaces/classes ("4=5m/session, class:discord=15m/day")
+inline std::string g_fe_budget_spec = "";
+
+// Declarative focus rules ("phase:work ws:4 -> block; class:~discord -> quarantine")
+inline std::string g_fe_rules_spec = "";
+
+// Metrics endpoint (OpenMetrics over HTTP); empty path / port 0 = off
+inline std::string g_fe_metrics_socket = "";
+inline int g_fe_metrics_port = 0;
+
+// History dashboard (HTTP, read-only); empty path / port 0 = off
+inline std::string g_fe_dashboard_socket = "";
+inline int g_fe_dashboard_port = 0;
+
+// Focus rooms; empty = $XDG_RUNTIME_DIR/hyfocus-rooms
+inline std::string g_fe_room_dir = "";
+
+// Finished sessions are logged here, one directory per host; empty = $XDG_STATE_HOME/hyfocus/history
+inline std::string g_fe_history_dir = "";
+
+// CPUs for background and idle threads (empty = anywhere), read once at init
+inline std::vector<int> g_fe_worker_cpus;
+
+// Calendar-driven sessions; empty path = off
+inline std::string g_fe_calendar_path = "";
+inline std::string g_fe_calendar_tag = "focus";
+
 // Exit challenge
 inline int g_fe_exit_challenge_type = 0;  // 0=none, 1=phrase, 2=math, 3=countdown
 inline std::string g_fe_exit_challenge_phrase = "I want to stop focusing";
 
+// Input cooldown after repeated blocked switches (attempts 0 = off)
+inline int g_fe_cooldown_attempts = 5;
+inline int g_fe_cooldown_window = 2000;     // ms
+inline int g_fe_cooldown_duration = 1000;   // ms, doubles per level
+inline int g_fe_cooldown_max = 30000;       // ms
+
+// Flow extensions: keep working past the interval while input is steady (grace 0 = off)
+inline int g_fe_flow_grace = 0;             // minutes per extension
+inline int g_fe_flow_max_extensions = 2;
+inline int g_fe_flow_inputs = 40;           // keys + clicks + scroll notches per minute
+
+// Focus stats: a day counts toward the streak once this many minutes were worked
+inline int g_fe_daily_goal = 120;
+
 // Animation
 inline int g_fe_shake_intensity = 15;
 inline int g_fe_shake_duration = 300;
@@ -82,16 +153,57 @@ inline FocusTimer* g_fe_timer = nullptr;
 inline WorkspaceEnforcer* g_fe_enforcer = nullptr;
 inline WindowShake* g_fe_shaker = nullptr;
 inline ExitChallenge* g_fe_exitChallenge = nullptr;
+inline TimeBudget* g_fe_budget = nullptr;
+inline Checkpoint* g_fe_checkpoint = nullptr;
+inline MainThreadExecutor* g_fe_mainExecutor = nullptr;
+inline IoService* g_fe_io = nullptr;
+inline WorkerRuntime* g_fe_workers = nullptr;
+inline RuleEngine* g_fe_rules = nullptr;
+inline IpcServer* g_fe_ipc = nullptr;
+inline WorkspaceCatalogue* g_fe_catalogue = nullptr;
+inline MonitorWorkspaces* g_fe_monitor_workspaces = nullptr;
+inline MetricsServer* g_fe_metrics = nullptr;
+inline DashboardServer* g_fe_dashboard = nullptr;
+inline FocusRoom* g_fe_room = nullptr;
+inline CalendarSchedule* g_fe_calendar = nullptr;
+inline InputCooldown* g_fe_cooldown = nullptr;
+inline WindowLock* g_fe_window_lock = nullptr;
+inline ActivityEstimator* g_fe_activity = nullptr;
+inline FocusStats* g_fe_stats = nullptr;
 inline std::mutex g_fe_mutex;
 
 // Hooks
 inline CFunctionHook* g_fe_pSpawnHook = nullptr;
+inline CFunctionHook* g_fe_pSwipeUpdateHook = nullptr;
+inline CFunctionHook* g_fe_pSwipeEndHook = nullptr;
 
 // Helpers
+// The shell starts the command in the background and exits, so reaping it
+// takes a worker for a moment even when the command itself hangs
 inline void execAsync(const std::string& cmd) {
-    std::thread([cmd]() {
-        system(cmd.c_str());
-    }).detach();
+    metricCount(MetricCounter::UiSpawns);
+    std::string script = "(" + cmd + "\n) &";
+    char* const argv[] = {const_cast<char*>("sh"), const_cast<char*>("-c"), script.data(), nullptr};
+
+    // Like system(): no signals blocked in the child, whatever this thread has
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t none;
+    sigemptyset(&none);
+    posix_spawnattr_setsigmask(&attr, &none);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+
+    pid_t pid;
+    int err = posix_spawn(&pid, "/bin/sh", nullptr, &attr, argv, environ);
+    posix_spawnattr_destroy(&attr);
+    if (err != 0) {
+        FE_WARN("Cannot run '{}': {}", cmd, strerror(err));
+        return;
+    }
+    runInBackground(WorkQos::Interactive, [pid]() {
+        while (waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {
+        }
+    });
 }
 
 inline void triggerEww(const std::string& action, const std::string& args = "") {
@@ -122,17 +234,48 @@ inline void showWarning(const std::string& msg) {
     showNotification(msg, {1.0, 0.7, 0.0, 1.0}, 4000);
 }
 
+// Runtime files (pipe, state file, sockets) live in a directory per
+// Hyprland instance: $XDG_RUNTIME_DIR/hypr/$HYPRLAND_INSTANCE_SIGNATURE/hyfocus.
+// Resolved once by initRuntimeDir() and read-only afterwards, so helper
+// threads can use it freely.
+inline std::string g_fe_runtime_dir = "";
+
+inline void initRuntimeDir() {
+    const char* runtimeDir = getenv("XDG_RUNTIME_DIR");
+    if (!runtimeDir) runtimeDir = "/tmp";
+    const char* signature = getenv("HYPRLAND_INSTANCE_SIGNATURE");
+    
+    std::string instanceDir = std::string(runtimeDir) + "/hypr/" + ((signature && *signature) ? signature : "default");
+    g_fe_runtime_dir = instanceDir + "/hyfocus";
+    
+    // Hyprland normally created the instance directory already
+    mkdir((std::string(runtimeDir) + "/hypr").c_str(), 0700);
+    mkdir(instanceDir.c_str(), 0700);
+    if (mkdir(g_fe_runtime_dir.c_str(), 0700) != 0 && errno != EEXIST) {
+        FE_ERR("Cannot create runtime directory {}: {}", g_fe_runtime_dir, strerror(errno));
+    }
+}
+
+inline std::string runtimePath(const std::string& name) {
+    return g_fe_runtime_dir + "/" + name;
+}
+
+inline void cleanupRuntimeDir() {
+    // Only succeeds once everything inside has been removed
+    if (!g_fe_runtime_dir.empty()) {
+        rmdir(g_fe_runtime_dir.c_str());
+    }
+}
+
 // Named pipe for EWW IPC
 inline std::string g_fe_pipe_path = "";
 
 inline void initPipe() {
-    const char* runtimeDir = getenv("XDG_RUNTIME_DIR");
-    if (!runtimeDir) runtimeDir = "/tmp";
-    g_fe_pipe_path = std::string(runtimeDir) + "/hyfocus.pipe";
+    g_fe_pipe_path = runtimePath("state.pipe");
     
-    // Remove old pipe if exists, create new one
+    // Remove a pipe left by a crashed load of this instance, create new one
     unlink(g_fe_pipe_path.c_str());
-    mkfifo(g_fe_pipe_path.c_str(), 0666);
+    mkfifo(g_fe_pipe_path.c_str(), 0600);
 }
 
 inline void writeToPipe(const std::string& json) {
@@ -153,7 +296,25 @@ inline void cleanupPipe() {
     }
 }
 
-inline void writeStateFile(bool active, const std::string& state, int remainingSecs, const std::vector<WORKSPACEID>& workspaces = {}) {
+inline std::string jsonEscape(const std::string& str) {
+    std::string out;
+    out.reserve(str.size());
+    for (char c : str) {
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) continue;
+                out += c;
+        }
+    }
+    return out;
+}
+
+// remaining_secs/interval_secs/cooldown_secs let clients count down locally between updates
+inline std::string makeStateJson(bool active, const std::string& state, int remainingSecs, const std::vector<WORKSPACEID>& workspaces = {}, int intervalSecs = 0, int cooldownSecs = 0) {
     int mins = remainingSecs / 60;
     int secs = remainingSecs % 60;
     char timeStr[8];
@@ -170,25 +331,23 @@ inline void writeStateFile(bool active, const std::string& state, int remainingS
     json << "{\"active\": " << (active ? "true" : "false")
          << ", \"state\": \"" << state << "\""
          << ", \"remaining\": \"" << timeStr << "\""
-         << ", \"workspaces\": " << wsArr << "}";
+         << ", \"workspaces\": " << wsArr
+         << ", \"remaining_secs\": " << remainingSecs
+         << ", \"interval_secs\": " << intervalSecs
+         << ", \"cooldown_secs\": " << cooldownSecs << "}";
+    return json.str();
+}
+
+inline void writeStateFile(bool active, const std::string& state, int remainingSecs, const std::vector<WORKSPACEID>& workspaces = {}, int intervalSecs = 0, int cooldownSecs = 0) {
+    std::string json = makeStateJson(active, state, remainingSecs, workspaces, intervalSecs, cooldownSecs);
     
     // Write to pipe (for deflisten)
-    writeToPipe(json.str());
+    writeToPipe(json);
     
-    // Also write to file (fallback for polling)
-    const char* runtimeDir = getenv("XDG_RUNTIME_DIR");
-    if (!runtimeDir) runtimeDir = "/tmp";
-    std::string path = std::string(runtimeDir) + "/hyfocus-state.json";
-    std::ofstream f(path);
-    if (f.is_open()) {
-        f << json.str();
-        f.close();
-    }
+    // Also write to file (fallback for polling), replaced whole so pollers never see half of it
+    ioReplace(runtimePath("state.json"), std::move(json));
 }
 
 inline void removeStateFile() {
-    const char* runtimeDir = getenv("XDG_RUNTIME_DIR");
-    if (!runtimeDir) runtimeDir = "/tmp";
-    std::string path = std::string(runtimeDir) + "/hyfocus-state.json";
-    std::remove(path.c_str());
+    ioRemove(runtimePath("state.json"));
 }
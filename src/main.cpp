@@ -5,6 +5,22 @@
 #include "WorkspaceEnforcer.hpp"
 #include "WindowShake.hpp"
 #include "ExitChallenge.hpp"
+#include "TimeBudget.hpp"
+#include "Checkpoint.hpp"
+#include "MainThreadExecutor.hpp"
+#include "RuleEngine.hpp"
+#include "IpcServer.hpp"
+#include "WorkspaceCatalogue.hpp"
+#include "FocusRoom.hpp"
+#include "CalendarSchedule.hpp"
+#include "InputCooldown.hpp"
+#include "WindowLock.hpp"
+#include "ActivityEstimator.hpp"
+#include "FocusStats.hpp"
+#include "FocusHistory.hpp"
+#include "Dashboard.hpp"
+#include "MonitorWorkspaces.hpp"
+#include "HookWatchdog.hpp"
 
 APICALL EXPORT std::string PLUGIN_API_VERSION() {
     return HYPRLAND_API_VERSION;
@@ -39,6 +55,49 @@ static void validateConfig() {
     }
 }
 
+/**
+ * @brief Compile the rules config plus the built-in defaults into bytecode.
+ */
+static void compileFocusRules() {
+    if (!g_fe_rules) {
+        return;
+    }
+    
+    RuleDefaults defaults;
+    defaults.enforceDuringBreak = g_fe_enforce_during_break;
+    defaults.hasBudgets = g_fe_budget && !g_fe_budget->empty();
+    
+    if (!g_fe_rules->compile(g_fe_rules_spec, defaults)) {
+        for (const auto& err : g_fe_rules->errors()) {
+            FE_WARN("Rule error: {}", err);
+        }
+        showWarning("Some focus rules were rejected. Check logs.");
+    }
+    
+    FE_INFO("Compiled {} focus rules ({} user)", g_fe_rules->ruleCount(), g_fe_rules->userRuleCount());
+}
+
+/**
+ * @brief Apply the per-monitor workspace layout ("DP-1, HDMI-A-1" first).
+ */
+static void configureMonitorWorkspaces() {
+    if (!g_fe_monitor_workspaces) {
+        return;
+    }
+    
+    std::vector<std::string> order;
+    std::stringstream ss(g_fe_monitor_order);
+    std::string token;
+    while (std::getline(ss, token, ',')) {
+        size_t start = token.find_first_not_of(" \t");
+        size_t end = token.find_last_not_of(" \t");
+        if (start != std::string::npos && end != std::string::npos) {
+            order.push_back(token.substr(start, end - start + 1));
+        }
+    }
+    g_fe_monitor_workspaces->configure(g_fe_workspaces_per_monitor, std::move(order));
+}
+
 /**
  * @brief Plugin initialization entry point.
  */
@@ -68,6 +127,26 @@ APICALL EXPORT PLUGIN_DESCRIPTION_INFO PLUGIN_INIT(HANDLE handle) {
     
     // Enforcement settings
     CONF("enforce_during_break", 0L); // Allow all workspaces during breaks
+    CONF("redirect_relative", 1L);    // e+1/e-1 and scrolling skip restricted workspaces
+    CONF("swipe_policy", 2L);         // Swipes toward a restricted workspace: 0 = off, 1 = clamp, 2 = skip to next allowed
+    
+    // Per-monitor workspace plugins (split-monitor-workspaces, hyprsplit): lets allowlists say "DP-1:3"
+    CONF("workspaces_per_monitor", 0L); // The plugin's workspace count per monitor, 0 = off
+    CONF("monitor_order", "NONE");      // Monitors taking the first blocks of IDs, comma-separated; others follow by ID
+    
+    // Swallow workspace binds for a while after this many blocked switches
+    CONF("cooldown_attempts", 5L);    // 0 = off
+    CONF("cooldown_window", 2000L);   // ...within this many ms
+    CONF("cooldown_duration", 1000L); // First cooldown in ms, doubles while the storm goes on
+    CONF("cooldown_max", 30000L);     // Longest cooldown in ms
+    
+    // Postpone the break while typing/clicking steadily without hopping between windows
+    CONF("flow_grace", 0L);           // Minutes per extension, 0 = off
+    CONF("flow_max_extensions", 2L);  // Per work interval
+    CONF("flow_inputs", 40L);         // Keys + clicks + scroll notches per minute that count as flow
+    
+    // Focus stats: minutes of work that make a day count toward the streak
+    CONF("daily_goal", 120L);
     
     // Animation settings
     CONF("shake_intensity", 15L);     // Pixels
@@ -85,6 +164,36 @@ APICALL EXPORT PLUGIN_DESCRIPTION_INFO PLUGIN_INIT(HANDLE handle) {
     CONF("block_spawn", 1L);          // Block app launching by default
     CONF("spawn_whitelist", "NONE");  // Apps allowed to launch (comma-separated)
     
+    // Time budgets for disallowed targets: "4=5m/session, class:discord=15m/day"
+    CONF("budgets", "NONE");
+    
+    // Declarative focus rules, ';'-separated: "phase:work ws:4 -> block; class:~discord -> quarantine"
+    CONF("rules", "NONE");
+    
+    // Metrics endpoint (OpenMetrics over HTTP)
+    CONF("metrics_socket", "NONE");   // Path, or "auto" for metrics.sock in the runtime directory
+    CONF("metrics_port", 0L);         // Loopback TCP port, 0 = off
+    
+    // Read-only history dashboard for a browser (HTTP)
+    CONF("dashboard_socket", "NONE"); // Path, or "auto" for dashboard.sock in the runtime directory
+    CONF("dashboard_port", 0L);       // Loopback TCP port, 0 = off
+    
+    // Where focus rooms meet; NONE = $XDG_RUNTIME_DIR/hyfocus-rooms
+    CONF("room_dir", "NONE");
+    
+    // Session history, one directory per host so it can be synced and merged; NONE = $XDG_STATE_HOME/hyfocus/history
+    CONF("history_dir", "NONE");
+    
+    // Start sessions for events in a local .ics file tagged with calendar_tag
+    CONF("calendar", "NONE");
+    CONF("calendar_tag", "focus");     // CATEGORIES entry, or "#focus" in the summary
+    
+    // CPUs for background/idle worker threads, e.g. "2-3"; NONE = any
+    CONF("worker_cpus", "NONE");
+    
+    // Per-hook execution budget; repeated overruns shed optional work, 0 = off
+    CONF("hook_budget_us", 200L);
+    
     // Exit challenge settings (makes stopping annoying to discourage quitting)
     // 0 = disabled, 1 = type phrase, 2 = math problem, 3 = countdown confirmations
     CONF("exit_challenge_type", 0L);
@@ -102,10 +211,31 @@ APICALL EXPORT PLUGIN_DESCRIPTION_INFO PLUGIN_INIT(HANDLE handle) {
             static const auto* pBlockSpawn = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:block_spawn")->getDataStaticPtr());
             static const auto* pEwwConfigPath = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:eww_config_path")->getDataStaticPtr());
             static const auto* pUseEwwNotifications = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:use_eww_notifications")->getDataStaticPtr());
+            static const auto* pBudgets = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:budgets")->getDataStaticPtr());
+            static const auto* pRules = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:rules")->getDataStaticPtr());
+            static const auto* pCalendar = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:calendar")->getDataStaticPtr());
+            static const auto* pCalendarTag = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:calendar_tag")->getDataStaticPtr());
+            static const auto* pRedirectRelative = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:redirect_relative")->getDataStaticPtr());
+            static const auto* pSwipePolicy = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:swipe_policy")->getDataStaticPtr());
+            static const auto* pWorkspacesPerMonitor = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:workspaces_per_monitor")->getDataStaticPtr());
+            static const auto* pMonitorOrder = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:monitor_order")->getDataStaticPtr());
+            static const auto* pCooldownAttempts = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:cooldown_attempts")->getDataStaticPtr());
+            static const auto* pCooldownWindow = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:cooldown_window")->getDataStaticPtr());
+            static const auto* pCooldownDuration = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:cooldown_duration")->getDataStaticPtr());
+            static const auto* pCooldownMax = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:cooldown_max")->getDataStaticPtr());
+            static const auto* pFlowGrace = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:flow_grace")->getDataStaticPtr());
+            static const auto* pFlowMaxExtensions = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:flow_max_extensions")->getDataStaticPtr());
+            static const auto* pFlowInputs = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:flow_inputs")->getDataStaticPtr());
+            static const auto* pDailyGoal = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:daily_goal")->getDataStaticPtr());
+            static const auto* pHistoryDir = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:history_dir")->getDataStaticPtr());
+            static const auto* pHookBudget = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:hook_budget_us")->getDataStaticPtr());
             
             g_fe_exit_challenge_type = **pExitChallengeType;
             g_fe_block_spawn = **pBlockSpawn != 0;
+            g_fe_redirect_relative = **pRedirectRelative != 0;
+            g_fe_swipe_policy = **pSwipePolicy;
             g_fe_use_eww_notifications = **pUseEwwNotifications != 0;
+            hookWatchdogConfigure(static_cast<int>(**pHookBudget));
             
             // Handle "NONE" as empty string
             std::string ewwPath = *pEwwConfigPath;
@@ -116,6 +246,70 @@ APICALL EXPORT PLUGIN_DESCRIPTION_INFO PLUGIN_INIT(HANDLE handle) {
                 ChallengeType challengeType = static_cast<ChallengeType>(g_fe_exit_challenge_type);
                 g_fe_exitChallenge->configure(challengeType, g_fe_exit_challenge_phrase);
             }
+            
+            // Reconfigure budgets (existing buckets keep their tokens)
+            std::string budgetSpec = *pBudgets;
+            budgetSpec = (budgetSpec == "NONE") ? "" : budgetSpec;
+            bool budgetsChanged = g_fe_budget && budgetSpec != g_fe_budget_spec;
+            if (budgetsChanged) {
+                g_fe_budget_spec = budgetSpec;
+                g_fe_budget->configure(g_fe_budget_spec);
+            }
+            
+            // Recompile rules (budgets toggle a built-in rule)
+            std::string rulesSpec = *pRules;
+            rulesSpec = (rulesSpec == "NONE") ? "" : rulesSpec;
+            if (g_fe_rules && (budgetsChanged || rulesSpec != g_fe_rules_spec)) {
+                g_fe_rules_spec = rulesSpec;
+                compileFocusRules();
+            }
+            
+            // Cooldown tuning (resets any cooldown in progress)
+            if (g_fe_cooldown && (**pCooldownAttempts != g_fe_cooldown_attempts || **pCooldownWindow != g_fe_cooldown_window ||
+                                  **pCooldownDuration != g_fe_cooldown_duration || **pCooldownMax != g_fe_cooldown_max)) {
+                g_fe_cooldown_attempts = **pCooldownAttempts;
+                g_fe_cooldown_window = **pCooldownWindow;
+                g_fe_cooldown_duration = **pCooldownDuration;
+                g_fe_cooldown_max = **pCooldownMax;
+                g_fe_cooldown->configure(g_fe_cooldown_attempts, g_fe_cooldown_window, g_fe_cooldown_duration, g_fe_cooldown_max);
+            }
+            
+            // Flow thresholds apply from the next interval end
+            g_fe_flow_grace = **pFlowGrace;
+            g_fe_flow_max_extensions = **pFlowMaxExtensions;
+            g_fe_flow_inputs = **pFlowInputs;
+            if (g_fe_activity) {
+                g_fe_activity->configure(g_fe_flow_grace, g_fe_flow_max_extensions, g_fe_flow_inputs);
+            }
+            
+            // A new goal re-judges today only
+            g_fe_daily_goal = **pDailyGoal;
+            if (g_fe_stats) {
+                g_fe_stats->setDailyGoal(g_fe_daily_goal);
+            }
+            
+            // New offsets move a running session's monitor-relative workspaces too
+            std::string monitorOrder = *pMonitorOrder;
+            g_fe_workspaces_per_monitor = **pWorkspacesPerMonitor;
+            g_fe_monitor_order = (monitorOrder == "NONE") ? "" : monitorOrder;
+            configureMonitorWorkspaces();
+            
+            // Used from the next session end
+            std::string historyDir = *pHistoryDir;
+            g_fe_history_dir = (historyDir == "NONE") ? "" : historyDir;
+            
+            // Follow a different calendar (or none)
+            std::string calendarPath = *pCalendar;
+            calendarPath = (calendarPath == "NONE") ? "" : calendarPath;
+            std::string calendarTag = *pCalendarTag;
+            if (g_fe_calendar && (calendarPath != g_fe_calendar_path || calendarTag != g_fe_calendar_tag)) {
+                g_fe_calendar_path = calendarPath;
+                g_fe_calendar_tag = calendarTag;
+                g_fe_calendar->stop();
+                if (!g_fe_calendar_path.empty()) {
+                    g_fe_calendar->start(g_fe_calendar_path, g_fe_calendar_tag);
+                }
+            }
         }
     );
     
@@ -127,9 +321,21 @@ APICALL EXPORT PLUGIN_DESCRIPTION_INFO PLUGIN_INIT(HANDLE handle) {
     static const auto* pWorkInterval = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:work_interval")->getDataStaticPtr());
     static const auto* pBreakInterval = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:break_interval")->getDataStaticPtr());
     static const auto* pEnforceDuringBreak = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:enforce_during_break")->getDataStaticPtr());
+    static const auto* pRedirectRelative = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:redirect_relative")->getDataStaticPtr());
+    static const auto* pSwipePolicy = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:swipe_policy")->getDataStaticPtr());
+    static const auto* pWorkspacesPerMonitor = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:workspaces_per_monitor")->getDataStaticPtr());
+    static const auto* pMonitorOrder = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:monitor_order")->getDataStaticPtr());
     static const auto* pShakeIntensity = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:shake_intensity")->getDataStaticPtr());
     static const auto* pShakeDuration = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:shake_duration")->getDataStaticPtr());
     static const auto* pShakeFrequency = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:shake_frequency")->getDataStaticPtr());
+    static const auto* pCooldownAttempts = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:cooldown_attempts")->getDataStaticPtr());
+    static const auto* pCooldownWindow = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:cooldown_window")->getDataStaticPtr());
+    static const auto* pCooldownDuration = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:cooldown_duration")->getDataStaticPtr());
+    static const auto* pCooldownMax = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:cooldown_max")->getDataStaticPtr());
+    static const auto* pFlowGrace = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:flow_grace")->getDataStaticPtr());
+    static const auto* pFlowMaxExtensions = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:flow_max_extensions")->getDataStaticPtr());
+    static const auto* pFlowInputs = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:flow_inputs")->getDataStaticPtr());
+    static const auto* pDailyGoal = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:daily_goal")->getDataStaticPtr());
     static const auto* pBlockSpawn = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:block_spawn")->getDataStaticPtr());
     static const auto* pExitChallengeType = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:exit_challenge_type")->getDataStaticPtr());
     static const auto* pExceptionClasses = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:exception_classes")->getDataStaticPtr());
@@ -137,15 +343,38 @@ APICALL EXPORT PLUGIN_DESCRIPTION_INFO PLUGIN_INIT(HANDLE handle) {
     static const auto* pExitChallengePhrase = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:exit_challenge_phrase")->getDataStaticPtr());
     static const auto* pUseEwwNotifications = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:use_eww_notifications")->getDataStaticPtr());
     static const auto* pEwwConfigPath = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:eww_config_path")->getDataStaticPtr());
+    static const auto* pBudgets = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:budgets")->getDataStaticPtr());
+    static const auto* pRules = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:rules")->getDataStaticPtr());
+    static const auto* pMetricsSocket = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:metrics_socket")->getDataStaticPtr());
+    static const auto* pMetricsPort = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:metrics_port")->getDataStaticPtr());
+    static const auto* pDashboardSocket = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:dashboard_socket")->getDataStaticPtr());
+    static const auto* pDashboardPort = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:dashboard_port")->getDataStaticPtr());
+    static const auto* pRoomDir = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:room_dir")->getDataStaticPtr());
+    static const auto* pHistoryDir = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:history_dir")->getDataStaticPtr());
+    static const auto* pCalendar = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:calendar")->getDataStaticPtr());
+    static const auto* pCalendarTag = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:calendar_tag")->getDataStaticPtr());
+    static const auto* pWorkerCpus = (Hyprlang::STRING const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:worker_cpus")->getDataStaticPtr());
+    static const auto* pHookBudget = (Hyprlang::INT* const*)(HyprlandAPI::getConfigValue(PHANDLE, "plugin:hyfocus:hook_budget_us")->getDataStaticPtr());
     
     // Apply values to globals
     g_fe_total_duration = **pTotalDuration;
     g_fe_work_interval = **pWorkInterval;
     g_fe_break_interval = **pBreakInterval;
     g_fe_enforce_during_break = **pEnforceDuringBreak != 0;
+    g_fe_redirect_relative = **pRedirectRelative != 0;
+    g_fe_swipe_policy = **pSwipePolicy;
+    g_fe_workspaces_per_monitor = **pWorkspacesPerMonitor;
     g_fe_shake_intensity = **pShakeIntensity;
     g_fe_shake_duration = **pShakeDuration;
     g_fe_shake_frequency = **pShakeFrequency;
+    g_fe_cooldown_attempts = **pCooldownAttempts;
+    g_fe_cooldown_window = **pCooldownWindow;
+    g_fe_cooldown_duration = **pCooldownDuration;
+    g_fe_cooldown_max = **pCooldownMax;
+    g_fe_flow_grace = **pFlowGrace;
+    g_fe_flow_max_extensions = **pFlowMaxExtensions;
+    g_fe_flow_inputs = **pFlowInputs;
+    g_fe_daily_goal = **pDailyGoal;
     g_fe_block_spawn = **pBlockSpawn != 0;
     g_fe_exit_challenge_type = **pExitChallengeType;
     g_fe_exit_challenge_phrase = *pExitChallengePhrase;
@@ -155,6 +384,56 @@ APICALL EXPORT PLUGIN_DESCRIPTION_INFO PLUGIN_INIT(HANDLE handle) {
     std::string ewwPath = *pEwwConfigPath;
     g_fe_eww_config_path = (ewwPath == "NONE") ? "" : ewwPath;
     
+    std::string budgetSpec = *pBudgets;
+    g_fe_budget_spec = (budgetSpec == "NONE") ? "" : budgetSpec;
+    
+    std::string rulesSpec = *pRules;
+    g_fe_rules_spec = (rulesSpec == "NONE") ? "" : rulesSpec;
+    
+    std::string monitorOrder = *pMonitorOrder;
+    g_fe_monitor_order = (monitorOrder == "NONE") ? "" : monitorOrder;
+    
+    // Everything below that creates runtime files puts them here
+    initRuntimeDir();
+    
+    // Metrics listeners are bound once at load; changing them needs a plugin reload
+    std::string metricsSocket = *pMetricsSocket;
+    if (metricsSocket == "auto") {
+        metricsSocket = runtimePath("metrics.sock");
+    }
+    g_fe_metrics_socket = (metricsSocket == "NONE") ? "" : metricsSocket;
+    g_fe_metrics_port = **pMetricsPort;
+    
+    // Same for the dashboard
+    std::string dashboardSocket = *pDashboardSocket;
+    if (dashboardSocket == "auto") {
+        dashboardSocket = runtimePath("dashboard.sock");
+    }
+    g_fe_dashboard_socket = (dashboardSocket == "NONE") ? "" : dashboardSocket;
+    g_fe_dashboard_port = **pDashboardPort;
+    
+    // Takes effect on the next hyfocus:room join
+    std::string roomDir = *pRoomDir;
+    g_fe_room_dir = (roomDir == "NONE") ? "" : roomDir;
+    
+    std::string historyDir = *pHistoryDir;
+    g_fe_history_dir = (historyDir == "NONE") ? "" : historyDir;
+    
+    std::string calendarPath = *pCalendar;
+    g_fe_calendar_path = (calendarPath == "NONE") ? "" : calendarPath;
+    g_fe_calendar_tag = *pCalendarTag;
+    
+    // Threads are pinned as they start, so this is only read here
+    std::string workerCpus = *pWorkerCpus;
+    if (workerCpus != "NONE") {
+        std::string error;
+        if (!parseCpuList(workerCpus, g_fe_worker_cpus, error)) {
+            FE_WARN("worker_cpus: {}, background threads stay unpinned", error);
+            g_fe_worker_cpus.clear();
+        }
+    }
+    hookWatchdogConfigure(static_cast<int>(**pHookBudget));
+    
     FE_INFO("Config loaded: exit_challenge={}, use_eww={}, eww_path={}", 
             g_fe_exit_challenge_type, g_fe_use_eww_notifications, g_fe_eww_config_path);
     
@@ -197,12 +476,59 @@ APICALL EXPORT PLUGIN_DESCRIPTION_INFO PLUGIN_INIT(HANDLE handle) {
     g_fe_enforcer = new WorkspaceEnforcer();
     g_fe_shaker = new WindowShake();;
     g_fe_exitChallenge = new ExitChallenge();
+    g_fe_budget = new TimeBudget();
+    g_fe_checkpoint = new Checkpoint();
+    g_fe_rules = new RuleEngine();
+    g_fe_catalogue = new WorkspaceCatalogue();
+    g_fe_monitor_workspaces = new MonitorWorkspaces();
+    g_fe_cooldown = new InputCooldown();
+    g_fe_window_lock = new WindowLock();
+    g_fe_activity = new ActivityEstimator();
+    g_fe_stats = new FocusStats();
+    
+    // Work posted by helper threads runs on the compositor thread
+    auto* executor = new MainThreadExecutor();
+    if (executor->start()) {
+        g_fe_mainExecutor = executor;
+    } else {
+        delete executor;
+        FE_WARN("Main-thread executor unavailable, helper threads will run work inline");
+    }
+    
+    // Short background tasks (widget commands, history appends) by QoS class
+    auto* workers = new WorkerRuntime();
+    if (workers->start()) {
+        g_fe_workers = workers;
+    } else {
+        delete workers;
+        FE_WARN("Worker threads unavailable, background tasks get a thread each");
+    }
+    
+    // File writes (state file, checkpoint, debug log) leave the calling thread
+    auto* io = new IoService();
+    if (io->start()) {
+        g_fe_io = io;
+    } else {
+        delete io;
+        FE_WARN("I/O thread unavailable, files will be written inline");
+    }
     
     // Configure components
     g_fe_timer->configure(g_fe_total_duration, g_fe_work_interval, g_fe_break_interval);
     g_fe_shaker->configure(g_fe_shake_intensity, g_fe_shake_duration, g_fe_shake_frequency);
+    g_fe_cooldown->configure(g_fe_cooldown_attempts, g_fe_cooldown_window, g_fe_cooldown_duration, g_fe_cooldown_max);
     g_fe_enforcer->setEnforceDuringBreak(g_fe_enforce_during_break);
     
+    // Budgets: restore bucket levels so a reload can't refill them
+    g_fe_budget->configure(g_fe_budget_spec);
+    g_fe_checkpoint->load();
+    g_fe_budget->loadFrom(*g_fe_checkpoint);
+    g_fe_stats->setDailyGoal(g_fe_daily_goal);
+    g_fe_stats->loadFrom(*g_fe_checkpoint);
+    
+    // Policy: compiled once here and on config reload, evaluated per event
+    compileFocusRules();
+    
     // Initialize IPC pipe for EWW
     initPipe();
     
@@ -215,9 +541,60 @@ APICALL EXPORT PLUGIN_DESCRIPTION_INFO PLUGIN_INIT(HANDLE handle) {
         g_fe_enforcer->addExceptionClass(cls);
     }
     
+    // Seed the catalogue once; compositor events keep it current after that
+    g_fe_catalogue->rebuild();
+    
+    // Same for the monitor -> workspace offset table
+    configureMonitorWorkspaces();
+    g_fe_monitor_workspaces->rebuild();
+    
     // Register dispatchers (user commands)
     registerDispatchers();
     
+    // Same commands over a socket, for scripts that need an answer back
+    auto* ipc = new IpcServer();
+    if (ipc->start()) {
+        g_fe_ipc = ipc;
+    } else {
+        delete ipc;
+        FE_WARN("IPC socket unavailable, use hyprctl dispatch instead");
+    }
+    
+    // Scrape endpoint, off by default
+    if (!g_fe_metrics_socket.empty() || g_fe_metrics_port > 0) {
+        auto* metrics = new MetricsServer();
+        if (metrics->start(g_fe_metrics_socket, g_fe_metrics_port)) {
+            g_fe_metrics = metrics;
+        } else {
+            delete metrics;
+            showWarning("Metrics endpoint could not be opened. Check logs.");
+        }
+    }
+    
+    // History dashboard, off by default; reads history_dir as it is now
+    if (!g_fe_dashboard_socket.empty() || g_fe_dashboard_port > 0) {
+        auto* dashboard = new DashboardServer();
+        std::string historyRoot = g_fe_history_dir.empty() ? HistoryLog::defaultRoot() : g_fe_history_dir;
+        if (dashboard->start(g_fe_dashboard_socket, g_fe_dashboard_port, {historyRoot})) {
+            g_fe_dashboard = dashboard;
+        } else {
+            delete dashboard;
+            showWarning("Dashboard could not be opened. Check logs.");
+        }
+    }
+    
+    // Not in any room until hyfocus:room join
+    g_fe_room = new FocusRoom();
+    
+    // Parses on its own thread; sessions start from the compositor's event loop
+    g_fe_calendar = new CalendarSchedule();
+    if (!g_fe_calendar_path.empty() && !g_fe_calendar->start(g_fe_calendar_path, g_fe_calendar_tag)) {
+        showWarning("Calendar could not be watched. Check logs.");
+    }
+    
+    // Hooks time themselves from their first call
+    calibrateHookClock();
+    
     // Register event hooks (workspace interception)
     std::vector<std::string> hookErrors;
     try {
@@ -256,15 +633,47 @@ APICALL EXPORT void PLUGIN_EXIT() {
     // First, mark session as inactive to stop all processing
     g_fe_is_session_active = false;
     
-    // Cleanup IPC pipe
+    // Cleanup IPC pipe and socket
     cleanupPipe();
-    removeStateFile();
+    if (g_fe_ipc) {
+        g_fe_ipc->stop();
+    }
+    if (g_fe_metrics) {
+        g_fe_metrics->stop();
+    }
+    if (g_fe_dashboard) {
+        g_fe_dashboard->stop();
+    }
+    
+    // No new sessions from the calendar while tearing down
+    if (g_fe_calendar) {
+        g_fe_calendar->stop();
+    }
+    
+    // Members elect a new host without us
+    if (g_fe_room) {
+        g_fe_room->leave();
+    }
     
     // Stop any running timer (do this BEFORE deleting)
     if (g_fe_timer) {
         g_fe_timer->stop();
     }
     
+    // Finish queued background tasks; later ones get their own thread
+    if (g_fe_workers) {
+        g_fe_workers->stop();
+    }
+    
+    // Drain queued writes; everything after this is written inline
+    if (g_fe_io) {
+        g_fe_io->stop();
+    }
+    
+    // After the timer, whose tick rewrites the state file
+    removeStateFile();
+    cleanupRuntimeDir();
+    
     // Stop any ongoing shake animation and wait for thread
     if (g_fe_shaker) {
         g_fe_shaker->stopShake();
@@ -277,6 +686,13 @@ APICALL EXPORT void PLUGIN_EXIT() {
         g_fe_exitChallenge->cancelChallenge();
     }
     
+    // Settle and persist budgets before the buckets go away
+    if (g_fe_budget) {
+        g_fe_budget->endAccess();
+        persistBudgets();
+    }
+    persistStats();
+    
     // Unregister hooks BEFORE deleting objects they might reference
     unregisterEventHooks();
     
@@ -288,10 +704,44 @@ APICALL EXPORT void PLUGIN_EXIT() {
     delete g_fe_enforcer;
     delete g_fe_shaker;
     delete g_fe_exitChallenge;
+    delete g_fe_budget;
+    delete g_fe_checkpoint;
+    delete g_fe_mainExecutor;
+    delete g_fe_io;
+    delete g_fe_workers;
+    delete g_fe_rules;
+    delete g_fe_ipc;
+    delete g_fe_catalogue;
+    delete g_fe_monitor_workspaces;
+    delete g_fe_metrics;
+    delete g_fe_dashboard;
+    delete g_fe_room;
+    delete g_fe_calendar;
+    delete g_fe_cooldown;
+    delete g_fe_window_lock;
+    delete g_fe_activity;
+    delete g_fe_stats;
     g_fe_timer = nullptr;
     g_fe_enforcer = nullptr;
     g_fe_shaker = nullptr;
     g_fe_exitChallenge = nullptr;
+    g_fe_budget = nullptr;
+    g_fe_checkpoint = nullptr;
+    g_fe_mainExecutor = nullptr;
+    g_fe_io = nullptr;
+    g_fe_workers = nullptr;
+    g_fe_rules = nullptr;
+    g_fe_ipc = nullptr;
+    g_fe_catalogue = nullptr;
+    g_fe_monitor_workspaces = nullptr;
+    g_fe_metrics = nullptr;
+    g_fe_dashboard = nullptr;
+    g_fe_room = nullptr;
+    g_fe_calendar = nullptr;
+    g_fe_cooldown = nullptr;
+    g_fe_window_lock = nullptr;
+    g_fe_activity = nullptr;
+    g_fe_stats = nullptr;
     
     FE_INFO("HyFocus plugin shutdown complete");
 }